@@ -0,0 +1,635 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * builtins.c
+ * lowering of Ifj built-in functions
+ *
+ * Simple built-ins are lowered inline to the matching IFJcode25 instruction.
+ * The rest call a helper routine which is generated once at the end of the
+ * program. Helpers do not create frames, they take arguments from the data
+ * stack, use GF@%r* registers as scratch and push the result.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "builtins.h"
+#include "strenc.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Exit code of a helper given a parameter of the wrong type, the interpreter
+// stops the instructions of the other built-ins with the same one
+#define BUILTIN_TYPE_ERROR 53
+
+typedef enum {
+    LOWER_WRITE,
+    LOWER_READ_STR,
+    LOWER_READ_NUM,
+    LOWER_LENGTH,
+    LOWER_CHR,
+    LOWER_HELPER
+} LoweringKind;
+
+typedef struct {
+    const char* name;
+    int arity;
+    LoweringKind lowering;
+    BuiltinHelper helper;   // for LOWER_HELPER
+    bool string_result;     // returns a string, or nil that fails as one
+    bool always_string;     // returns a string, never nil
+} BuiltinInfo;
+
+static const BuiltinInfo builtins[] = {
+    {"write",     1, LOWER_WRITE,    0,                false, false},
+    {"read_str",  0, LOWER_READ_STR, 0,                true,  false},
+    {"read_num",  0, LOWER_READ_NUM, 0,                false, false},
+    {"length",    1, LOWER_LENGTH,   0,                false, false},
+    {"chr",       1, LOWER_CHR,      0,                true,  true},
+    {"floor",     1, LOWER_HELPER,   HELPER_FLOOR,     false, false},
+    {"str",       1, LOWER_HELPER,   HELPER_STR,       true,  true},
+    {"substring", 3, LOWER_HELPER,   HELPER_SUBSTRING, true,  false},
+    {"strcmp",    2, LOWER_HELPER,   HELPER_STRCMP,    false, false},
+    {"ord",       2, LOWER_HELPER,   HELPER_ORD,       false, false},
+    {NULL, 0, 0, 0, false, false}
+};
+
+/**
+ * Finds built-in by name
+ * @param name name of the function, Ifj. prefix is optional
+ * @return built-in description or NULL
+ */
+static const BuiltinInfo* find_builtin(const char* name) {
+    if (strncmp(name, "Ifj.", 4) == 0) {
+        name += 4;
+    }
+    
+    for (int i = 0; builtins[i].name != NULL; i++) {
+        if (strcmp(builtins[i].name, name) == 0) {
+            return &builtins[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Checks if name is a built-in function
+ * @param name name of the function
+ * @return true if built-in exists
+ */
+bool is_builtin_function(const char* name) {
+    return find_builtin(name) != NULL;
+}
+
+/**
+ * Gets number of parameters of a built-in function
+ * @param name name of the function
+ * @return arity or -1 if not a built-in
+ */
+int get_builtin_arity(const char* name) {
+    const BuiltinInfo* info = find_builtin(name);
+    return info ? info->arity : -1;
+}
+
+/**
+ * Checks if a built-in returns a string
+ * @param name name of the function
+ * @return true for string results, nil fails like a string in concatenation
+ */
+bool builtin_returns_string(const char* name) {
+    const BuiltinInfo* info = find_builtin(name);
+    return info && info->string_result;
+}
+
+/**
+ * Checks if a built-in always returns a string
+ * @param name name of the function
+ * @return true if the result is a string and never nil
+ */
+bool builtin_always_string(const char* name) {
+    const BuiltinInfo* info = find_builtin(name);
+    return info && info->always_string;
+}
+
+/**
+ * Gets label of a helper routine
+ * @param helper helper routine
+ * @return label of the routine
+ */
+static const char* helper_label(BuiltinHelper helper) {
+    switch (helper) {
+        case HELPER_FLOOR: return "$%floor";
+        case HELPER_STR: return "$%str";
+        case HELPER_SUBSTRING: return "$%substring";
+        case HELPER_STRCMP: return "$%strcmp";
+        case HELPER_ORD: return "$%ord";
+    }
+    return "";
+}
+
+/**
+ * Generates code for a built-in call
+ * @param parser parser with output
+ * @param name name of the function
+ * @param use_result false if the result is thrown away
+ */
+void generate_builtin_call(Parser* parser, const char* name, bool use_result) {
+    const BuiltinInfo* info = find_builtin(name);
+    if (!info) {
+        error(parser, INTERNAL_ERROR, "Unknown built-in function");
+        return;
+    }
+    
+    switch (info->lowering) {
+        case LOWER_WRITE:
+            emit(parser, "POPS GF@%%tmp0\n");
+            emit(parser, "WRITE GF@%%tmp0\n");
+            if (use_result) {
+                emit(parser, "PUSHS nil@nil\n");
+            }
+            return;
+        case LOWER_READ_STR:
+            emit(parser, "READ GF@%%tmp0 string\n");
+            break;
+        case LOWER_READ_NUM:
+            emit(parser, "READ GF@%%tmp0 float\n");
+            break;
+        case LOWER_LENGTH:
+            emit(parser, "POPS GF@%%tmp0\n");
+            emit(parser, "STRLEN GF@%%tmp0 GF@%%tmp0\n");
+            break;
+        case LOWER_CHR:
+            emit(parser, "POPS GF@%%tmp0\n");
+            emit(parser, "INT2CHAR GF@%%tmp0 GF@%%tmp0\n");
+            break;
+        case LOWER_HELPER:
+            parser->used_helpers |= info->helper;
+            emit(parser, "CALL %s\n", helper_label(info->helper));
+            if (!use_result) {
+                emit(parser, "POPS GF@%%tmp0\n");
+            }
+            return;
+    }
+    
+    if (use_result) {
+        emit(parser, "PUSHS GF@%%tmp0\n");
+    }
+}
+
+// Checks that float fits FLOAT2INT
+static bool float_fits_int(double x) {
+    return x > -9223372036854775808.0 && x < 9223372036854775808.0;
+}
+
+// Ifj.str of a float, same digits as $%str
+static bool fold_str_float(double x, ConstValue* result) {
+    if (!float_fits_int(x)) return false;
+    
+    char buffer[64];
+    long long integral = (long long)x;
+    if ((double)integral == x) {
+        snprintf(buffer, sizeof(buffer), "%lld", integral);
+        return const_set_string(result, buffer);
+    }
+    
+    double rest = x < 0 ? 0.0 - x : x;
+    integral = (long long)rest;
+    rest -= (double)integral;
+    int len = snprintf(buffer, sizeof(buffer), "%s%lld.", x < 0 ? "-" : "", integral);
+    
+    // Digits are added when followed by a non-zero one
+    char pending[8];
+    int pending_len = 0;
+    for (int i = 0; i < 6; i++) {
+        rest *= 10.0;
+        long long digit = (long long)rest;
+        rest -= (double)digit;
+        pending[pending_len++] = (char)('0' + digit);
+        if (digit != 0) {
+            memcpy(buffer + len, pending, pending_len);
+            len += pending_len;
+            pending_len = 0;
+        }
+    }
+    buffer[len] = '\0';
+    return const_set_string(result, buffer);
+}
+
+// Interpreter indexes strings by UTF-8 characters, folding works on bytes
+static bool is_ascii(const ConstValue* value) {
+    if (value->type != CONST_STRING) return false;
+    for (const char* c = value->value.string; *c; c++) {
+        if ((unsigned char)*c > 127) return false;
+    }
+    return true;
+}
+
+/**
+ * Evaluates pure built-in with constant arguments, results match the
+ * generated code exactly
+ * @param name name of the function
+ * @param args constant arguments
+ * @param arg_count number of arguments
+ * @param result folded value
+ * @return true if folded, false if it has to be called at runtime
+ */
+bool fold_builtin_call(const char* name, const ConstValue* args, int arg_count, ConstValue* result) {
+    const BuiltinInfo* info = find_builtin(name);
+    if (!info || info->arity != arg_count) return false;
+    name = info->name;
+    
+    if (strcmp(name, "length") == 0) {
+        if (!is_ascii(&args[0])) return false;
+        const_set_int(result, (long long)strlen(args[0].value.string));
+        return true;
+    }
+    
+    if (strcmp(name, "chr") == 0) {
+        // Zero byte cannot be kept in a string literal, other characters take more bytes
+        if (args[0].type != CONST_INT || args[0].value.integer < 1 || args[0].value.integer > 127) return false;
+        char text[2] = {(char)args[0].value.integer, '\0'};
+        return const_set_string(result, text);
+    }
+    
+    if (strcmp(name, "ord") == 0) {
+        if (!is_ascii(&args[0]) || args[1].type != CONST_INT) return false;
+        long long i = args[1].value.integer;
+        long long len = (long long)strlen(args[0].value.string);
+        const_set_int(result, i < 0 || i >= len ? 0 : (unsigned char)args[0].value.string[i]);
+        return true;
+    }
+    
+    if (strcmp(name, "substring") == 0) {
+        if (!is_ascii(&args[0]) || args[1].type != CONST_INT || args[2].type != CONST_INT) return false;
+        const char* s = args[0].value.string;
+        long long i = args[1].value.integer;
+        long long j = args[2].value.integer;
+        long long len = (long long)strlen(s);
+        if (i < 0 || j < 0 || i > j || i >= len || j > len) {
+            const_set_nil(result);
+            return true;
+        }
+        
+        char* part = malloc((size_t)(j - i) + 1);
+        if (!part) return false;
+        memcpy(part, s + i, (size_t)(j - i));
+        part[j - i] = '\0';
+        bool ok = const_set_string(result, part);
+        free(part);
+        return ok;
+    }
+    
+    if (strcmp(name, "strcmp") == 0) {
+        if (args[0].type != CONST_STRING || args[1].type != CONST_STRING) return false;
+        int cmp = strcmp(args[0].value.string, args[1].value.string);
+        const_set_int(result, cmp < 0 ? -1 : cmp > 0 ? 1 : 0);
+        return true;
+    }
+    
+    if (strcmp(name, "str") == 0) {
+        switch (args[0].type) {
+            case CONST_STRING: return const_copy(result, &args[0]);
+            case CONST_NIL: return const_set_string(result, "null");
+            case CONST_BOOL: return const_set_string(result, args[0].value.boolean ? "true" : "false");
+            case CONST_FLOAT: return fold_str_float(args[0].value.number, result);
+            case CONST_INT: {
+                char buffer[32];
+                snprintf(buffer, sizeof(buffer), "%lld", args[0].value.integer);
+                return const_set_string(result, buffer);
+            }
+        }
+        return false;
+    }
+    
+    if (strcmp(name, "floor") == 0) {
+        if (args[0].type == CONST_INT) {
+            const_set_int(result, args[0].value.integer);
+            return true;
+        }
+        if (args[0].type != CONST_FLOAT || !float_fits_int(args[0].value.number)) return false;
+        double x = args[0].value.number;
+        long long integral = (long long)x;
+        const_set_int(result, (double)integral > x ? integral - 1 : integral);
+        return true;
+    }
+    
+    // Input and output happen at runtime
+    return false;
+}
+
+/**
+ * Generates Ifj.write of a constant, above -O0 merges it with directly
+ * preceding write of a string literal
+ * @param parser parser with output
+ * @param value written constant
+ */
+void generate_write_constant(Parser* parser, const ConstValue* value) {
+    char* text = const_write_text(value);
+    if (!text) {
+        // Float is printed by the interpreter
+        char* operand = const_operand(value);
+        if (!operand) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+            return;
+        }
+        emit(parser, "WRITE %s\n", operand);
+        free(operand);
+        return;
+    }
+    
+    size_t text_len = strlen(text);
+    Instr* last = ilist_last(&parser->code);
+    if (text_len == 0) {
+        // Nothing is printed
+    } else if (parser->level >= 1 && last && instr_is(last, "WRITE") && last->argc == 1 &&
+               strncmp(last->args[0], "string@", 7) == 0) {
+        // Encoded directly behind the previous literal
+        size_t len = strlen(last->args[0]);
+        char* merged = malloc(len + STRENC_MAX_LENGTH(text_len) + 1);
+        if (!merged) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        } else {
+            memcpy(merged, last->args[0], len);
+            strenc_encode(text, text_len, merged + len);
+            if (!instr_set_arg(last, 0, merged)) {
+                error(parser, INTERNAL_ERROR, "Memory allocation failed");
+            }
+            free(merged);
+        }
+    } else {
+        const char* encoded = strenc_cached(text);
+        if (!encoded) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        } else {
+            emit(parser, "WRITE string@%s\n", encoded);
+        }
+    }
+    free(text);
+}
+
+// Appends WRITE of operand, literal is merged with the preceding literal write
+static void generate_write_operand(Parser* parser, const char* operand) {
+    Instr* last = ilist_last(&parser->code);
+    bool literal = strncmp(operand, "string@", 7) == 0;
+    if (literal && operand[7] == '\0') {
+        // Nothing is printed
+    } else if (literal && last && instr_is(last, "WRITE") && last->argc == 1 && strncmp(last->args[0], "string@", 7) == 0) {
+        size_t len = strlen(last->args[0]);
+        char* merged = malloc(len + strlen(operand + 7) + 1);
+        if (!merged) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+            return;
+        }
+        strcpy(merged, last->args[0]);
+        strcpy(merged + len, operand + 7);
+        if (!instr_set_arg(last, 0, merged)) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        }
+        free(merged);
+    } else {
+        emit(parser, "WRITE %s\n", operand);
+    }
+}
+
+/**
+ * Replaces concatenation written by Ifj.write with writes of its parts.
+ * The argument has to end with CONCATs into GF@%tmp0 and PUSHS GF@%tmp0,
+ * the code before them is kept, so side effects still come before output.
+ * @param parser parser with output
+ * @param start index of the first instruction of the argument
+ * @return true if the argument was replaced, false if it is left unchanged
+ */
+bool generate_write_concat(Parser* parser, int start) {
+    InstrList* code = &parser->code;
+    int end = code->count - 1;
+    if (end <= start || !instr_is(&code->items[end], "PUSHS") || strcmp(code->items[end].args[0], "GF@%tmp0") != 0) {
+        return false;
+    }
+    
+    // Chain tmp0 = a . b, tmp0 = tmp0 . c, ... right before the push
+    int first = end;
+    while (first > start && instr_is(&code->items[first - 1], "CONCAT") &&
+           strcmp(code->items[first - 1].args[0], "GF@%tmp0") == 0) {
+        first--;
+        if (strcmp(code->items[first].args[1], "GF@%tmp0") != 0) break;
+    }
+    if (first == end) return false;
+    
+    // Parts are taken out of the code before it is cut
+    int concats = end - first;
+    char** parts = malloc((concats + 1) * sizeof(char*));
+    if (!parts) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return false;
+    }
+    parts[0] = code->items[first].args[1];
+    code->items[first].args[1] = NULL;
+    for (int i = 0; i < concats; i++) {
+        parts[i + 1] = code->items[first + i].args[2];
+        code->items[first + i].args[2] = NULL;
+    }
+    
+    ilist_truncate(code, first);
+    for (int i = 0; i <= concats; i++) {
+        generate_write_operand(parser, parts[i]);
+        free(parts[i]);
+    }
+    free(parts);
+    return true;
+}
+
+// Ifj.floor(n): integer part rounded towards minus infinity
+static void generate_helper_floor(Parser* parser) {
+    emit(parser, "LABEL $%%floor\n");
+    emit(parser, "POPS GF@%%r0\n");
+    emit(parser, "TYPE GF@%%r1 GF@%%r0\n");
+    emit(parser, "JUMPIFEQ $%%floor%%float GF@%%r1 string@float\n");
+    emit(parser, "JUMPIFNEQ $%%floor%%type GF@%%r1 string@int\n");
+    emit(parser, "PUSHS GF@%%r0\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%floor%%float\n");
+    emit(parser, "FLOAT2INT GF@%%r1 GF@%%r0\n");
+    emit(parser, "INT2FLOAT GF@%%r2 GF@%%r1\n");
+    emit(parser, "GT GF@%%r2 GF@%%r2 GF@%%r0\n");
+    emit(parser, "JUMPIFEQ $%%floor%%done GF@%%r2 bool@false\n");
+    emit(parser, "SUB GF@%%r1 GF@%%r1 int@1\n");
+    emit(parser, "LABEL $%%floor%%done\n");
+    emit(parser, "PUSHS GF@%%r1\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%floor%%type\n");
+    emit(parser, "EXIT int@%d\n", BUILTIN_TYPE_ERROR);
+}
+
+// Ifj.str(term): strings as they are, numbers in decimal, null as "null".
+// Fraction of a non-integral number is printed with at most 6 digits.
+static void generate_helper_str(Parser* parser) {
+    emit(parser, "LABEL $%%str\n");
+    emit(parser, "POPS GF@%%r0\n");
+    emit(parser, "TYPE GF@%%r1 GF@%%r0\n");
+    emit(parser, "JUMPIFEQ $%%str%%int GF@%%r1 string@int\n");
+    emit(parser, "JUMPIFEQ $%%str%%float GF@%%r1 string@float\n");
+    emit(parser, "JUMPIFEQ $%%str%%nil GF@%%r1 string@nil\n");
+    emit(parser, "JUMPIFEQ $%%str%%bool GF@%%r1 string@bool\n");
+    emit(parser, "JUMPIFNEQ $%%str%%type GF@%%r1 string@string\n");
+    emit(parser, "PUSHS GF@%%r0\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%str%%type\n");
+    emit(parser, "EXIT int@%d\n", BUILTIN_TYPE_ERROR);
+    emit(parser, "LABEL $%%str%%nil\n");
+    emit(parser, "PUSHS string@null\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%str%%bool\n");
+    emit(parser, "JUMPIFEQ $%%str%%false GF@%%r0 bool@false\n");
+    emit(parser, "PUSHS string@true\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%str%%false\n");
+    emit(parser, "PUSHS string@false\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%str%%int\n");
+    emit(parser, "CALL $%%str%%itoa\n");
+    emit(parser, "PUSHS GF@%%r2\n");
+    emit(parser, "RETURN\n");
+    
+    // Integral floats are printed as integers
+    emit(parser, "LABEL $%%str%%float\n");
+    emit(parser, "FLOAT2INT GF@%%r1 GF@%%r0\n");
+    emit(parser, "INT2FLOAT GF@%%r3 GF@%%r1\n");
+    emit(parser, "JUMPIFNEQ $%%str%%frac GF@%%r3 GF@%%r0\n");
+    emit(parser, "MOVE GF@%%r0 GF@%%r1\n");
+    emit(parser, "JUMP $%%str%%int\n");
+    
+    // Sign, integer part, then fraction digits without trailing zeros
+    emit(parser, "LABEL $%%str%%frac\n");
+    emit(parser, "MOVE GF@%%r5 GF@%%r0\n");
+    emit(parser, "MOVE GF@%%r6 string@\n");
+    emit(parser, "LT GF@%%r1 GF@%%r5 float@0x0p+0\n");
+    emit(parser, "JUMPIFEQ $%%str%%fpos GF@%%r1 bool@false\n");
+    emit(parser, "SUB GF@%%r5 float@0x0p+0 GF@%%r5\n");
+    emit(parser, "MOVE GF@%%r6 string@-\n");
+    emit(parser, "LABEL $%%str%%fpos\n");
+    emit(parser, "FLOAT2INT GF@%%r0 GF@%%r5\n");
+    emit(parser, "INT2FLOAT GF@%%r1 GF@%%r0\n");
+    emit(parser, "SUB GF@%%r5 GF@%%r5 GF@%%r1\n");
+    emit(parser, "CALL $%%str%%itoa\n");
+    emit(parser, "CONCAT GF@%%r6 GF@%%r6 GF@%%r2\n");
+    emit(parser, "CONCAT GF@%%r6 GF@%%r6 string@.\n");
+    emit(parser, "MOVE GF@%%r2 string@\n");
+    emit(parser, "MOVE GF@%%r4 int@6\n");
+    emit(parser, "LABEL $%%str%%fdigit\n");
+    emit(parser, "MUL GF@%%r5 GF@%%r5 float@0x1.4p+3\n");
+    emit(parser, "FLOAT2INT GF@%%r3 GF@%%r5\n");
+    emit(parser, "INT2FLOAT GF@%%r1 GF@%%r3\n");
+    emit(parser, "SUB GF@%%r5 GF@%%r5 GF@%%r1\n");
+    emit(parser, "ADD GF@%%r3 GF@%%r3 int@48\n");
+    emit(parser, "INT2CHAR GF@%%r3 GF@%%r3\n");
+    emit(parser, "CONCAT GF@%%r2 GF@%%r2 GF@%%r3\n");
+    emit(parser, "JUMPIFEQ $%%str%%fzero GF@%%r3 string@0\n");
+    emit(parser, "CONCAT GF@%%r6 GF@%%r6 GF@%%r2\n");
+    emit(parser, "MOVE GF@%%r2 string@\n");
+    emit(parser, "LABEL $%%str%%fzero\n");
+    emit(parser, "SUB GF@%%r4 GF@%%r4 int@1\n");
+    emit(parser, "JUMPIFNEQ $%%str%%fdigit GF@%%r4 int@0\n");
+    emit(parser, "PUSHS GF@%%r6\n");
+    emit(parser, "RETURN\n");
+    
+    // GF@%r0 (int) -> GF@%r2 (decimal string), uses GF@%r1, GF@%r3, GF@%r4
+    emit(parser, "LABEL $%%str%%itoa\n");
+    emit(parser, "MOVE GF@%%r2 string@\n");
+    emit(parser, "LT GF@%%r4 GF@%%r0 int@0\n");
+    emit(parser, "JUMPIFEQ $%%str%%digit GF@%%r4 bool@false\n");
+    emit(parser, "SUB GF@%%r0 int@0 GF@%%r0\n");
+    emit(parser, "LABEL $%%str%%digit\n");
+    emit(parser, "IDIV GF@%%r1 GF@%%r0 int@10\n");
+    emit(parser, "MUL GF@%%r3 GF@%%r1 int@10\n");
+    emit(parser, "SUB GF@%%r3 GF@%%r0 GF@%%r3\n");
+    emit(parser, "ADD GF@%%r3 GF@%%r3 int@48\n");
+    emit(parser, "INT2CHAR GF@%%r3 GF@%%r3\n");
+    emit(parser, "CONCAT GF@%%r2 GF@%%r3 GF@%%r2\n");
+    emit(parser, "MOVE GF@%%r0 GF@%%r1\n");
+    emit(parser, "JUMPIFNEQ $%%str%%digit GF@%%r0 int@0\n");
+    emit(parser, "JUMPIFEQ $%%str%%unsigned GF@%%r4 bool@false\n");
+    emit(parser, "CONCAT GF@%%r2 string@- GF@%%r2\n");
+    emit(parser, "LABEL $%%str%%unsigned\n");
+    emit(parser, "RETURN\n");
+}
+
+// Ifj.substring(s, i, j): characters i..j-1, null for invalid indices
+static void generate_helper_substring(Parser* parser) {
+    emit(parser, "LABEL $%%substring\n");
+    emit(parser, "POPS GF@%%r2\n");
+    emit(parser, "POPS GF@%%r1\n");
+    emit(parser, "POPS GF@%%r0\n");
+    emit(parser, "LT GF@%%r3 GF@%%r1 int@0\n");
+    emit(parser, "JUMPIFEQ $%%substring%%null GF@%%r3 bool@true\n");
+    emit(parser, "LT GF@%%r3 GF@%%r2 int@0\n");
+    emit(parser, "JUMPIFEQ $%%substring%%null GF@%%r3 bool@true\n");
+    emit(parser, "GT GF@%%r3 GF@%%r1 GF@%%r2\n");
+    emit(parser, "JUMPIFEQ $%%substring%%null GF@%%r3 bool@true\n");
+    emit(parser, "STRLEN GF@%%r4 GF@%%r0\n");
+    emit(parser, "LT GF@%%r3 GF@%%r1 GF@%%r4\n");
+    emit(parser, "JUMPIFEQ $%%substring%%null GF@%%r3 bool@false\n");
+    emit(parser, "GT GF@%%r3 GF@%%r2 GF@%%r4\n");
+    emit(parser, "JUMPIFEQ $%%substring%%null GF@%%r3 bool@true\n");
+    emit(parser, "MOVE GF@%%r5 string@\n");
+    emit(parser, "LABEL $%%substring%%loop\n");
+    emit(parser, "JUMPIFEQ $%%substring%%done GF@%%r1 GF@%%r2\n");
+    emit(parser, "GETCHAR GF@%%r4 GF@%%r0 GF@%%r1\n");
+    emit(parser, "CONCAT GF@%%r5 GF@%%r5 GF@%%r4\n");
+    emit(parser, "ADD GF@%%r1 GF@%%r1 int@1\n");
+    emit(parser, "JUMP $%%substring%%loop\n");
+    emit(parser, "LABEL $%%substring%%done\n");
+    emit(parser, "PUSHS GF@%%r5\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%substring%%null\n");
+    emit(parser, "PUSHS nil@nil\n");
+    emit(parser, "RETURN\n");
+}
+
+// Ifj.strcmp(s1, s2): -1, 0 or 1
+static void generate_helper_strcmp(Parser* parser) {
+    emit(parser, "LABEL $%%strcmp\n");
+    emit(parser, "POPS GF@%%r1\n");
+    emit(parser, "POPS GF@%%r0\n");
+    emit(parser, "JUMPIFEQ $%%strcmp%%eq GF@%%r0 GF@%%r1\n");
+    emit(parser, "LT GF@%%r2 GF@%%r0 GF@%%r1\n");
+    emit(parser, "JUMPIFEQ $%%strcmp%%lt GF@%%r2 bool@true\n");
+    emit(parser, "PUSHS int@1\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%strcmp%%lt\n");
+    emit(parser, "PUSHS int@-1\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%strcmp%%eq\n");
+    emit(parser, "PUSHS int@0\n");
+    emit(parser, "RETURN\n");
+}
+
+// Ifj.ord(s, i): ASCII value of i-th character, 0 when out of range
+static void generate_helper_ord(Parser* parser) {
+    emit(parser, "LABEL $%%ord\n");
+    emit(parser, "POPS GF@%%r1\n");
+    emit(parser, "POPS GF@%%r0\n");
+    emit(parser, "LT GF@%%r2 GF@%%r1 int@0\n");
+    emit(parser, "JUMPIFEQ $%%ord%%zero GF@%%r2 bool@true\n");
+    emit(parser, "STRLEN GF@%%r2 GF@%%r0\n");
+    emit(parser, "LT GF@%%r2 GF@%%r1 GF@%%r2\n");
+    emit(parser, "JUMPIFEQ $%%ord%%zero GF@%%r2 bool@false\n");
+    emit(parser, "STRI2INT GF@%%r2 GF@%%r0 GF@%%r1\n");
+    emit(parser, "PUSHS GF@%%r2\n");
+    emit(parser, "RETURN\n");
+    emit(parser, "LABEL $%%ord%%zero\n");
+    emit(parser, "PUSHS int@0\n");
+    emit(parser, "RETURN\n");
+}
+
+/**
+ * Generates helper routines used by the program
+ * @param parser parser with output and set of used helpers
+ */
+void generate_builtin_helpers(Parser* parser) {
+    if (parser->used_helpers & HELPER_FLOOR) generate_helper_floor(parser);
+    if (parser->used_helpers & HELPER_STR) generate_helper_str(parser);
+    if (parser->used_helpers & HELPER_SUBSTRING) generate_helper_substring(parser);
+    if (parser->used_helpers & HELPER_STRCMP) generate_helper_strcmp(parser);
+    if (parser->used_helpers & HELPER_ORD) generate_helper_ord(parser);
+}
@@ -0,0 +1,53 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * builtins.h
+ * lowering of Ifj built-in functions
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include "parser.h"
+#include <stdbool.h>
+
+// Helper routines shared by built-ins that need more than a few instructions
+typedef enum {
+    HELPER_FLOOR     = 1 << 0,
+    HELPER_STR       = 1 << 1,
+    HELPER_SUBSTRING = 1 << 2,
+    HELPER_STRCMP    = 1 << 3,
+    HELPER_ORD       = 1 << 4
+} BuiltinHelper;
+
+// Built-in function handling (name with or without the Ifj. prefix)
+bool is_builtin_function(const char* name);
+int get_builtin_arity(const char* name);
+
+// Generates code for a built-in call, arguments are already on the stack
+void generate_builtin_call(Parser* parser, const char* name, bool use_result);
+
+// Evaluates pure built-in with constant arguments at compile time
+bool fold_builtin_call(const char* name, const ConstValue* args, int arg_count, ConstValue* result);
+
+// Generates Ifj.write of a constant, merged with preceding literal write
+void generate_write_constant(Parser* parser, const ConstValue* value);
+
+// Checks if a built-in returns a string
+bool builtin_returns_string(const char* name);
+
+// Checks if a built-in always returns a string, never nil
+bool builtin_always_string(const char* name);
+
+// Replaces concatenation passed to Ifj.write by writes of its parts, false if
+// the argument starting at index start is not a concatenation
+bool generate_write_concat(Parser* parser, int start);
+
+// Generates helper routines used by the program
+void generate_builtin_helpers(Parser* parser);
+
+#endif // BUILTINS_H
@@ -0,0 +1,300 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * cfg.c
+ * control flow graph and dominator tree of a routine
+ *
+ * A block starts at a label and after a jump, RETURN or EXIT. Jumps to
+ * labels outside the routine (a routine never jumps into another one) and
+ * CALLs do not make edges. Lists of predecessors and children in the
+ * dominator tree of all blocks are kept in two shared arrays, blocks refer
+ * to them by index.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "cfg.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Label starting a block
+typedef struct {
+    const char* name;
+    int block;
+} BlockLabel;
+
+/**
+ * Checks if label starts a routine, labels of helpers start with $% and
+ * labels inside routines contain another %
+ * @param instr instruction
+ * @return true for the first instruction of a routine
+ */
+bool cfg_is_routine_label(const Instr* instr) {
+    if (!instr_is(instr, "LABEL") || instr->argc != 1 || instr->args[0][0] != '$') {
+        return false;
+    }
+    const char* name = instr->args[0] + 1;
+    if (*name == '%') name++;
+    return strchr(name, '%') == NULL;
+}
+
+// Checks if the instruction ends a block
+static bool ends_block(const Instr* instr) {
+    return strncmp(instr->op, "JUMP", 4) == 0 || instr_is(instr, "RETURN") || instr_is(instr, "EXIT");
+}
+
+static int compare_labels(const void* a, const void* b) {
+    return strcmp(((const BlockLabel*)a)->name, ((const BlockLabel*)b)->name);
+}
+
+// Block starting with the label, -1 if it is not in the routine
+static int find_label_block(const BlockLabel* labels, int count, const char* name) {
+    BlockLabel key = {name, -1};
+    const BlockLabel* found = count > 0 ? bsearch(&key, labels, count, sizeof(BlockLabel), compare_labels) : NULL;
+    return found ? found->block : -1;
+}
+
+// Splits code into blocks and finds their successors
+static bool split_blocks(Cfg* cfg) {
+    InstrList* code = cfg->code;
+    int count = 0;
+    for (int i = cfg->first; i < cfg->last; i++) {
+        if (i == cfg->first || instr_is(&code->items[i], "LABEL") || ends_block(&code->items[i - 1])) count++;
+    }
+    
+    cfg->blocks = calloc(count > 0 ? count : 1, sizeof(CfgBlock));
+    BlockLabel* labels = malloc((count > 0 ? count : 1) * sizeof(BlockLabel));
+    if (!cfg->blocks || !labels) {
+        free(labels);
+        return false;
+    }
+    cfg->block_count = count;
+    
+    int b = -1;
+    int label_count = 0;
+    for (int i = cfg->first; i < cfg->last; i++) {
+        const Instr* instr = &code->items[i];
+        if (i == cfg->first || instr_is(instr, "LABEL") || ends_block(&code->items[i - 1])) {
+            cfg->blocks[++b].start = i;
+            if (instr_is(instr, "LABEL")) {
+                labels[label_count++] = (BlockLabel){instr->args[0], b};
+            }
+        }
+        cfg->blocks[b].end = i + 1;
+    }
+    qsort(labels, label_count, sizeof(BlockLabel), compare_labels);
+    
+    for (int i = 0; i < count; i++) {
+        CfgBlock* block = &cfg->blocks[i];
+        const Instr* instr = &code->items[block->end - 1];
+        if (strncmp(instr->op, "JUMP", 4) == 0) {
+            int target = find_label_block(labels, label_count, instr->args[0]);
+            if (target >= 0) block->succ[block->succ_count++] = target;
+        }
+        bool falls = !instr_is(instr, "JUMP") && !instr_is(instr, "RETURN") && !instr_is(instr, "EXIT");
+        if (falls && i + 1 < count && (block->succ_count == 0 || block->succ[0] != i + 1)) {
+            block->succ[block->succ_count++] = i + 1;
+        }
+        block->idom = -1;
+        block->order = -1;
+    }
+    free(labels);
+    return true;
+}
+
+// Fills predecessor lists
+static bool link_predecessors(Cfg* cfg) {
+    int edges = 0;
+    for (int i = 0; i < cfg->block_count; i++) {
+        edges += cfg->blocks[i].succ_count;
+    }
+    cfg->preds = malloc((edges > 0 ? edges : 1) * sizeof(int));
+    if (!cfg->preds) return false;
+    
+    for (int i = 0; i < cfg->block_count; i++) {
+        for (int j = 0; j < cfg->blocks[i].succ_count; j++) {
+            cfg->blocks[cfg->blocks[i].succ[j]].pred_count++;
+        }
+    }
+    int next = 0;
+    for (int i = 0; i < cfg->block_count; i++) {
+        cfg->blocks[i].preds = next;
+        next += cfg->blocks[i].pred_count;
+        cfg->blocks[i].pred_count = 0;
+    }
+    for (int i = 0; i < cfg->block_count; i++) {
+        for (int j = 0; j < cfg->blocks[i].succ_count; j++) {
+            CfgBlock* succ = &cfg->blocks[cfg->blocks[i].succ[j]];
+            cfg->preds[succ->preds + succ->pred_count++] = i;
+        }
+    }
+    return true;
+}
+
+// Orders reachable blocks in reverse postorder
+static bool order_blocks(Cfg* cfg) {
+    int n = cfg->block_count;
+    cfg->rpo = malloc((n > 0 ? n : 1) * sizeof(int));
+    int* stack = malloc((n > 0 ? n : 1) * sizeof(int));
+    int* next_succ = calloc(n > 0 ? n : 1, sizeof(int));
+    bool* seen = calloc(n > 0 ? n : 1, sizeof(bool));
+    bool ok = cfg->rpo && stack && next_succ && seen;
+    
+    // Depth-first search, blocks are finished in postorder
+    int reachable = 0;
+    int top = 0;
+    if (ok && n > 0) {
+        stack[top++] = 0;
+        seen[0] = true;
+    }
+    while (ok && top > 0) {
+        const CfgBlock* block = &cfg->blocks[stack[top - 1]];
+        if (next_succ[stack[top - 1]] < block->succ_count) {
+            int succ = block->succ[next_succ[stack[top - 1]]++];
+            if (!seen[succ]) {
+                seen[succ] = true;
+                stack[top++] = succ;
+            }
+        } else {
+            cfg->rpo[reachable++] = stack[--top];
+        }
+    }
+    for (int i = 0; i < reachable / 2; i++) {
+        int swap = cfg->rpo[i];
+        cfg->rpo[i] = cfg->rpo[reachable - 1 - i];
+        cfg->rpo[reachable - 1 - i] = swap;
+    }
+    for (int i = 0; i < reachable; i++) {
+        cfg->blocks[cfg->rpo[i]].order = i;
+    }
+    cfg->reachable = reachable;
+    
+    free(stack);
+    free(next_succ);
+    free(seen);
+    return ok;
+}
+
+// Immediate dominators, iterated in reverse postorder until nothing changes
+static void find_dominators(Cfg* cfg) {
+    if (cfg->reachable == 0) return;
+    
+    CfgBlock* blocks = cfg->blocks;
+    blocks[0].idom = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 1; i < cfg->reachable; i++) {
+            CfgBlock* block = &blocks[cfg->rpo[i]];
+            int idom = -1;
+            for (int j = 0; j < block->pred_count; j++) {
+                int pred = cfg->preds[block->preds + j];
+                if (blocks[pred].idom < 0) continue;
+                if (idom < 0) {
+                    idom = pred;
+                    continue;
+                }
+                int a = pred;
+                int b = idom;
+                while (a != b) {
+                    while (blocks[a].order > blocks[b].order) a = blocks[a].idom;
+                    while (blocks[b].order > blocks[a].order) b = blocks[b].idom;
+                }
+                idom = a;
+            }
+            if (idom != block->idom) {
+                block->idom = idom;
+                changed = true;
+            }
+        }
+    }
+    blocks[0].idom = -1;
+}
+
+// Fills children lists of the dominator tree, children in reverse postorder
+static bool link_children(Cfg* cfg) {
+    cfg->children = malloc((cfg->reachable > 0 ? cfg->reachable : 1) * sizeof(int));
+    if (!cfg->children) return false;
+    
+    for (int i = 1; i < cfg->reachable; i++) {
+        cfg->blocks[cfg->blocks[cfg->rpo[i]].idom].child_count++;
+    }
+    int next = 0;
+    for (int i = 0; i < cfg->block_count; i++) {
+        cfg->blocks[i].children = next;
+        next += cfg->blocks[i].child_count;
+        cfg->blocks[i].child_count = 0;
+    }
+    for (int i = 1; i < cfg->reachable; i++) {
+        CfgBlock* parent = &cfg->blocks[cfg->blocks[cfg->rpo[i]].idom];
+        cfg->children[parent->children + parent->child_count++] = cfg->rpo[i];
+    }
+    return true;
+}
+
+/**
+ * Builds control flow graph and dominator tree of a routine
+ * @param cfg filled graph, freed by cfg_free even on failure
+ * @param code program
+ * @param first first instruction of the routine
+ * @param last one past the last instruction of the routine
+ * @return true on success, false on allocation failure
+ */
+bool cfg_build(Cfg* cfg, InstrList* code, int first, int last) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->code = code;
+    cfg->first = first;
+    cfg->last = last;
+    if (!split_blocks(cfg) || !link_predecessors(cfg) || !order_blocks(cfg)) return false;
+    find_dominators(cfg);
+    return link_children(cfg);
+}
+
+/**
+ * Finds block of an instruction of the routine
+ * @param cfg graph
+ * @param index instruction, first <= index < last
+ * @return index of the block
+ */
+int cfg_block_of(const Cfg* cfg, int index) {
+    int low = 0;
+    int high = cfg->block_count - 1;
+    while (low < high) {
+        int middle = (low + high + 1) / 2;
+        if (cfg->blocks[middle].start <= index) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+/**
+ * Checks dominance of blocks, unreachable blocks are dominated by nothing
+ * @param cfg graph
+ * @param a dominating block
+ * @param b dominated block
+ * @return true if a dominates b, a block dominates itself
+ */
+bool cfg_dominates(const Cfg* cfg, int a, int b) {
+    if (cfg->blocks[a].order < 0 || cfg->blocks[b].order < 0) return false;
+    while (b > 0 && b != a && cfg->blocks[b].order > cfg->blocks[a].order) {
+        b = cfg->blocks[b].idom;
+    }
+    return b == a;
+}
+
+/**
+ * Frees the graph
+ * @param cfg graph built by cfg_build
+ */
+void cfg_free(Cfg* cfg) {
+    free(cfg->blocks);
+    free(cfg->preds);
+    free(cfg->children);
+    free(cfg->rpo);
+    memset(cfg, 0, sizeof(*cfg));
+}
@@ -0,0 +1,62 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * cfg.h
+ * control flow graph and dominator tree of a routine
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef CFG_H
+#define CFG_H
+
+#include "ilist.h"
+#include <stdbool.h>
+
+// Basic block, lists of blocks are ranges of the arrays of its graph
+typedef struct {
+    int start;
+    int end;             // one past the last instruction
+    int succ[2];
+    int succ_count;
+    int preds;           // first predecessor in Cfg.preds
+    int pred_count;
+    int children;        // first child in the dominator tree in Cfg.children
+    int child_count;
+    int idom;            // -1 for the entry and unreachable blocks
+    int order;           // position in reverse postorder, -1 if unreachable
+} CfgBlock;
+
+// Blocks of the routine code first..last, the first block is the entry
+typedef struct {
+    InstrList* code;
+    int first;
+    int last;
+    CfgBlock* blocks;
+    int block_count;
+    int* preds;
+    int* children;
+    int* rpo;            // reachable blocks in reverse postorder
+    int reachable;
+} Cfg;
+
+// Checks if label starts a routine, labels inside routines contain another %
+bool cfg_is_routine_label(const Instr* instr);
+
+// Splits routine code first..last into blocks, connects them and finds their
+// immediate dominators (Cooper, Harvey, Kennedy). Code must not change while
+// the graph is used.
+bool cfg_build(Cfg* cfg, InstrList* code, int first, int last);
+
+// Block containing the instruction
+int cfg_block_of(const Cfg* cfg, int index);
+
+// Checks if every path from the entry to block b goes through block a
+bool cfg_dominates(const Cfg* cfg, int a, int b);
+
+// Free the graph
+void cfg_free(Cfg* cfg);
+
+#endif // CFG_H
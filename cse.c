@@ -0,0 +1,662 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * cse.c
+ * elimination of repeated computations
+ *
+ * Routines are split into basic blocks and the data stack of each block is
+ * simulated. Every value gets a number, the same operation on the same
+ * numbers gives the same value. A block starts with the values known at the
+ * end of its immediate dominator, except the variables written on some path
+ * between the two. A computation that was done before is replaced by reading
+ * a variable that still holds the value, or a temporary the first
+ * computation stores it to. A write gives the variable a new number, calls
+ * and frame changes forget all values.
+ *
+ * No value outlives a call of another routine, so every routine numbers its
+ * temporaries from 0 and all share them. Values do outlive calls of helpers
+ * of built-ins, which therefore are left alone.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "cse.h"
+#include "cfg.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Values of larger routines are used only within their blocks
+#define CSE_MAX_BLOCKS 1000
+
+// Value number of a variable or constant
+typedef struct {
+    const char* name;    // operand, owned by the instruction
+    int vn;
+} Binding;
+
+// Operation on value numbers
+typedef struct {
+    const char* op;
+    int a;
+    int b;               // -1 for unary operations
+    int vn;
+    int site;            // first computation
+} Expr;
+
+// Values known at a point of the routine
+typedef struct {
+    Binding* vars;
+    int var_count;
+    int var_capacity;
+    Expr* exprs;
+    int expr_count;
+    int expr_capacity;
+} State;
+
+// First computation of a value, stored to a temporary once it is reused
+typedef struct {
+    int start;
+    int end;             // last instruction
+    int temp;            // -1 while not needed
+} Site;
+
+// Value on the simulated data stack
+typedef struct {
+    bool known;
+    int vn;
+    int start;           // instructions computing the value
+    int end;
+    bool movable;        // start..end only computes the value
+    bool reuse;          // computed before, at site or held by holder
+    int site;
+    const char* holder;
+} Slot;
+
+// Change of the code, applied once the routine is analysed
+typedef struct {
+    int position;        // first replaced instruction, or where to insert
+    int end;             // last replaced instruction, position - 1 for insertion
+    char* lines[2];
+    int line_count;
+} Edit;
+
+// Analysis of a routine
+typedef struct {
+    InstrList* code;
+    Cfg cfg;
+    State* outs;         // values at the end of each block
+    Binding* constants;
+    int constant_count;
+    int constant_capacity;
+    Site* sites;
+    int site_count;
+    int site_capacity;
+    Slot* stack;
+    int stack_count;
+    int stack_capacity;
+    Edit* edits;
+    int edit_count;
+    int edit_capacity;
+    int next_vn;
+    int temp_count;      // temporaries of the routine, GF@%cse0 and so on
+    bool local;          // values are not inherited from dominators
+    bool ok;
+} Cse;
+
+static const char* const binary_ops[] = {
+    "ADDS", "SUBS", "MULS", "DIVS", "IDIVS", "LTS", "GTS", "EQS", "ANDS", "ORS", "STRI2INTS", NULL
+};
+static const char* const commutative_ops[] = {"ADDS", "MULS", "EQS", "ANDS", "ORS", NULL};
+static const char* const unary_ops[] = {"NOTS", "INT2FLOATS", "FLOAT2INTS", "INT2CHARS", NULL};
+
+// Operations of built-ins lowered to POPS x, OP x x, PUSHS x
+static const char* const scratch_ops[] = {"STRLEN", "INT2CHAR", "INT2FLOAT", "FLOAT2INT", "TYPE", NULL};
+
+// Instructions with a first operand they do not write
+static const char* const reading_ops[] = {
+    "PUSHS", "WRITE", "EXIT", "DPRINT", "LABEL", "CALL",
+    "JUMP", "JUMPIFEQ", "JUMPIFNEQ", "JUMPIFEQS", "JUMPIFNEQS", NULL
+};
+
+// Checks if op is in the NULL terminated list
+static bool op_in(const char* op, const char* const* list) {
+    for (int i = 0; list[i]; i++) {
+        if (strcmp(op, list[i]) == 0) return true;
+    }
+    return false;
+}
+
+// Checks if operand is a variable
+static bool is_variable(const char* operand) {
+    return strncmp(operand, "GF@", 3) == 0 || strncmp(operand, "LF@", 3) == 0 || strncmp(operand, "TF@", 3) == 0;
+}
+
+// Scratch registers of built-ins and calls, never kept as holders
+static bool is_scratch(const char* operand) {
+    return strncmp(operand, "GF@%", 4) == 0;
+}
+
+// Checks if the instruction makes all known values invalid
+static bool forgets_all(const Instr* instr) {
+    if (instr_is(instr, "CALL")) {
+        return strncmp(instr->args[0], "$%", 2) != 0;
+    }
+    return instr_is(instr, "CREATEFRAME") || instr_is(instr, "PUSHFRAME") || instr_is(instr, "POPFRAME");
+}
+
+// Checks if the instruction writes its first operand
+static bool writes_first(const Instr* instr) {
+    return instr->argc > 0 && is_variable(instr->args[0]) && !op_in(instr->op, reading_ops);
+}
+
+// Grows array of items of given size so one more fits
+static bool reserve(void** items, int count, int* capacity, size_t size) {
+    if (count < *capacity) return true;
+    
+    int new_capacity = *capacity ? *capacity * 2 : 16;
+    void* new_items = realloc(*items, new_capacity * size);
+    if (!new_items) return false;
+    *items = new_items;
+    *capacity = new_capacity;
+    return true;
+}
+
+static void state_free(State* state) {
+    free(state->vars);
+    free(state->exprs);
+    *state = (State){NULL, 0, 0, NULL, 0, 0};
+}
+
+// Copies src to empty dst
+static bool state_copy(State* dst, const State* src) {
+    *dst = (State){NULL, 0, 0, NULL, 0, 0};
+    if (src->var_count > 0) {
+        dst->vars = malloc(src->var_count * sizeof(Binding));
+        if (!dst->vars) return false;
+        memcpy(dst->vars, src->vars, src->var_count * sizeof(Binding));
+        dst->var_count = dst->var_capacity = src->var_count;
+    }
+    if (src->expr_count > 0) {
+        dst->exprs = malloc(src->expr_count * sizeof(Expr));
+        if (!dst->exprs) return false;
+        memcpy(dst->exprs, src->exprs, src->expr_count * sizeof(Expr));
+        dst->expr_count = dst->expr_capacity = src->expr_count;
+    }
+    return true;
+}
+
+// Binding of a name in the list or NULL
+static Binding* find_binding(Binding* items, int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(items[i].name, name) == 0) return &items[i];
+    }
+    return NULL;
+}
+
+// Gives variable the value number
+static void bind(Cse* cse, State* state, const char* name, int vn) {
+    Binding* binding = find_binding(state->vars, state->var_count, name);
+    if (binding) {
+        binding->vn = vn;
+    } else if (reserve((void**)&state->vars, state->var_count, &state->var_capacity, sizeof(Binding))) {
+        state->vars[state->var_count++] = (Binding){name, vn};
+    } else {
+        cse->ok = false;
+    }
+}
+
+// Variable gets a value nothing else has
+static void forget(Cse* cse, State* state, const char* name) {
+    bind(cse, state, name, cse->next_vn++);
+}
+
+// Built-in helpers may change all scratch registers
+static void forget_scratch(Cse* cse, State* state) {
+    for (int i = 0; i < state->var_count; i++) {
+        if (is_scratch(state->vars[i].name)) {
+            state->vars[i].vn = cse->next_vn++;
+        }
+    }
+}
+
+// Value number of an operand, first use of a name gets a new one
+static int value_of(Cse* cse, State* state, const char* operand) {
+    if (is_variable(operand)) {
+        Binding* binding = find_binding(state->vars, state->var_count, operand);
+        if (binding) return binding->vn;
+        int vn = cse->next_vn++;
+        bind(cse, state, operand, vn);
+        return vn;
+    }
+    
+    // Constants keep their number in the whole routine
+    Binding* binding = find_binding(cse->constants, cse->constant_count, operand);
+    if (binding) return binding->vn;
+    if (!reserve((void**)&cse->constants, cse->constant_count, &cse->constant_capacity, sizeof(Binding))) {
+        cse->ok = false;
+        return -1;
+    }
+    cse->constants[cse->constant_count] = (Binding){operand, cse->next_vn++};
+    return cse->constants[cse->constant_count++].vn;
+}
+
+// Variable holding the value, NULL if there is none
+static const char* holder_of(const State* state, int vn) {
+    for (int i = 0; i < state->var_count; i++) {
+        if (state->vars[i].vn == vn && !is_scratch(state->vars[i].name)) {
+            return state->vars[i].name;
+        }
+    }
+    return NULL;
+}
+
+static Expr* find_expr(State* state, const char* op, int a, int b) {
+    for (int i = 0; i < state->expr_count; i++) {
+        Expr* expr = &state->exprs[i];
+        if (expr->a == a && expr->b == b && strcmp(expr->op, op) == 0) return expr;
+    }
+    return NULL;
+}
+
+static void push_slot(Cse* cse, Slot slot) {
+    if (!reserve((void**)&cse->stack, cse->stack_count, &cse->stack_capacity, sizeof(Slot))) {
+        cse->ok = false;
+        return;
+    }
+    cse->stack[cse->stack_count++] = slot;
+}
+
+// Pops simulated value, values pushed before the block are unknown
+static Slot pop_slot(Cse* cse) {
+    if (cse->stack_count == 0) {
+        return (Slot){false, -1, -1, -1, false, false, -1, NULL};
+    }
+    return cse->stack[--cse->stack_count];
+}
+
+// Copy of a line, NULL for NULL or on allocation failure
+static char* copy_line(const char* line) {
+    if (!line) return NULL;
+    char* copy = malloc(strlen(line) + 1);
+    if (copy) strcpy(copy, line);
+    return copy;
+}
+
+// Records edit replacing instructions start..end, or inserting before start if end < start
+static void add_edit(Cse* cse, int start, int end, const char* first, const char* second) {
+    if (!reserve((void**)&cse->edits, cse->edit_count, &cse->edit_capacity, sizeof(Edit))) {
+        cse->ok = false;
+        return;
+    }
+    Edit edit = {start, end, {copy_line(first), copy_line(second)}, second ? 2 : 1};
+    if (!edit.lines[0] || (second && !edit.lines[1])) {
+        free(edit.lines[0]);
+        free(edit.lines[1]);
+        cse->ok = false;
+        return;
+    }
+    cse->edits[cse->edit_count++] = edit;
+}
+
+// Replaces repeated computation of a value that is not used as an operand of another one
+static void commit(Cse* cse, const Slot* slot) {
+    int length = slot->end - slot->start + 1;
+    if (!slot->reuse || !slot->movable || length < 2) return;
+    
+    char line[300];
+    if (slot->holder) {
+        snprintf(line, sizeof(line), "PUSHS %s", slot->holder);
+        add_edit(cse, slot->start, slot->end, line, NULL);
+        return;
+    }
+    
+    // Storing a value costs two instructions, PUSHS a, PUSHS b, OPS becomes OP t a b, PUSHS t
+    Site* site = &cse->sites[slot->site];
+    if (site->temp < 0) {
+        bool rewritable = site->end - site->start == 2 && op_in(cse->code->items[site->end].op, binary_ops);
+        if (!rewritable && length < 4) return;
+        site->temp = cse->temp_count++;
+    }
+    snprintf(line, sizeof(line), "PUSHS %s%d", CSE_TEMP_PREFIX, site->temp);
+    add_edit(cse, slot->start, slot->end, line, NULL);
+}
+
+static void commit_stack(Cse* cse) {
+    for (int i = 0; i < cse->stack_count; i++) {
+        commit(cse, &cse->stack[i]);
+    }
+    cse->stack_count = 0;
+}
+
+/**
+ * Simulates operation on one or two values from the stack
+ * @param cse analysis
+ * @param state values known before the operation
+ * @param op operation
+ * @param unary operation takes one value
+ * @param end last instruction of the operation
+ * @return value number of the result or -1 if it is unknown
+ */
+static int compute(Cse* cse, State* state, const char* op, bool unary, int end) {
+    Slot b = unary ? (Slot){true, -1, end, end, true, false, -1, NULL} : pop_slot(cse);
+    Slot a = pop_slot(cse);
+    if (!a.known || !b.known) {
+        commit(cse, &a);
+        commit(cse, &b);
+        push_slot(cse, (Slot){false, -1, -1, -1, false, false, -1, NULL});
+        return -1;
+    }
+    
+    // Operands are computed by the code right before, nothing else is in between
+    bool movable = a.movable && b.movable && (unary || a.end + 1 == b.start);
+    int va = a.vn;
+    int vb = unary ? -1 : b.vn;
+    if (op_in(op, commutative_ops) && va > vb) {
+        int swap = va;
+        va = vb;
+        vb = swap;
+    }
+    
+    Expr* expr = find_expr(state, op, va, vb);
+    if (expr && movable) {
+        push_slot(cse, (Slot){true, expr->vn, a.start, end, true, true, expr->site, holder_of(state, expr->vn)});
+        return expr->vn;
+    }
+    
+    commit(cse, &a);
+    if (!unary) commit(cse, &b);
+    if (expr) {
+        push_slot(cse, (Slot){true, expr->vn, a.start, end, false, false, -1, NULL});
+        return expr->vn;
+    }
+    
+    // First computation of the value
+    int vn = cse->next_vn++;
+    if (!reserve((void**)&cse->sites, cse->site_count, &cse->site_capacity, sizeof(Site)) ||
+        !reserve((void**)&state->exprs, state->expr_count, &state->expr_capacity, sizeof(Expr))) {
+        cse->ok = false;
+        return vn;
+    }
+    cse->sites[cse->site_count] = (Site){a.start, end, -1};
+    state->exprs[state->expr_count++] = (Expr){op, va, vb, vn, cse->site_count++};
+    push_slot(cse, (Slot){true, vn, a.start, end, movable, false, -1, NULL});
+    return vn;
+}
+
+// Checks for POPS x, OP x x, PUSHS x at index, returns OP or NULL
+static const char* scratch_operation(const InstrList* code, int index, int end) {
+    if (index + 2 >= end) return NULL;
+    
+    const Instr* pop = &code->items[index];
+    const Instr* op = &code->items[index + 1];
+    const Instr* push = &code->items[index + 2];
+    if (!instr_is(pop, "POPS") || !op_in(op->op, scratch_ops) || op->argc != 2 || !instr_is(push, "PUSHS")) {
+        return NULL;
+    }
+    const char* x = pop->args[0];
+    if (strcmp(op->args[0], x) != 0 || strcmp(op->args[1], x) != 0 || strcmp(push->args[0], x) != 0) {
+        return NULL;
+    }
+    return op->op;
+}
+
+// Values after an instruction that is not a computation on the stack
+static void simulate_other(Cse* cse, State* state, const Instr* instr) {
+    if (instr_is(instr, "POPS")) {
+        Slot slot = pop_slot(cse);
+        commit(cse, &slot);
+        if (slot.known) {
+            bind(cse, state, instr->args[0], slot.vn);
+        } else {
+            forget(cse, state, instr->args[0]);
+        }
+    } else if (instr_is(instr, "JUMPIFEQS") || instr_is(instr, "JUMPIFNEQS")) {
+        for (int i = 0; i < 2; i++) {
+            Slot slot = pop_slot(cse);
+            commit(cse, &slot);
+        }
+    } else if (instr_is(instr, "CALL") || instr_is(instr, "CLEARS")) {
+        commit_stack(cse);
+        if (!forgets_all(instr) && instr_is(instr, "CALL")) {
+            forget_scratch(cse, state);
+        }
+    } else if (instr_is(instr, "MOVE")) {
+        bind(cse, state, instr->args[0], value_of(cse, state, instr->args[1]));
+    } else if (writes_first(instr)) {
+        forget(cse, state, instr->args[0]);
+    }
+    
+    if (forgets_all(instr)) {
+        state->var_count = 0;
+        state->expr_count = 0;
+    }
+}
+
+// Numbers values of one block, state holds values at its start
+static void number_block(Cse* cse, const CfgBlock* block, State* state) {
+    InstrList* code = cse->code;
+    cse->stack_count = 0;
+    
+    for (int i = block->start; i < block->end && cse->ok; i++) {
+        const Instr* instr = &code->items[i];
+        const char* scratch_op;
+        if (instr_is(instr, "PUSHS")) {
+            int vn = value_of(cse, state, instr->args[0]);
+            push_slot(cse, (Slot){true, vn, i, i, true, false, -1, NULL});
+        } else if (op_in(instr->op, binary_ops)) {
+            compute(cse, state, instr->op, false, i);
+        } else if (op_in(instr->op, unary_ops)) {
+            compute(cse, state, instr->op, true, i);
+        } else if ((scratch_op = scratch_operation(code, i, block->end))) {
+            // Scratch register keeps the value only if the code stays
+            const char* x = instr->args[0];
+            int vn = compute(cse, state, scratch_op, true, i + 2);
+            if (vn >= 0 && !cse->stack[cse->stack_count - 1].reuse) {
+                bind(cse, state, x, vn);
+            } else {
+                forget(cse, state, x);
+            }
+            i += 2;
+        } else {
+            simulate_other(cse, state, instr);
+        }
+    }
+    commit_stack(cse);
+}
+
+// Writes of a block make values of the variables unknown
+static void forget_writes(Cse* cse, const CfgBlock* block, State* state) {
+    for (int i = block->start; i < block->end; i++) {
+        const Instr* instr = &cse->code->items[i];
+        if (forgets_all(instr)) {
+            state->var_count = 0;
+            state->expr_count = 0;
+        } else if (instr_is(instr, "CALL")) {
+            forget_scratch(cse, state);
+        } else if (writes_first(instr)) {
+            forget(cse, state, instr->args[0]);
+        }
+    }
+}
+
+/**
+ * Values known at the start of a block, those of the immediate dominator
+ * without variables written by blocks on some path from it to the block
+ * @param cse analysis
+ * @param index block
+ * @param state filled with the values
+ * @param marks scratch array, one item per block
+ */
+static void inherit_values(Cse* cse, int index, State* state, int* marks) {
+    const Cfg* cfg = &cse->cfg;
+    const CfgBlock* block = &cfg->blocks[index];
+    *state = (State){NULL, 0, 0, NULL, 0, 0};
+    if (block->idom < 0 || cse->local || cfg->block_count > CSE_MAX_BLOCKS) return;
+    if (!state_copy(state, &cse->outs[block->idom])) {
+        cse->ok = false;
+        return;
+    }
+    
+    // Forward from the dominator (bit 1) and backward from the block (bit 2), never through the dominator
+    int* work = malloc(cfg->block_count * sizeof(int));
+    if (!work) {
+        cse->ok = false;
+        return;
+    }
+    memset(marks, 0, cfg->block_count * sizeof(int));
+    for (int pass = 0; pass < 2; pass++) {
+        int bit = pass == 0 ? 1 : 2;
+        int count = 0;
+        work[count++] = pass == 0 ? block->idom : index;
+        while (count > 0) {
+            const CfgBlock* b = &cfg->blocks[work[--count]];
+            int next_count = pass == 0 ? b->succ_count : b->pred_count;
+            for (int i = 0; i < next_count; i++) {
+                int next = pass == 0 ? b->succ[i] : cfg->preds[b->preds + i];
+                if (next == block->idom || (marks[next] & bit)) continue;
+                marks[next] |= bit;
+                work[count++] = next;
+            }
+        }
+    }
+    free(work);
+    
+    for (int i = 0; i < cfg->block_count; i++) {
+        if (marks[i] == 3) {
+            forget_writes(cse, &cfg->blocks[i], state);
+        }
+    }
+}
+
+// Numbers values of one routine, code first..last
+static void number_routine(Cse* cse, int first, int last) {
+    cse->constant_count = 0;
+    cse->site_count = 0;
+    Cfg* cfg = &cse->cfg;
+    bool built = cfg_build(cfg, cse->code, first, last);
+    int count = cfg->block_count > 0 ? cfg->block_count : 1;
+    cse->outs = calloc(count, sizeof(State));
+    int* marks = malloc(count * sizeof(int));
+    if (!built || !cse->outs || !marks) {
+        cse->ok = false;
+    }
+    
+    // Dominators come first in reverse postorder, unreachable blocks are left alone
+    for (int i = 0; i < cfg->reachable && cse->ok; i++) {
+        State state;
+        inherit_values(cse, cfg->rpo[i], &state, marks);
+        number_block(cse, &cfg->blocks[cfg->rpo[i]], &state);
+        cse->outs[cfg->rpo[i]] = state;
+    }
+    
+    // Temporaries decided by later blocks are stored at their sites
+    for (int i = 0; i < cse->site_count; i++) {
+        const Site* site = &cse->sites[i];
+        if (site->temp < 0) continue;
+        
+        char temp[64];
+        char push[80];
+        snprintf(temp, sizeof(temp), "%s%d", CSE_TEMP_PREFIX, site->temp);
+        snprintf(push, sizeof(push), "PUSHS %s", temp);
+        const InstrList* code = cse->code;
+        if (site->end - site->start == 2 && op_in(code->items[site->end].op, binary_ops)) {
+            // Stack operation without the S, operands may be long string constants
+            const char* op = code->items[site->end].op;
+            const char* x = code->items[site->start].args[0];
+            const char* y = code->items[site->start + 1].args[0];
+            size_t size = strlen(op) + strlen(temp) + strlen(x) + strlen(y) + 4;
+            char* line = malloc(size);
+            if (!line) {
+                cse->ok = false;
+                break;
+            }
+            snprintf(line, size, "%.*s %s %s %s", (int)strlen(op) - 1, op, temp, x, y);
+            add_edit(cse, site->start, site->end, line, push);
+            free(line);
+        } else {
+            char pop[80];
+            snprintf(pop, sizeof(pop), "POPS %s", temp);
+            add_edit(cse, site->end + 1, site->end, pop, push);
+        }
+    }
+    
+    for (int i = 0; i < cfg->block_count && cse->outs; i++) {
+        state_free(&cse->outs[i]);
+    }
+    free(cse->outs);
+    cse->outs = NULL;
+    cfg_free(cfg);
+    free(marks);
+}
+
+// Later edits first, replacement before insertion at the same place
+static int compare_edits(const void* a, const void* b) {
+    const Edit* x = a;
+    const Edit* y = b;
+    if (x->position != y->position) return y->position - x->position;
+    return (y->end >= y->position) - (x->end >= x->position);
+}
+
+// Applies edits from the end of the code, so positions of the earlier ones stay
+static bool apply_edits(Cse* cse) {
+    if (cse->edit_count == 0) return true;
+    qsort(cse->edits, cse->edit_count, sizeof(Edit), compare_edits);
+    
+    bool ok = true;
+    for (int i = 0; i < cse->edit_count; i++) {
+        Edit* edit = &cse->edits[i];
+        if (ok) {
+            ilist_remove_range(cse->code, edit->position, edit->end + 1);
+            for (int j = edit->line_count - 1; j >= 0 && ok; j--) {
+                ok = ilist_insert(cse->code, edit->position, edit->lines[j]);
+            }
+        }
+        free(edit->lines[0]);
+        free(edit->lines[1]);
+    }
+    return ok;
+}
+
+/**
+ * Replaces repeated computations of values in one routine
+ * @param code generated program
+ * @param first first instruction of the routine
+ * @param last end of the routine, exclusive
+ * @param temps number of temporaries, raised to the ones the routine needs
+ * @param local true to reuse values only within their blocks, in linear time
+ * @return true on success, code must not be printed on failure
+ */
+bool cse_routine(InstrList* code, int first, int last, int* temps, bool local) {
+    // Values outlive calls of helpers, their temporaries would be overwritten
+    if (strncmp(code->items[first].args[0], "$%", 2) == 0) return true;
+    
+    Cse cse;
+    memset(&cse, 0, sizeof(cse));
+    cse.code = code;
+    cse.local = local;
+    cse.ok = true;
+    number_routine(&cse, first, last);
+    
+    bool ok = cse.ok;
+    if (!ok) {
+        // Nothing is changed
+        for (int i = 0; i < cse.edit_count; i++) {
+            free(cse.edits[i].lines[0]);
+            free(cse.edits[i].lines[1]);
+        }
+    } else {
+        ok = apply_edits(&cse);
+    }
+    if (ok && cse.temp_count > *temps) {
+        *temps = cse.temp_count;
+    }
+    
+    free(cse.constants);
+    free(cse.sites);
+    free(cse.stack);
+    free(cse.edits);
+    return ok;
+}
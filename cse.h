@@ -0,0 +1,27 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * cse.h
+ * elimination of repeated computations
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef CSE_H
+#define CSE_H
+
+#include "ilist.h"
+#include <stdbool.h>
+
+// Prefix of the temporaries that keep reused values, GF@%cse0 and so on
+#define CSE_TEMP_PREFIX "GF@%cse"
+
+// Replaces computations of the routine code first..last whose value is
+// already in a variable or in a new temporary. Routines share temporaries,
+// temps is raised to the number to define. Local keeps values within their
+// blocks.
+bool cse_routine(InstrList* code, int first, int last, int* temps, bool local);
+
+#endif // CSE_H
@@ -0,0 +1,819 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * eval.c
+ * compile-time evaluation of calls to pure functions
+ *
+ * The evaluator runs the IFJcode25 already generated for a function, so it
+ * has exactly the semantics of the emitted code. Anything the interpreter
+ * would report as a runtime error, every instruction with a side effect and
+ * running out of the step budget make the call stay a runtime call.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "eval.h"
+#include "builtins.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// Longest string built during evaluation, longer ones are left for runtime
+#define EVAL_MAX_STRING 65536
+
+typedef struct {
+    char* name;
+    ConstValue value;
+    bool initialized;
+} EvalVar;
+
+typedef struct {
+    EvalVar* vars;
+    int count;
+    int capacity;
+} EvalFrame;
+
+typedef struct {
+    int pc;                          // return address
+    const FunctionCode* function;    // function of the caller
+} EvalCall;
+
+typedef struct {
+    const FunctionTable* table;
+    const FunctionCode* function;    // function of the executed instruction
+    EvalFrame global;                // scratch registers only
+    EvalFrame* temporary;            // TF or NULL
+    EvalFrame** locals;              // LF stack, last one is LF
+    int local_count;
+    int local_capacity;
+    ConstValue* stack;               // data stack
+    int stack_count;
+    int stack_capacity;
+    EvalCall* calls;
+    int call_count;
+    int call_capacity;
+} Machine;
+
+// Instructions computing a value from one or two symbols
+typedef struct {
+    const char* name;
+    int operands;
+    bool stack_form;                 // also exists with S suffix
+} EvalOperation;
+
+static const EvalOperation operations[] = {
+    {"ADD",       2, true},
+    {"SUB",       2, true},
+    {"MUL",       2, true},
+    {"DIV",       2, true},
+    {"IDIV",      2, true},
+    {"LT",        2, true},
+    {"GT",        2, true},
+    {"EQ",        2, true},
+    {"AND",       2, true},
+    {"OR",        2, true},
+    {"NOT",       1, true},
+    {"INT2FLOAT", 1, true},
+    {"FLOAT2INT", 1, true},
+    {"INT2CHAR",  1, true},
+    {"STRI2INT",  2, true},
+    {"CONCAT",    2, false},
+    {"STRLEN",    1, false},
+    {"GETCHAR",   2, false},
+    {"TYPE",      1, false},
+    {NULL, 0, false}
+};
+
+// Instructions with side effects
+static const char* impure_operations[] = {"READ", "WRITE", "DPRINT", "BREAK", "EXIT", NULL};
+
+/**
+ * Initializes an empty table
+ * @param table function table
+ */
+void functions_init(FunctionTable* table) {
+    table->items = NULL;
+    table->count = 0;
+    table->capacity = 0;
+}
+
+/**
+ * Frees the table
+ * @param table function table
+ */
+void functions_free(FunctionTable* table) {
+    for (int i = 0; i < table->count; i++) {
+        free(table->items[i].label);
+    }
+    free(table->items);
+    functions_init(table);
+}
+
+/**
+ * Adds function, it is not pure until eval_is_pure says so
+ * @param table function table
+ * @param code list holding the code of the function
+ * @param label entry label
+ * @param start index of the entry label
+ * @param end one past the last instruction of the function
+ * @return added function, NULL on failure
+ */
+FunctionCode* functions_add(FunctionTable* table, const InstrList* code, const char* label, int start, int end) {
+    if (table->count == table->capacity) {
+        int capacity = table->capacity ? table->capacity * 2 : 16;
+        FunctionCode* items = realloc(table->items, capacity * sizeof(FunctionCode));
+        if (!items) return NULL;
+        table->items = items;
+        table->capacity = capacity;
+    }
+    
+    char* copy = malloc(strlen(label) + 1);
+    if (!copy) return NULL;
+    strcpy(copy, label);
+    
+    table->items[table->count] = (FunctionCode){copy, code, start, end, false, false};
+    return &table->items[table->count++];
+}
+
+/**
+ * Finds function by entry label
+ * @param table function table
+ * @param label entry label
+ * @return function or NULL
+ */
+FunctionCode* functions_find(const FunctionTable* table, const char* label) {
+    for (int i = 0; i < table->count; i++) {
+        if (strcmp(table->items[i].label, label) == 0) {
+            return &table->items[i];
+        }
+    }
+    return NULL;
+}
+
+// Scratch registers of built-ins (%tmp0), helpers (%r<n>) and return value (%retval)
+static bool is_scratch_global(const char* name) {
+    if (strcmp(name, "%tmp0") == 0 || strcmp(name, "%retval") == 0) return true;
+    if (name[0] != '%' || name[1] != 'r' || !name[2]) return false;
+    
+    for (const char* p = name + 2; *p; p++) {
+        if (!isdigit((unsigned char)*p)) return false;
+    }
+    return true;
+}
+
+// Checks that operand is a variable
+static bool is_variable(const char* operand) {
+    return strncmp(operand, "GF@", 3) == 0 || strncmp(operand, "LF@", 3) == 0 ||
+           strncmp(operand, "TF@", 3) == 0;
+}
+
+/**
+ * Checks that a function has no effect other than its return value
+ * @param table functions defined so far
+ * @param function checked function
+ * @return true if the function reads or writes only its own frames
+ */
+bool eval_is_pure(const FunctionTable* table, const FunctionCode* function) {
+    for (int i = function->start; i < function->end; i++) {
+        const Instr* instr = &function->code->items[i];
+        
+        for (int j = 0; impure_operations[j]; j++) {
+            if (instr_is(instr, impure_operations[j])) return false;
+        }
+        
+        if (instr_is(instr, "CALL")) {
+            // Helpers of built-ins are pure, recursion does not change purity
+            if (strncmp(instr->args[0], "$%", 2) == 0) continue;
+            const FunctionCode* callee = functions_find(table, instr->args[0]);
+            if (!callee || (callee != function && !callee->pure)) return false;
+            continue;
+        }
+        
+        for (int j = 0; j < instr->argc; j++) {
+            if (strncmp(instr->args[j], "GF@", 3) == 0 && !is_scratch_global(instr->args[j] + 3)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Makes room for one more item of a growing array
+static bool reserve(void** items, int* capacity, int count, size_t size) {
+    if (count < *capacity) return true;
+    
+    int new_capacity = *capacity ? *capacity * 2 : 16;
+    void* new_items = realloc(*items, new_capacity * size);
+    if (!new_items) return false;
+    
+    *items = new_items;
+    *capacity = new_capacity;
+    return true;
+}
+
+// Frees variables of a frame
+static void frame_free(EvalFrame* frame) {
+    for (int i = 0; i < frame->count; i++) {
+        free(frame->vars[i].name);
+        const_free(&frame->vars[i].value);
+    }
+    free(frame->vars);
+    frame->vars = NULL;
+    frame->count = 0;
+    frame->capacity = 0;
+}
+
+// Frees a frame allocated by CREATEFRAME
+static void frame_destroy(EvalFrame* frame) {
+    if (frame) {
+        frame_free(frame);
+        free(frame);
+    }
+}
+
+// Finds variable of a frame
+static EvalVar* frame_find(EvalFrame* frame, const char* name) {
+    for (int i = 0; i < frame->count; i++) {
+        if (strcmp(frame->vars[i].name, name) == 0) {
+            return &frame->vars[i];
+        }
+    }
+    return NULL;
+}
+
+// Defines uninitialized variable, redefinition is a runtime error
+static EvalVar* frame_define(EvalFrame* frame, const char* name) {
+    if (frame_find(frame, name)) return NULL;
+    if (!reserve((void**)&frame->vars, &frame->capacity, frame->count, sizeof(EvalVar))) return NULL;
+    
+    char* copy = malloc(strlen(name) + 1);
+    if (!copy) return NULL;
+    strcpy(copy, name);
+    
+    EvalVar* var = &frame->vars[frame->count++];
+    var->name = copy;
+    const_set_nil(&var->value);
+    var->initialized = false;
+    return var;
+}
+
+// Frame an operand refers to, NULL if it does not exist
+static EvalFrame* machine_frame(Machine* m, const char* operand) {
+    if (strncmp(operand, "GF@", 3) == 0) return &m->global;
+    if (strncmp(operand, "TF@", 3) == 0) return m->temporary;
+    if (strncmp(operand, "LF@", 3) == 0 && m->local_count > 0) return m->locals[m->local_count - 1];
+    return NULL;
+}
+
+// Variable an operand refers to, scratch globals exist from the prolog
+static EvalVar* machine_var(Machine* m, const char* operand) {
+    EvalFrame* frame = machine_frame(m, operand);
+    if (!frame) return NULL;
+    
+    EvalVar* var = frame_find(frame, operand + 3);
+    if (!var && frame == &m->global && is_scratch_global(operand + 3)) {
+        var = frame_define(frame, operand + 3);
+    }
+    return var;
+}
+
+// Decodes string@ operand, escapes are \ddd
+static bool decode_string(const char* text, ConstValue* value) {
+    char* out = malloc(strlen(text) + 1);
+    if (!out) return false;
+    
+    size_t n = 0;
+    for (const char* p = text; *p; ) {
+        if (*p != '\\') {
+            out[n++] = *p++;
+            continue;
+        }
+        if (!isdigit((unsigned char)p[1]) || !isdigit((unsigned char)p[2]) || !isdigit((unsigned char)p[3])) {
+            free(out);
+            return false;
+        }
+        int c = (p[1] - '0') * 100 + (p[2] - '0') * 10 + (p[3] - '0');
+        if (c == 0 || c > 255) {
+            // Zero byte cannot be kept in a C string
+            free(out);
+            return false;
+        }
+        out[n++] = (char)c;
+        p += 4;
+    }
+    out[n] = '\0';
+    
+    value->type = CONST_STRING;
+    value->value.string = out;
+    return true;
+}
+
+// Value of a constant operand
+static bool decode_constant(const char* operand, ConstValue* value) {
+    const char* at = strchr(operand, '@');
+    if (!at) return false;
+    const char* text = at + 1;
+    size_t type_length = (size_t)(at - operand);
+    char* end = NULL;
+    
+    if (type_length == 3 && strncmp(operand, "int", 3) == 0) {
+        long long x = strtoll(text, &end, 10);
+        if (end == text || *end) return false;
+        const_set_int(value, x);
+        return true;
+    }
+    if (type_length == 5 && strncmp(operand, "float", 5) == 0) {
+        double x = strtod(text, &end);
+        if (end == text || *end) return false;
+        const_set_float(value, x);
+        return true;
+    }
+    if (type_length == 4 && strncmp(operand, "bool", 4) == 0) {
+        if (strcmp(text, "true") != 0 && strcmp(text, "false") != 0) return false;
+        const_set_bool(value, strcmp(text, "true") == 0);
+        return true;
+    }
+    if (type_length == 3 && strncmp(operand, "nil", 3) == 0) {
+        const_set_nil(value);
+        return true;
+    }
+    if (type_length == 6 && strncmp(operand, "string", 6) == 0) {
+        return decode_string(text, value);
+    }
+    return false;
+}
+
+// Copy of the value of a symbol, reading uninitialized variable fails
+static bool read_symbol(Machine* m, const char* operand, ConstValue* value) {
+    if (!is_variable(operand)) {
+        return decode_constant(operand, value);
+    }
+    
+    EvalVar* var = machine_var(m, operand);
+    if (!var || !var->initialized) return false;
+    return const_copy(value, &var->value);
+}
+
+// Stores value to a variable, the value is taken over
+static bool write_var(Machine* m, const char* operand, ConstValue* value) {
+    EvalVar* var = is_variable(operand) ? machine_var(m, operand) : NULL;
+    if (!var) {
+        const_free(value);
+        return false;
+    }
+    
+    const_free(&var->value);
+    var->value = *value;
+    var->initialized = true;
+    return true;
+}
+
+// Pushes value to the data stack, the value is taken over
+static bool push_value(Machine* m, ConstValue* value) {
+    if (!reserve((void**)&m->stack, &m->stack_capacity, m->stack_count, sizeof(ConstValue))) {
+        const_free(value);
+        return false;
+    }
+    m->stack[m->stack_count++] = *value;
+    return true;
+}
+
+// Pops value from the data stack, popping empty stack is a runtime error
+static bool pop_value(Machine* m, ConstValue* value) {
+    if (m->stack_count == 0) return false;
+    *value = m->stack[--m->stack_count];
+    return true;
+}
+
+// Sets string result built from two parts, NULL part is empty
+static bool set_joined(ConstValue* result, const char* a, size_t a_length, const char* b, size_t b_length) {
+    if (a_length + b_length > EVAL_MAX_STRING) return false;
+    
+    char* text = malloc(a_length + b_length + 1);
+    if (!text) return false;
+    if (a_length) memcpy(text, a, a_length);
+    if (b_length) memcpy(text + a_length, b, b_length);
+    text[a_length + b_length] = '\0';
+    
+    result->type = CONST_STRING;
+    result->value.string = text;
+    return true;
+}
+
+// Interpreter indexes strings by UTF-8 characters, evaluation works on bytes
+static bool is_ascii(const ConstValue* s) {
+    if (s->type != CONST_STRING) return false;
+    for (const char* c = s->value.string; *c; c++) {
+        if ((unsigned char)*c > 127) return false;
+    }
+    return true;
+}
+
+// Index into a string, out of range is a runtime error
+static bool string_index(const ConstValue* s, const ConstValue* index, long long* i) {
+    if (!is_ascii(s) || index->type != CONST_INT) return false;
+    *i = index->value.integer;
+    return *i >= 0 && *i < (long long)strlen(s->value.string);
+}
+
+/**
+ * Computes result of an operation the same way the interpreter does
+ * @param op operation without the S suffix
+ * @param a first operand
+ * @param b second operand, unused by unary operations
+ * @param result computed value
+ * @return false on runtime error
+ */
+static bool apply_operation(const char* op, const ConstValue* a, const ConstValue* b, ConstValue* result) {
+    bool flag;
+    long long i;
+    
+    // Arithmetic takes two ints or two floats, ADDS joins no strings
+    bool numbers = (a->type == CONST_INT || a->type == CONST_FLOAT) && a->type == b->type;
+    if (strcmp(op, "ADD") == 0) return numbers && fold_binary(TOKEN_PLUS, a, b, result);
+    if (strcmp(op, "SUB") == 0) return numbers && fold_binary(TOKEN_MINUS, a, b, result);
+    if (strcmp(op, "MUL") == 0) return numbers && fold_binary(TOKEN_MULTIPLY, a, b, result);
+    if (strcmp(op, "DIV") == 0) return numbers && fold_binary(TOKEN_DIVIDE, a, b, result);
+    
+    if (strcmp(op, "IDIV") == 0) {
+        // Rounding of negative quotients is left to the interpreter
+        if (a->type != CONST_INT || b->type != CONST_INT) return false;
+        if (a->value.integer < 0 || b->value.integer <= 0) return false;
+        const_set_int(result, a->value.integer / b->value.integer);
+        return true;
+    }
+    
+    if (strcmp(op, "LT") == 0 || strcmp(op, "GT") == 0 || strcmp(op, "EQ") == 0) {
+        TokenType relation = op[0] == 'L' ? TOKEN_LESS : op[0] == 'G' ? TOKEN_GREATER : TOKEN_EQUAL;
+        if (!fold_relational(relation, a, b, &flag)) return false;
+        const_set_bool(result, flag);
+        return true;
+    }
+    
+    if (strcmp(op, "AND") == 0 || strcmp(op, "OR") == 0) {
+        if (a->type != CONST_BOOL || b->type != CONST_BOOL) return false;
+        const_set_bool(result, op[0] == 'A' ? a->value.boolean && b->value.boolean
+                                            : a->value.boolean || b->value.boolean);
+        return true;
+    }
+    
+    if (strcmp(op, "NOT") == 0) {
+        if (a->type != CONST_BOOL) return false;
+        const_set_bool(result, !a->value.boolean);
+        return true;
+    }
+    
+    if (strcmp(op, "INT2FLOAT") == 0) {
+        if (a->type != CONST_INT) return false;
+        const_set_float(result, (double)a->value.integer);
+        return true;
+    }
+    
+    if (strcmp(op, "FLOAT2INT") == 0) {
+        if (a->type != CONST_FLOAT) return false;
+        if (!(a->value.number > -9223372036854775808.0 && a->value.number < 9223372036854775808.0)) return false;
+        const_set_int(result, (long long)a->value.number);
+        return true;
+    }
+    
+    if (strcmp(op, "INT2CHAR") == 0) {
+        // Zero byte cannot be kept in a C string, other characters take more bytes
+        if (a->type != CONST_INT || a->value.integer < 1 || a->value.integer > 127) return false;
+        char c = (char)a->value.integer;
+        return set_joined(result, &c, 1, NULL, 0);
+    }
+    
+    if (strcmp(op, "STRI2INT") == 0) {
+        if (!string_index(a, b, &i)) return false;
+        const_set_int(result, (unsigned char)a->value.string[i]);
+        return true;
+    }
+    
+    if (strcmp(op, "CONCAT") == 0) {
+        if (a->type != CONST_STRING || b->type != CONST_STRING) return false;
+        return set_joined(result, a->value.string, strlen(a->value.string), b->value.string, strlen(b->value.string));
+    }
+    
+    if (strcmp(op, "STRLEN") == 0) {
+        if (!is_ascii(a)) return false;
+        const_set_int(result, (long long)strlen(a->value.string));
+        return true;
+    }
+    
+    if (strcmp(op, "GETCHAR") == 0) {
+        if (!string_index(a, b, &i)) return false;
+        return set_joined(result, a->value.string + i, 1, NULL, 0);
+    }
+    
+    if (strcmp(op, "TYPE") == 0) {
+        static const char* type_names[] = {"nil", "int", "float", "string", "bool"};
+        return const_set_string(result, type_names[a->type]);
+    }
+    
+    return false;
+}
+
+// Runs an operation on symbols, or on the data stack for the S form
+static bool execute_operation(Machine* m, const Instr* instr, const EvalOperation* operation, bool stack_form) {
+    ConstValue operands[2];
+    const_set_nil(&operands[0]);
+    const_set_nil(&operands[1]);
+    ConstValue result;
+    const_set_nil(&result);
+    bool ok = true;
+    
+    if (stack_form) {
+        for (int i = operation->operands - 1; i >= 0 && ok; i--) {
+            ok = pop_value(m, &operands[i]);
+        }
+    } else if (instr->argc != operation->operands + 1) {
+        ok = false;
+    } else if (strcmp(operation->name, "TYPE") == 0 && is_variable(instr->args[1])) {
+        // TYPE of an uninitialized variable is an empty string
+        EvalVar* var = machine_var(m, instr->args[1]);
+        if (!var) {
+            ok = false;
+        } else if (!var->initialized) {
+            ok = const_set_string(&result, "") && write_var(m, instr->args[0], &result);
+            return ok;
+        } else {
+            ok = const_copy(&operands[0], &var->value);
+        }
+    } else {
+        for (int i = 0; i < operation->operands && ok; i++) {
+            ok = read_symbol(m, instr->args[i + 1], &operands[i]);
+        }
+    }
+    
+    ok = ok && apply_operation(operation->name, &operands[0], &operands[1], &result);
+    const_free(&operands[0]);
+    const_free(&operands[1]);
+    if (!ok) return false;
+    
+    return stack_form ? push_value(m, &result) : write_var(m, instr->args[0], &result);
+}
+
+// Continues after the label, labels are looked up in the running function
+static bool jump_to(Machine* m, const char* label, int* pc) {
+    for (int i = m->function->start; i < m->function->end; i++) {
+        const Instr* instr = &m->function->code->items[i];
+        if (instr_is(instr, "LABEL") && strcmp(instr->args[0], label) == 0) {
+            *pc = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Compares operands of a conditional jump, different types are a runtime error
+static bool jump_condition(const ConstValue* a, const ConstValue* b, bool* equal) {
+    return fold_relational(TOKEN_EQUAL, a, b, equal);
+}
+
+// Calls helper of a built-in, it is evaluated by the built-in folding
+static bool call_helper(Machine* m, const char* label) {
+    const char* name = label + 2;
+    int arity = get_builtin_arity(name);
+    if (arity < 0 || arity > 3 || m->stack_count < arity) return false;
+    
+    ConstValue result;
+    const ConstValue* args = &m->stack[m->stack_count - arity];
+    if (!fold_builtin_call(name, args, arity, &result)) return false;
+    
+    for (int i = 0; i < arity; i++) {
+        const_free(&m->stack[--m->stack_count]);
+    }
+    return push_value(m, &result);
+}
+
+/**
+ * Executes one instruction
+ * @param m machine state
+ * @param instr executed instruction
+ * @param pc index of the next instruction, changed by jumps
+ * @param returned set when the evaluated function returns
+ * @return false on runtime error or unsupported instruction
+ */
+static bool execute(Machine* m, const Instr* instr, int* pc, bool* returned) {
+    ConstValue a, b;
+    bool equal;
+    
+    for (int i = 0; operations[i].name; i++) {
+        if (instr_is(instr, operations[i].name)) {
+            return execute_operation(m, instr, &operations[i], false);
+        }
+        size_t length = strlen(operations[i].name);
+        if (operations[i].stack_form && strncmp(instr->op, operations[i].name, length) == 0 &&
+            strcmp(instr->op + length, "S") == 0) {
+            return execute_operation(m, instr, &operations[i], true);
+        }
+    }
+    
+    if (instr_is(instr, "LABEL")) {
+        return true;
+    }
+    
+    if (instr_is(instr, "MOVE")) {
+        return read_symbol(m, instr->args[1], &a) && write_var(m, instr->args[0], &a);
+    }
+    
+    if (instr_is(instr, "DEFVAR")) {
+        EvalFrame* frame = machine_frame(m, instr->args[0]);
+        return frame && frame_define(frame, instr->args[0] + 3) != NULL;
+    }
+    
+    if (instr_is(instr, "PUSHS")) {
+        return read_symbol(m, instr->args[0], &a) && push_value(m, &a);
+    }
+    
+    if (instr_is(instr, "POPS")) {
+        return pop_value(m, &a) && write_var(m, instr->args[0], &a);
+    }
+    
+    if (instr_is(instr, "CLEARS")) {
+        while (m->stack_count > 0) {
+            const_free(&m->stack[--m->stack_count]);
+        }
+        return true;
+    }
+    
+    if (instr_is(instr, "CREATEFRAME")) {
+        frame_destroy(m->temporary);
+        m->temporary = calloc(1, sizeof(EvalFrame));
+        return m->temporary != NULL;
+    }
+    
+    if (instr_is(instr, "PUSHFRAME")) {
+        if (!m->temporary) return false;
+        if (!reserve((void**)&m->locals, &m->local_capacity, m->local_count, sizeof(EvalFrame*))) return false;
+        m->locals[m->local_count++] = m->temporary;
+        m->temporary = NULL;
+        return true;
+    }
+    
+    if (instr_is(instr, "POPFRAME")) {
+        if (m->local_count == 0) return false;
+        frame_destroy(m->temporary);
+        m->temporary = m->locals[--m->local_count];
+        return true;
+    }
+    
+    if (instr_is(instr, "JUMP")) {
+        return jump_to(m, instr->args[0], pc);
+    }
+    
+    if (instr_is(instr, "JUMPIFEQ") || instr_is(instr, "JUMPIFNEQ")) {
+        if (!read_symbol(m, instr->args[1], &a)) return false;
+        if (!read_symbol(m, instr->args[2], &b)) {
+            const_free(&a);
+            return false;
+        }
+        bool ok = jump_condition(&a, &b, &equal);
+        const_free(&a);
+        const_free(&b);
+        if (!ok) return false;
+        return equal == instr_is(instr, "JUMPIFEQ") ? jump_to(m, instr->args[0], pc) : true;
+    }
+    
+    if (instr_is(instr, "JUMPIFEQS") || instr_is(instr, "JUMPIFNEQS")) {
+        if (!pop_value(m, &b)) return false;
+        if (!pop_value(m, &a)) {
+            const_free(&b);
+            return false;
+        }
+        bool ok = jump_condition(&a, &b, &equal);
+        const_free(&a);
+        const_free(&b);
+        if (!ok) return false;
+        return equal == instr_is(instr, "JUMPIFEQS") ? jump_to(m, instr->args[0], pc) : true;
+    }
+    
+    if (instr_is(instr, "SETCHAR")) {
+        EvalVar* var = machine_var(m, instr->args[0]);
+        if (!var || !var->initialized) return false;
+        if (!read_symbol(m, instr->args[1], &a)) return false;
+        if (!read_symbol(m, instr->args[2], &b)) {
+            const_free(&a);
+            return false;
+        }
+        long long i;
+        bool ok = string_index(&var->value, &a, &i) && b.type == CONST_STRING && b.value.string[0];
+        if (ok) {
+            var->value.value.string[i] = b.value.string[0];
+        }
+        const_free(&a);
+        const_free(&b);
+        return ok;
+    }
+    
+    if (instr_is(instr, "CALL")) {
+        if (strncmp(instr->args[0], "$%", 2) == 0) {
+            return call_helper(m, instr->args[0]);
+        }
+        
+        const FunctionCode* callee = functions_find(m->table, instr->args[0]);
+        if (!callee) return false;
+        if (!reserve((void**)&m->calls, &m->call_capacity, m->call_count, sizeof(EvalCall))) return false;
+        m->calls[m->call_count++] = (EvalCall){*pc, m->function};
+        m->function = callee;
+        *pc = callee->start;
+        return true;
+    }
+    
+    if (instr_is(instr, "RETURN")) {
+        if (m->call_count == 0) {
+            *returned = true;
+            return true;
+        }
+        EvalCall call = m->calls[--m->call_count];
+        *pc = call.pc;
+        m->function = call.function;
+        return true;
+    }
+    
+    // Input, output, EXIT and debugging instructions
+    return false;
+}
+
+// Frees everything the machine allocated
+static void machine_free(Machine* m) {
+    frame_free(&m->global);
+    frame_destroy(m->temporary);
+    for (int i = 0; i < m->local_count; i++) {
+        frame_destroy(m->locals[i]);
+    }
+    free(m->locals);
+    for (int i = 0; i < m->stack_count; i++) {
+        const_free(&m->stack[i]);
+    }
+    free(m->stack);
+    free(m->calls);
+}
+
+/**
+ * Evaluates a call of a function with constant arguments
+ * @param table functions defined so far
+ * @param function called function
+ * @param args arguments in the order they are pushed
+ * @param arg_count number of arguments
+ * @param budget maximal number of executed instructions
+ * @param result return value
+ * @return true if the function returned within the budget
+ */
+bool eval_call(const FunctionTable* table, const FunctionCode* function,
+               const ConstValue* args, int arg_count, long budget, ConstValue* result) {
+    Machine m;
+    memset(&m, 0, sizeof(m));
+    m.table = table;
+    m.function = function;
+    
+    // Arguments as the caller passes them, on the stack or in TF@paramN
+    bool ok = true;
+    if (function->frame_args) {
+        m.temporary = calloc(1, sizeof(EvalFrame));
+        ok = m.temporary != NULL;
+    }
+    for (int i = 0; i < arg_count && ok; i++) {
+        ConstValue copy;
+        if (!const_copy(&copy, &args[i])) {
+            ok = false;
+        } else if (!function->frame_args) {
+            ok = push_value(&m, &copy);
+        } else {
+            char name[32];
+            snprintf(name, sizeof(name), "param%d", i);
+            EvalVar* param = frame_define(m.temporary, name);
+            if (param) {
+                param->value = copy;
+                param->initialized = true;
+            } else {
+                const_free(&copy);
+                ok = false;
+            }
+        }
+    }
+    
+    // Runs until the outermost RETURN
+    int pc = function->start;
+    bool returned = false;
+    for (long steps = 0; ok && !returned; steps++) {
+        if (steps >= budget || pc < m.function->start || pc >= m.function->end) {
+            ok = false;
+            break;
+        }
+        const Instr* instr = &m.function->code->items[pc++];
+        ok = execute(&m, instr, &pc, &returned);
+    }
+    
+    if (ok && function->frame_args) {
+        EvalVar* retval = frame_find(&m.global, "%retval");
+        ok = retval && retval->initialized && const_copy(result, &retval->value);
+    } else {
+        ok = ok && pop_value(&m, result);
+    }
+    machine_free(&m);
+    return ok;
+}
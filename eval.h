@@ -0,0 +1,55 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * eval.h
+ * compile-time evaluation of calls to pure functions
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "ilist.h"
+#include "fold.h"
+#include <stdbool.h>
+
+// Generated code of one user function
+typedef struct FunctionCode {
+    char* label;        // entry label, $name
+    const InstrList* code;  // list holding the code
+    int start;          // index of the entry label
+    int end;            // one past the last instruction
+    bool pure;          // no globals, no input or output, calls only pure functions
+    bool frame_args;    // arguments in TF@paramN, result in GF@%retval
+} FunctionCode;
+
+typedef struct FunctionTable {
+    FunctionCode* items;
+    int count;
+    int capacity;
+} FunctionTable;
+
+// Initialize an empty table
+void functions_init(FunctionTable* table);
+
+// Free the table
+void functions_free(FunctionTable* table);
+
+// Add function whose code is code[start..end), NULL on allocation failure
+FunctionCode* functions_add(FunctionTable* table, const InstrList* code, const char* label, int start, int end);
+
+// Find function by entry label, NULL if it is not defined yet
+FunctionCode* functions_find(const FunctionTable* table, const char* label);
+
+// Purity of a function, its callees have to be in the table already
+bool eval_is_pure(const FunctionTable* table, const FunctionCode* function);
+
+// Runs the function on constant arguments for at most budget instructions,
+// false if it did not return or failed at runtime
+bool eval_call(const FunctionTable* table, const FunctionCode* function,
+               const ConstValue* args, int arg_count, long budget, ConstValue* result);
+
+#endif // EVAL_H
@@ -0,0 +1,274 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * fold.c
+ * compile-time constants and their evaluation
+ *
+ * Folding follows the interpreter: operations that would fail at runtime
+ * (mixed int/float operands, division by zero, ...) are not folded so the
+ * program still fails the same way.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "fold.h"
+#include "strenc.h"
+
+void const_set_nil(ConstValue* c) {
+    c->type = CONST_NIL;
+    c->value.string = NULL;
+}
+
+void const_set_int(ConstValue* c, long long value) {
+    c->type = CONST_INT;
+    c->value.integer = value;
+}
+
+void const_set_float(ConstValue* c, double value) {
+    c->type = CONST_FLOAT;
+    c->value.number = value;
+}
+
+bool const_set_string(ConstValue* c, const char* value) {
+    size_t len = strlen(value) + 1;
+    char* copy = malloc(len);
+    if (!copy) {
+        const_set_nil(c);
+        return false;
+    }
+    memcpy(copy, value, len);
+    
+    c->type = CONST_STRING;
+    c->value.string = copy;
+    return true;
+}
+
+void const_set_bool(ConstValue* c, bool value) {
+    c->type = CONST_BOOL;
+    c->value.boolean = value;
+}
+
+/**
+ * Frees owned string and resets constant to nil
+ * @param c constant
+ */
+void const_free(ConstValue* c) {
+    if (c->type == CONST_STRING) {
+        free(c->value.string);
+    }
+    const_set_nil(c);
+}
+
+/**
+ * Copies constant
+ * @param dst destination
+ * @param src source
+ * @return true on success
+ */
+bool const_copy(ConstValue* dst, const ConstValue* src) {
+    if (src->type == CONST_STRING) {
+        return const_set_string(dst, src->value.string);
+    }
+    *dst = *src;
+    return true;
+}
+
+/**
+ * Converts literal token to constant
+ * @param type token type
+ * @param text token value
+ * @param c constant to fill
+ * @return true if the token is a literal
+ */
+bool const_from_literal(TokenType type, const char* text, ConstValue* c) {
+    switch (type) {
+        case TOKEN_INT_LITERAL:
+            if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+                const_set_int(c, strtoll(text + 2, NULL, 16));
+            } else {
+                const_set_int(c, strtoll(text, NULL, 10));
+            }
+            return true;
+        case TOKEN_FLOAT_LITERAL:
+            const_set_float(c, strtod(text, NULL));
+            return true;
+        case TOKEN_STRING_LITERAL:
+        case TOKEN_MULTILINE_STRING_LITERAL:
+            return const_set_string(c, text ? text : "");
+        case TOKEN_NULL:
+            const_set_nil(c);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Formats constant as an instruction operand
+ * @param c constant
+ * @return allocated operand text, NULL on failure
+ */
+char* const_operand(const ConstValue* c) {
+    char buffer[64];
+    
+    switch (c->type) {
+        case CONST_NIL:
+            snprintf(buffer, sizeof(buffer), "nil@nil");
+            break;
+        case CONST_INT:
+            snprintf(buffer, sizeof(buffer), "int@%lld", c->value.integer);
+            break;
+        case CONST_FLOAT:
+            snprintf(buffer, sizeof(buffer), "float@%a", c->value.number);
+            break;
+        case CONST_BOOL:
+            snprintf(buffer, sizeof(buffer), "bool@%s", c->value.boolean ? "true" : "false");
+            break;
+        case CONST_STRING: {
+            const char* encoded = strenc_cached(c->value.string);
+            char* operand = encoded ? malloc(strlen(encoded) + 8) : NULL;
+            if (operand) {
+                memcpy(operand, "string@", 7);
+                strcpy(operand + 7, encoded);
+            }
+            return operand;
+        }
+    }
+    
+    char* operand = malloc(strlen(buffer) + 1);
+    if (operand) {
+        strcpy(operand, buffer);
+    }
+    return operand;
+}
+
+/**
+ * Gets text printed by WRITE of the constant
+ * @param c constant
+ * @return allocated text, NULL for floats (printed in %a by the interpreter)
+ */
+char* const_write_text(const ConstValue* c) {
+    char buffer[32];
+    const char* text = buffer;
+    
+    switch (c->type) {
+        case CONST_NIL: text = ""; break;
+        case CONST_INT: snprintf(buffer, sizeof(buffer), "%lld", c->value.integer); break;
+        case CONST_BOOL: text = c->value.boolean ? "true" : "false"; break;
+        case CONST_STRING: text = c->value.string; break;
+        case CONST_FLOAT: return NULL;
+    }
+    
+    char* copy = malloc(strlen(text) + 1);
+    if (copy) {
+        strcpy(copy, text);
+    }
+    return copy;
+}
+
+/**
+ * Evaluates +, -, *, / on constants, + also joins strings
+ * @param op operator
+ * @param a left operand
+ * @param b right operand
+ * @param result folded value
+ * @return true if folded
+ */
+bool fold_binary(TokenType op, const ConstValue* a, const ConstValue* b, ConstValue* result) {
+    if (a->type == CONST_INT && b->type == CONST_INT) {
+        // Two's complement wrap-around like the interpreter
+        unsigned long long x = (unsigned long long)a->value.integer;
+        unsigned long long y = (unsigned long long)b->value.integer;
+        
+        switch (op) {
+            case TOKEN_PLUS: const_set_int(result, (long long)(x + y)); return true;
+            case TOKEN_MINUS: const_set_int(result, (long long)(x - y)); return true;
+            case TOKEN_MULTIPLY: const_set_int(result, (long long)(x * y)); return true;
+            default: return false;  // DIVS needs floats
+        }
+    }
+    
+    if (a->type == CONST_FLOAT && b->type == CONST_FLOAT) {
+        double x = a->value.number;
+        double y = b->value.number;
+        
+        switch (op) {
+            case TOKEN_PLUS: const_set_float(result, x + y); return true;
+            case TOKEN_MINUS: const_set_float(result, x - y); return true;
+            case TOKEN_MULTIPLY: const_set_float(result, x * y); return true;
+            case TOKEN_DIVIDE:
+                if (y == 0.0) return false;
+                const_set_float(result, x / y);
+                return true;
+            default: return false;
+        }
+    }
+    
+    // Concatenation of literals, left for runtime if it cannot be allocated
+    if (op == TOKEN_PLUS && a->type == CONST_STRING && b->type == CONST_STRING) {
+        size_t a_len = strlen(a->value.string);
+        char* joined = malloc(a_len + strlen(b->value.string) + 1);
+        if (!joined) return false;
+        strcpy(joined, a->value.string);
+        strcpy(joined + a_len, b->value.string);
+        bool ok = const_set_string(result, joined);
+        free(joined);
+        return ok;
+    }
+    
+    return false;
+}
+
+/**
+ * Evaluates ==, !=, <, >, <=, >= on constants
+ * @param op operator
+ * @param a left operand
+ * @param b right operand
+ * @param result folded value
+ * @return true if folded
+ */
+bool fold_relational(TokenType op, const ConstValue* a, const ConstValue* b, bool* result) {
+    int cmp = 0;
+    
+    if (op == TOKEN_EQUAL || op == TOKEN_NOT_EQUAL) {
+        // nil can be compared with anything
+        if (a->type == CONST_NIL || b->type == CONST_NIL) {
+            cmp = (a->type == b->type) ? 0 : 1;
+            *result = (op == TOKEN_EQUAL) == (cmp == 0);
+            return true;
+        }
+    }
+    
+    if (a->type != b->type) {
+        return false;
+    }
+    
+    switch (a->type) {
+        case CONST_INT:
+            cmp = (a->value.integer > b->value.integer) - (a->value.integer < b->value.integer);
+            break;
+        case CONST_FLOAT:
+            cmp = (a->value.number > b->value.number) - (a->value.number < b->value.number);
+            break;
+        case CONST_STRING:
+            cmp = strcmp(a->value.string, b->value.string);
+            break;
+        case CONST_BOOL:
+            cmp = (int)a->value.boolean - (int)b->value.boolean;
+            break;
+        case CONST_NIL:
+            return false;
+    }
+    
+    switch (op) {
+        case TOKEN_EQUAL: *result = cmp == 0; return true;
+        case TOKEN_NOT_EQUAL: *result = cmp != 0; return true;
+        case TOKEN_LESS: *result = cmp < 0; return true;
+        case TOKEN_GREATER: *result = cmp > 0; return true;
+        case TOKEN_LESS_EQUAL: *result = cmp <= 0; return true;
+        case TOKEN_GREATER_EQUAL: *result = cmp >= 0; return true;
+        default: return false;
+    }
+}
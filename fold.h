@@ -0,0 +1,66 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * fold.h
+ * compile-time constants and their evaluation
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "scanner.h"
+#include <stdbool.h>
+
+// Types of IFJcode25 constants
+typedef enum {
+    CONST_NIL,
+    CONST_INT,
+    CONST_FLOAT,
+    CONST_STRING,
+    CONST_BOOL
+} ConstType;
+
+// Value known at compile time
+typedef struct ConstValue {
+    ConstType type;
+    union {
+        long long integer;
+        double number;
+        char* string;     // owned by the value
+        bool boolean;
+    } value;
+} ConstValue;
+
+// Constructors, string is copied
+void const_set_nil(ConstValue* c);
+void const_set_int(ConstValue* c, long long value);
+void const_set_float(ConstValue* c, double value);
+bool const_set_string(ConstValue* c, const char* value);
+void const_set_bool(ConstValue* c, bool value);
+
+// Free owned string and reset to nil
+void const_free(ConstValue* c);
+
+// Deep copy
+bool const_copy(ConstValue* dst, const ConstValue* src);
+
+// Value of int, float or string literal token
+bool const_from_literal(TokenType type, const char* text, ConstValue* c);
+
+// Operand text (int@1, float@0x1p+0, string@..., bool@true, nil@nil), caller frees
+char* const_operand(const ConstValue* c);
+
+// Text WRITE would print, NULL when it cannot be expressed as a string literal
+char* const_write_text(const ConstValue* c);
+
+// Evaluate arithmetic operator, false if it has to be left for runtime
+bool fold_binary(TokenType op, const ConstValue* a, const ConstValue* b, ConstValue* result);
+
+// Evaluate relational operator, false if it has to be left for runtime
+bool fold_relational(TokenType op, const ConstValue* a, const ConstValue* b, bool* result);
+
+#endif // FOLD_H
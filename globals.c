@@ -0,0 +1,232 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * globals.c
+ * set of global variables referenced by the program
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "globals.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLOBALS_INITIAL_CAPACITY 16
+
+// FNV-1a hash of the name
+static uint32_t hash_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Finds slot of the name, or the empty slot where it belongs
+static int find_slot(const GlobalSet* set, const char* name) {
+    int slot = (int)(hash_name(name) & (uint32_t)(set->capacity - 1));
+    while (set->entries[slot].name && strcmp(set->entries[slot].name, name) != 0) {
+        slot = (slot + 1) & (set->capacity - 1);
+    }
+    return slot;
+}
+
+// Doubles capacity of the set
+static bool globals_grow(GlobalSet* set) {
+    int capacity = set->capacity ? set->capacity * 2 : GLOBALS_INITIAL_CAPACITY;
+    GlobalSet grown = {calloc(capacity, sizeof(GlobalVar)), set->count, capacity};
+    if (!grown.entries) return false;
+    
+    for (int i = 0; i < set->capacity; i++) {
+        if (set->entries[i].name) {
+            grown.entries[find_slot(&grown, set->entries[i].name)] = set->entries[i];
+        }
+    }
+    
+    free(set->entries);
+    *set = grown;
+    return true;
+}
+
+/**
+ * Initializes an empty set
+ * @param set set of globals
+ */
+void globals_init(GlobalSet* set) {
+    set->entries = NULL;
+    set->count = 0;
+    set->capacity = 0;
+}
+
+/**
+ * Frees the set
+ * @param set set of globals
+ */
+void globals_free(GlobalSet* set) {
+    for (int i = 0; i < set->capacity; i++) {
+        free(set->entries[i].name);
+        free(set->entries[i].constant);
+    }
+    free(set->entries);
+    globals_init(set);
+}
+
+/**
+ * Finds global by name, adds it when referenced for the first time
+ * @param set set of globals
+ * @param name name of the global
+ * @return global or NULL on allocation failure
+ */
+GlobalVar* globals_add(GlobalSet* set, const char* name) {
+    if (set->count * 2 >= set->capacity && !globals_grow(set)) {
+        return NULL;
+    }
+    
+    GlobalVar* global = &set->entries[find_slot(set, name)];
+    if (global->name) {
+        return global;
+    }
+    
+    global->name = malloc(strlen(name) + 1);
+    if (!global->name) return NULL;
+    strcpy(global->name, name);
+    global->read_early = false;
+    global->written_first = false;
+    global->constant = NULL;
+    set->count++;
+    return global;
+}
+
+// Global an operand refers to, NULL for other operands and unknown globals
+static GlobalVar* operand_global(const GlobalSet* set, const char* operand) {
+    if (set->capacity == 0 || strncmp(operand, "GF@", 3) != 0) return NULL;
+    GlobalVar* global = &set->entries[find_slot(set, operand + 3)];
+    return global->name ? global : NULL;
+}
+
+// Checks that operand is a constant, not a variable
+static bool is_constant_operand(const char* operand) {
+    return strncmp(operand, "GF@", 3) != 0 && strncmp(operand, "LF@", 3) != 0 &&
+           strncmp(operand, "TF@", 3) != 0;
+}
+
+// Checks that the first operand of an instruction is written by it
+static bool writes_first_operand(const Instr* instr) {
+    return !instr_is(instr, "PUSHS") && !instr_is(instr, "WRITE") && !instr_is(instr, "DPRINT") &&
+           !instr_is(instr, "EXIT");
+}
+
+// Constant stored by the only write of a global, NULL when it is not a constant
+static const char* written_constant(const InstrList* code, int index) {
+    const Instr* instr = &code->items[index];
+    if (instr_is(instr, "MOVE") && is_constant_operand(instr->args[1])) {
+        return instr->args[1];
+    }
+    
+    // PUSHS right before the POPS, a jump to the POPS would need a label between them
+    const Instr* prev = index > 0 ? &code->items[index - 1] : NULL;
+    if (instr_is(instr, "POPS") && instr_is(prev, "PUSHS") && is_constant_operand(prev->args[0])) {
+        return prev->args[0];
+    }
+    return NULL;
+}
+
+/**
+ * Propagates write-once globals. A global qualifies when main writes it in its
+ * straight-line start before any read (written_first) and nothing else ever
+ * writes it, so the write dominates every read. Its reads become the constant
+ * and the write disappears, globals_sorted callers skip it by its constant.
+ * @param set globals of the program
+ * @param code code of all functions, without the prolog
+ * @return false on allocation failure
+ */
+bool globals_propagate(GlobalSet* set, InstrList* code) {
+    if (set->count == 0) return true;
+    
+    int* writes = calloc(set->capacity, sizeof(int));
+    int* write_at = calloc(set->capacity, sizeof(int));
+    if (!writes || !write_at) {
+        free(writes);
+        free(write_at);
+        return false;
+    }
+    
+    // Count writes of every global
+    for (int i = 0; i < code->count; i++) {
+        const Instr* instr = &code->items[i];
+        GlobalVar* global = instr->argc > 0 ? operand_global(set, instr->args[0]) : NULL;
+        if (global && writes_first_operand(instr)) {
+            int slot = (int)(global - set->entries);
+            writes[slot]++;
+            write_at[slot] = i;
+        }
+    }
+    
+    // Pick the globals and drop their writes, last one first so indices stay valid
+    bool ok = true;
+    for (int i = code->count - 1; i >= 0 && ok; i--) {
+        const Instr* instr = &code->items[i];
+        GlobalVar* global = instr->argc > 0 ? operand_global(set, instr->args[0]) : NULL;
+        if (!global || !global->written_first || !writes_first_operand(instr)) continue;
+        
+        int slot = (int)(global - set->entries);
+        const char* constant = writes[slot] == 1 && write_at[slot] == i ? written_constant(code, i) : NULL;
+        if (!constant) continue;
+        
+        global->constant = malloc(strlen(constant) + 1);
+        if (!global->constant) {
+            ok = false;
+            break;
+        }
+        strcpy(global->constant, constant);
+        
+        bool pair = instr_is(instr, "POPS");
+        ilist_remove(code, i);
+        if (pair) {
+            ilist_remove(code, --i);
+        }
+    }
+    
+    // Every remaining reference is a read
+    for (int i = 0; i < code->count && ok; i++) {
+        Instr* instr = &code->items[i];
+        for (int j = 0; j < instr->argc && ok; j++) {
+            GlobalVar* global = operand_global(set, instr->args[j]);
+            if (global && global->constant) {
+                ok = instr_set_arg(instr, j, global->constant);
+            }
+        }
+    }
+    
+    free(writes);
+    free(write_at);
+    return ok;
+}
+
+// Orders globals by name
+static int compare_globals(const void* a, const void* b) {
+    return strcmp((*(GlobalVar* const*)a)->name, (*(GlobalVar* const*)b)->name);
+}
+
+/**
+ * Lists globals in a deterministic order
+ * @param set set of globals
+ * @return allocated array of set->count globals sorted by name, NULL on failure
+ */
+GlobalVar** globals_sorted(const GlobalSet* set) {
+    GlobalVar** sorted = malloc((set->count ? set->count : 1) * sizeof(GlobalVar*));
+    if (!sorted) return NULL;
+    
+    int n = 0;
+    for (int i = 0; i < set->capacity; i++) {
+        if (set->entries[i].name) {
+            sorted[n++] = &set->entries[i];
+        }
+    }
+    qsort(sorted, n, sizeof(GlobalVar*), compare_globals);
+    return sorted;
+}
@@ -0,0 +1,48 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * globals.h
+ * set of global variables referenced by the program
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef GLOBALS_H
+#define GLOBALS_H
+
+#include "ilist.h"
+#include <stdbool.h>
+
+// Global variable referenced somewhere in the program
+typedef struct GlobalVar {
+    char* name;
+    bool read_early;        // read in the straight-line start of main before any write
+    bool written_first;     // first access at runtime is always a write
+    char* constant;         // operand replacing every read of a write-once global, or NULL
+} GlobalVar;
+
+// Hash set of globals (open addressing)
+typedef struct GlobalSet {
+    GlobalVar* entries;
+    int count;
+    int capacity;           // power of two
+} GlobalSet;
+
+// Initialize an empty set
+void globals_init(GlobalSet* set);
+
+// Free the set and all names
+void globals_free(GlobalSet* set);
+
+// Find global, it is added when not present yet. NULL on allocation failure.
+GlobalVar* globals_add(GlobalSet* set, const char* name);
+
+// Replace globals written once with a constant before any read by the constant
+bool globals_propagate(GlobalSet* set, InstrList* code);
+
+// Array of all globals sorted by name, caller frees the array (not the entries)
+GlobalVar** globals_sorted(const GlobalSet* set);
+
+#endif // GLOBALS_H
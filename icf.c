@@ -0,0 +1,397 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * icf.c
+ * folding of routines with identical code
+ *
+ * Every routine is written down in a normal form: labels it defines are
+ * numbered in the order of their definitions, its own frame variables in
+ * the order they are first used. Routines with the same form do the same
+ * work, so calls of all but the first one are sent to the first one and the
+ * others are removed. Callers of folded routines may become identical too,
+ * so the folding repeats until nothing changes.
+ *
+ * A routine is removed only if no jump from another routine reaches into
+ * it and no routine falls through into it. Variables of the temporary frame
+ * are numbered only in routines that neither call nor push it, because a
+ * caller with --frame-args names the parameters of the callee there.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "icf.h"
+#include "cfg.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Routine with its normal form
+typedef struct {
+    int first;           // entry label
+    int last;            // end, exclusive
+    size_t form;         // offset of the form in Folding.text
+    size_t length;
+    uint32_t hash;
+    bool candidate;      // ends by leaving it, so the form says all it does
+    bool sealed;         // entered only by calls of the entry label
+    int target;          // routine its calls go to, itself if it stays
+} Routine;
+
+// Label defined in a routine
+typedef struct {
+    const char* name;    // owned by the instruction
+    int routine;
+    int number;          // order of the definition within the routine
+} Label;
+
+// Frame variable of a routine
+typedef struct {
+    const char* name;    // owned by the DEFVAR
+    int number;          // order of the first use, -1 while unused
+} Variable;
+
+// One round of folding
+typedef struct {
+    InstrList* code;
+    Routine* routines;
+    int routine_count;
+    Label* labels;
+    int label_count;
+    Variable* variables;
+    int variable_count;
+    char* text;          // forms of all routines
+    size_t text_length;
+    size_t text_capacity;
+} Folding;
+
+// Instructions with a label as the first operand
+static const char* const label_ops[] = {
+    "LABEL", "CALL", "JUMP", "JUMPIFEQ", "JUMPIFNEQ", "JUMPIFEQS", "JUMPIFNEQS", NULL
+};
+
+// Checks if the instruction refers to a label
+static bool has_label(const Instr* instr) {
+    for (int i = 0; label_ops[i]; i++) {
+        if (instr_is(instr, label_ops[i])) return instr->argc > 0;
+    }
+    return false;
+}
+
+// Checks if execution never continues with the next instruction
+static bool is_unconditional(const Instr* instr) {
+    return instr_is(instr, "JUMP") || instr_is(instr, "RETURN") || instr_is(instr, "EXIT");
+}
+
+// FNV-1a hash of the form
+static uint32_t hash_form(const char* text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int compare_labels(const void* a, const void* b) {
+    return strcmp(((const Label*)a)->name, ((const Label*)b)->name);
+}
+
+static int compare_variables(const void* a, const void* b) {
+    return strcmp(((const Variable*)a)->name, ((const Variable*)b)->name);
+}
+
+// Label of the name or NULL if no routine defines it
+static const Label* find_label(const Folding* folding, const char* name) {
+    Label key = {name, 0, 0};
+    return bsearch(&key, folding->labels, folding->label_count, sizeof(Label), compare_labels);
+}
+
+/**
+ * Splits the code into routines and collects the labels they define
+ * @param folding folding with the code set
+ * @return true on success
+ */
+static bool collect_routines(Folding* folding) {
+    const InstrList* code = folding->code;
+    int routines = 0;
+    int labels = 0;
+    for (int i = 0; i < code->count; i++) {
+        if (cfg_is_routine_label(&code->items[i])) routines++;
+        if (instr_is(&code->items[i], "LABEL") && code->items[i].argc == 1) labels++;
+    }
+    folding->routines = malloc((routines + 1) * sizeof(Routine));
+    folding->labels = malloc((labels + 1) * sizeof(Label));
+    if (!folding->routines || !folding->labels) return false;
+    
+    int current = -1;
+    for (int i = 0; i < code->count; i++) {
+        const Instr* instr = &code->items[i];
+        if (cfg_is_routine_label(instr)) {
+            if (current >= 0) {
+                folding->routines[current].last = i;
+            }
+            current = folding->routine_count++;
+            folding->routines[current] = (Routine){i, code->count, 0, 0, 0, false, true, current};
+        }
+        if (current >= 0 && instr_is(instr, "LABEL") && instr->argc == 1) {
+            int number = 0;
+            if (i != folding->routines[current].first) {
+                number = folding->labels[folding->label_count - 1].number + 1;
+            }
+            folding->labels[folding->label_count++] = (Label){instr->args[0], current, number};
+        }
+    }
+    qsort(folding->labels, folding->label_count, sizeof(Label), compare_labels);
+    return true;
+}
+
+/**
+ * Finds routines entered other than by calls of their entry label
+ * @param folding folding with the routines collected
+ */
+static void find_entries(Folding* folding) {
+    const InstrList* code = folding->code;
+    int current = -1;
+    for (int i = 0; i < code->count; i++) {
+        const Instr* instr = &code->items[i];
+        if (cfg_is_routine_label(instr)) {
+            // Code before it falls through into it
+            if (i > 0 && !is_unconditional(&code->items[i - 1])) {
+                folding->routines[current + 1].sealed = false;
+            }
+            current++;
+        }
+        if (!has_label(instr) || instr_is(instr, "LABEL")) continue;
+        
+        const Label* label = find_label(folding, instr->args[0]);
+        if (label && label->routine != current && !(instr_is(instr, "CALL") && label->number == 0)) {
+            folding->routines[label->routine].sealed = false;
+        }
+    }
+    for (int r = 0; r < folding->routine_count; r++) {
+        Routine* routine = &folding->routines[r];
+        routine->candidate = is_unconditional(&code->items[routine->last - 1]);
+    }
+}
+
+// Appends text to the forms
+static bool append_text(Folding* folding, const char* text, size_t length) {
+    if (folding->text_length + length > folding->text_capacity) {
+        size_t capacity = folding->text_capacity ? folding->text_capacity * 2 : 4096;
+        while (capacity < folding->text_length + length) {
+            capacity *= 2;
+        }
+        char* grown = realloc(folding->text, capacity);
+        if (!grown) return false;
+        folding->text = grown;
+        folding->text_capacity = capacity;
+    }
+    memcpy(folding->text + folding->text_length, text, length);
+    folding->text_length += length;
+    return true;
+}
+
+/**
+ * Collects frame variables the routine defines and may number
+ * @param folding folding
+ * @param routine routine
+ * @return true on success
+ */
+static bool collect_variables(Folding* folding, const Routine* routine) {
+    const InstrList* code = folding->code;
+    bool own_temporary = true;
+    int defvars = 0;
+    for (int i = routine->first; i < routine->last; i++) {
+        const Instr* instr = &code->items[i];
+        if (instr_is(instr, "CALL") || instr_is(instr, "PUSHFRAME")) own_temporary = false;
+        if (instr_is(instr, "DEFVAR")) defvars++;
+    }
+    
+    Variable* variables = realloc(folding->variables, (defvars + 1) * sizeof(Variable));
+    if (!variables) return false;
+    folding->variables = variables;
+    folding->variable_count = 0;
+    for (int i = routine->first; i < routine->last; i++) {
+        const Instr* instr = &code->items[i];
+        if (!instr_is(instr, "DEFVAR") || instr->argc != 1) continue;
+        
+        const char* name = instr->args[0];
+        if (strncmp(name, "LF@", 3) == 0 || (own_temporary && strncmp(name, "TF@", 3) == 0)) {
+            variables[folding->variable_count++] = (Variable){name, -1};
+        }
+    }
+    qsort(variables, folding->variable_count, sizeof(Variable), compare_variables);
+    return true;
+}
+
+/**
+ * Writes the normal form of a routine
+ * @param folding folding
+ * @param routine routine, its form is set
+ * @return true on success
+ */
+static bool write_form(Folding* folding, Routine* routine) {
+    if (!collect_variables(folding, routine)) return false;
+    
+    const InstrList* code = folding->code;
+    int numbered = 0;
+    routine->form = folding->text_length;
+    bool ok = true;
+    for (int i = routine->first; i < routine->last && ok; i++) {
+        const Instr* instr = &code->items[i];
+        ok = append_text(folding, instr->op, strlen(instr->op));
+        for (int a = 0; a < instr->argc && ok; a++) {
+            const char* arg = instr->args[a];
+            char number[32];
+            const Label* label = a == 0 && has_label(instr) ? find_label(folding, arg) : NULL;
+            Variable key = {arg, 0};
+            Variable* variable = bsearch(&key, folding->variables, folding->variable_count, sizeof(Variable),
+                                         compare_variables);
+            if (label && label->routine == routine - folding->routines) {
+                snprintf(number, sizeof(number), "%%L%d", label->number);
+                arg = number;
+            } else if (variable) {
+                if (variable->number < 0) {
+                    variable->number = numbered++;
+                }
+                snprintf(number, sizeof(number), "%.3s%%%d", arg, variable->number);
+                arg = number;
+            }
+            ok = append_text(folding, " ", 1) && append_text(folding, arg, strlen(arg));
+        }
+        ok = ok && append_text(folding, "\n", 1);
+    }
+    routine->length = folding->text_length - routine->form;
+    routine->hash = hash_form(folding->text + routine->form, routine->length);
+    return ok;
+}
+
+// Form of a routine while sorting, with the text the forms are in
+typedef struct {
+    const char* text;
+    size_t length;
+    uint32_t hash;
+    int routine;
+} Form;
+
+// Same forms next to each other, earlier routines first
+static int compare_forms(const void* a, const void* b) {
+    const Form* x = a;
+    const Form* y = b;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    if (x->length != y->length) return x->length < y->length ? -1 : 1;
+    int order = memcmp(x->text, y->text, x->length);
+    return order != 0 ? order : x->routine - y->routine;
+}
+
+// Checks if two routines have the same form
+static bool same_form(const Form* x, const Form* y) {
+    return x->hash == y->hash && x->length == y->length && memcmp(x->text, y->text, x->length) == 0;
+}
+
+/**
+ * Chooses the routine every duplicate folds into
+ * @param folding folding with the forms written
+ * @return number of folded routines, -1 on allocation failure
+ */
+static int choose_targets(Folding* folding) {
+    Form* forms = malloc((folding->routine_count + 1) * sizeof(Form));
+    if (!forms) return -1;
+    
+    int count = 0;
+    for (int r = 0; r < folding->routine_count; r++) {
+        const Routine* routine = &folding->routines[r];
+        if (routine->candidate) {
+            forms[count++] = (Form){folding->text + routine->form, routine->length, routine->hash, r};
+        }
+    }
+    qsort(forms, count, sizeof(Form), compare_forms);
+    
+    int folded = 0;
+    for (int i = 1; i < count; i++) {
+        if (!same_form(&forms[i], &forms[i - 1])) continue;
+        Routine* routine = &folding->routines[forms[i].routine];
+        const Routine* kept = &folding->routines[forms[i - 1].routine];
+        
+        // The previous one stays or folds into the one that stays
+        if (routine->sealed) {
+            routine->target = kept->target;
+            folded++;
+        }
+    }
+    free(forms);
+    return folded;
+}
+
+/**
+ * Sends calls of folded routines to their targets and removes them
+ * @param folding folding with the targets chosen
+ * @return true on success
+ */
+static bool fold_routines(Folding* folding) {
+    InstrList* code = folding->code;
+    for (int i = 0; i < code->count; i++) {
+        Instr* instr = &code->items[i];
+        if (!instr_is(instr, "CALL") || instr->argc != 1) continue;
+        
+        const Label* label = find_label(folding, instr->args[0]);
+        if (!label || label->number != 0) continue;
+        
+        const Routine* routine = &folding->routines[label->routine];
+        if (routine->target != label->routine) {
+            const char* target = code->items[folding->routines[routine->target].first].args[0];
+            if (!instr_set_arg(instr, 0, target)) return false;
+        }
+    }
+    
+    // From the last routine, so positions of the earlier ones stay
+    for (int r = folding->routine_count - 1; r >= 0; r--) {
+        const Routine* routine = &folding->routines[r];
+        if (routine->target != r) {
+            ilist_remove_range(code, routine->first, routine->last);
+        }
+    }
+    return true;
+}
+
+// Frees one round of folding
+static void folding_free(Folding* folding) {
+    free(folding->routines);
+    free(folding->labels);
+    free(folding->variables);
+    free(folding->text);
+}
+
+/**
+ * Folds routines with identical code into one
+ * @param code generated program, code before the first routine stays
+ * @param folded number of removed routines, may be NULL
+ * @return true on success, code must not be printed on failure
+ */
+bool icf_program(InstrList* code, int* folded) {
+    if (folded) *folded = 0;
+    
+    int count = 1;
+    while (count > 0) {
+        Folding folding;
+        memset(&folding, 0, sizeof(folding));
+        folding.code = code;
+        
+        bool ok = collect_routines(&folding);
+        if (ok) {
+            find_entries(&folding);
+            for (int r = 0; r < folding.routine_count && ok; r++) {
+                ok = !folding.routines[r].candidate || write_form(&folding, &folding.routines[r]);
+            }
+        }
+        count = ok ? choose_targets(&folding) : -1;
+        ok = count >= 0 && (count == 0 || fold_routines(&folding));
+        folding_free(&folding);
+        if (!ok) return false;
+        if (folded) *folded += count;
+    }
+    return true;
+}
@@ -0,0 +1,23 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * icf.h
+ * folding of routines with identical code
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef ICF_H
+#define ICF_H
+
+#include "ilist.h"
+#include <stdbool.h>
+
+// Sends calls of routines whose code is the same up to the names of their
+// labels and frame variables to the first of them and removes the others.
+// Folded is set to the number of removed routines, it may be NULL.
+bool icf_program(InstrList* code, int* folded);
+
+#endif // ICF_H
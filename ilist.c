@@ -0,0 +1,324 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * ilist.c
+ * list of generated IFJcode25 instructions
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "ilist.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Copies n characters of a string
+ * @param s string
+ * @param n number of characters
+ * @return new string, NULL on failure
+ */
+static char* copy_part(const char* s, size_t n) {
+    char* copy = malloc(n + 1);
+    if (copy) {
+        memcpy(copy, s, n);
+        copy[n] = '\0';
+    }
+    return copy;
+}
+
+/**
+ * Splits line into opcode and operands, operands never contain whitespace
+ * @param line instruction text, trailing newline is ignored
+ * @param instr instruction to fill
+ * @return true on success
+ */
+static bool instr_parse(const char* line, Instr* instr) {
+    instr->op = NULL;
+    instr->argc = 0;
+    for (int i = 0; i < INSTR_MAX_ARGS; i++) {
+        instr->args[i] = NULL;
+    }
+    
+    const char* p = line;
+    int field = 0;
+    while (*p && *p != '\n') {
+        while (*p == ' ') p++;
+        if (!*p || *p == '\n') break;
+        
+        const char* start = p;
+        while (*p && *p != ' ' && *p != '\n') p++;
+        
+        char* part = copy_part(start, p - start);
+        if (!part) return false;
+        
+        if (field == 0) {
+            instr->op = part;
+        } else if (field <= INSTR_MAX_ARGS) {
+            instr->args[instr->argc++] = part;
+        } else {
+            free(part);
+        }
+        field++;
+    }
+    
+    return instr->op != NULL;
+}
+
+/**
+ * Frees strings of one instruction
+ * @param instr instruction
+ */
+static void instr_free(Instr* instr) {
+    free(instr->op);
+    for (int i = 0; i < instr->argc; i++) {
+        free(instr->args[i]);
+    }
+}
+
+/**
+ * Makes room for one more instruction
+ * @param list instruction list
+ * @return true on success
+ */
+static bool ilist_reserve(InstrList* list) {
+    if (list->count < list->capacity) {
+        return true;
+    }
+    
+    int capacity = list->capacity ? list->capacity * 2 : 64;
+    Instr* items = realloc(list->items, capacity * sizeof(Instr));
+    if (!items) return false;
+    
+    list->items = items;
+    list->capacity = capacity;
+    return true;
+}
+
+/**
+ * Initializes an empty list
+ * @param list instruction list
+ */
+void ilist_init(InstrList* list) {
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+/**
+ * Frees all instructions of the list
+ * @param list instruction list
+ */
+void ilist_free(InstrList* list) {
+    for (int i = 0; i < list->count; i++) {
+        instr_free(&list->items[i]);
+    }
+    free(list->items);
+    ilist_init(list);
+}
+
+/**
+ * Appends instruction given as text
+ * @param list instruction list
+ * @param line instruction text
+ * @return true on success
+ */
+bool ilist_append(InstrList* list, const char* line) {
+    return ilist_insert(list, list->count, line);
+}
+
+/**
+ * Inserts instruction given as text before instruction at index
+ * @param list instruction list
+ * @param index position of the new instruction
+ * @param line instruction text
+ * @return true on success
+ */
+bool ilist_insert(InstrList* list, int index, const char* line) {
+    if (index < 0 || index > list->count || !ilist_reserve(list)) {
+        return false;
+    }
+    
+    Instr instr;
+    if (!instr_parse(line, &instr)) {
+        instr_free(&instr);
+        return false;
+    }
+    
+    memmove(&list->items[index + 1], &list->items[index], (list->count - index) * sizeof(Instr));
+    list->items[index] = instr;
+    list->count++;
+    return true;
+}
+
+/**
+ * Moves all instructions of src before instruction at index of dst
+ * @param dst instruction list
+ * @param index position of the first moved instruction
+ * @param src moved instructions, the list is empty afterwards
+ * @return true on success
+ */
+bool ilist_splice(InstrList* dst, int index, InstrList* src) {
+    if (index < 0 || index > dst->count) {
+        return false;
+    }
+    
+    if (dst->count + src->count > dst->capacity) {
+        int capacity = dst->capacity ? dst->capacity : 64;
+        while (capacity < dst->count + src->count) {
+            capacity *= 2;
+        }
+        Instr* items = realloc(dst->items, capacity * sizeof(Instr));
+        if (!items) return false;
+        dst->items = items;
+        dst->capacity = capacity;
+    }
+    
+    memmove(&dst->items[index + src->count], &dst->items[index], (dst->count - index) * sizeof(Instr));
+    if (src->count > 0) {
+        memcpy(&dst->items[index], src->items, src->count * sizeof(Instr));
+    }
+    dst->count += src->count;
+    
+    free(src->items);
+    ilist_init(src);
+    return true;
+}
+
+/**
+ * Moves the tail of src to the end of dst
+ * @param src instruction list, it keeps instructions before start
+ * @param start position of the first moved instruction
+ * @param dst instruction list
+ * @return true on success
+ */
+bool ilist_move_tail(InstrList* src, int start, InstrList* dst) {
+    if (start < 0 || start > src->count) {
+        return false;
+    }
+    
+    int moved = src->count - start;
+    int count = dst->count + moved;
+    if (count > dst->capacity) {
+        int capacity = dst->capacity ? dst->capacity : 64;
+        while (capacity < count) {
+            capacity *= 2;
+        }
+        Instr* items = realloc(dst->items, capacity * sizeof(Instr));
+        if (!items) return false;
+        dst->items = items;
+        dst->capacity = capacity;
+    }
+    
+    if (moved > 0) {
+        memcpy(&dst->items[dst->count], &src->items[start], moved * sizeof(Instr));
+    }
+    dst->count = count;
+    src->count = start;
+    return true;
+}
+
+/**
+ * Removes instruction at index
+ * @param list instruction list
+ * @param index position of the instruction
+ */
+void ilist_remove(InstrList* list, int index) {
+    if (index < 0 || index >= list->count) {
+        return;
+    }
+    
+    instr_free(&list->items[index]);
+    memmove(&list->items[index], &list->items[index + 1], (list->count - index - 1) * sizeof(Instr));
+    list->count--;
+}
+
+/**
+ * Removes instructions in range
+ * @param list instruction list
+ * @param start position of the first removed instruction
+ * @param end position after the last removed instruction
+ */
+void ilist_remove_range(InstrList* list, int start, int end) {
+    if (start < 0 || end > list->count || start >= end) {
+        return;
+    }
+    
+    for (int i = start; i < end; i++) {
+        instr_free(&list->items[i]);
+    }
+    memmove(&list->items[start], &list->items[end], (list->count - end) * sizeof(Instr));
+    list->count -= end - start;
+}
+
+/**
+ * Removes all instructions from index count to the end
+ * @param list instruction list
+ * @param count number of instructions kept
+ */
+void ilist_truncate(InstrList* list, int count) {
+    while (list->count > count && list->count > 0) {
+        instr_free(&list->items[--list->count]);
+    }
+}
+
+/**
+ * Gets last instruction
+ * @param list instruction list
+ * @return last instruction or NULL when the list is empty
+ */
+Instr* ilist_last(InstrList* list) {
+    return list->count > 0 ? &list->items[list->count - 1] : NULL;
+}
+
+/**
+ * Replaces operand of an instruction
+ * @param instr instruction
+ * @param index operand index, at most one past the last operand
+ * @param value new operand text
+ * @return true on success
+ */
+bool instr_set_arg(Instr* instr, int index, const char* value) {
+    if (index < 0 || index > instr->argc || index >= INSTR_MAX_ARGS) {
+        return false;
+    }
+    
+    char* copy = copy_part(value, strlen(value));
+    if (!copy) return false;
+    
+    if (index == instr->argc) {
+        instr->argc++;
+    } else {
+        free(instr->args[index]);
+    }
+    instr->args[index] = copy;
+    return true;
+}
+
+/**
+ * Checks opcode of an instruction
+ * @param instr instruction
+ * @param op opcode
+ * @return true if instruction has the opcode
+ */
+bool instr_is(const Instr* instr, const char* op) {
+    return instr && strcmp(instr->op, op) == 0;
+}
+
+/**
+ * Prints instructions
+ * @param list instruction list
+ * @param output output file
+ */
+void ilist_write(const InstrList* list, FILE* output) {
+    for (int i = 0; i < list->count; i++) {
+        const Instr* instr = &list->items[i];
+        fputs(instr->op, output);
+        for (int j = 0; j < instr->argc; j++) {
+            fputc(' ', output);
+            fputs(instr->args[j], output);
+        }
+        fputc('\n', output);
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * ilist.h
+ * list of generated IFJcode25 instructions
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef ILIST_H
+#define ILIST_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#define INSTR_MAX_ARGS 3
+
+// One instruction, operands are stored exactly as they are printed
+typedef struct Instr {
+    char* op;
+    char* args[INSTR_MAX_ARGS];
+    int argc;
+} Instr;
+
+// Growable array of instructions
+typedef struct InstrList {
+    Instr* items;
+    int count;
+    int capacity;
+} InstrList;
+
+// Initialize an empty list
+void ilist_init(InstrList* list);
+
+// Free all instructions of the list
+void ilist_free(InstrList* list);
+
+// Split line "OP arg1 arg2" and append it
+bool ilist_append(InstrList* list, const char* line);
+
+// Split line and insert it before instruction at index
+bool ilist_insert(InstrList* list, int index, const char* line);
+
+// Move all instructions of src before instruction at index, src is emptied
+bool ilist_splice(InstrList* dst, int index, InstrList* src);
+
+// Move instructions of src from index start to the end of dst
+bool ilist_move_tail(InstrList* src, int start, InstrList* dst);
+
+// Remove instruction at index
+void ilist_remove(InstrList* list, int index);
+
+// Remove instructions from index start up to end (exclusive)
+void ilist_remove_range(InstrList* list, int start, int end);
+
+// Remove all instructions from index to the end
+void ilist_truncate(InstrList* list, int count);
+
+// Last instruction or NULL when empty
+Instr* ilist_last(InstrList* list);
+
+// Replace operand of an instruction
+bool instr_set_arg(Instr* instr, int index, const char* value);
+
+// Check opcode of an instruction
+bool instr_is(const Instr* instr, const char* op);
+
+// Print all instructions, one per line
+void ilist_write(const InstrList* list, FILE* output);
+
+#endif // ILIST_H
@@ -0,0 +1,83 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * instrument.c
+ * execution counters of an instrumented build
+ *
+ * Every counter is a GF@%c<id> variable incremented by a single ADD. The
+ * program prints the table of all counters by DPRINT when main returns,
+ * the sidecar map tells where in the source each id belongs.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "instrument.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* kind_names[] = {"entry", "loop", "then", "else"};
+
+/**
+ * Initializes an empty list
+ * @param list counter list
+ */
+void counters_init(CounterList* list) {
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+/**
+ * Frees the list
+ * @param list counter list
+ */
+void counters_free(CounterList* list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i].function);
+    }
+    free(list->items);
+    counters_init(list);
+}
+
+/**
+ * Adds counter
+ * @param list counter list
+ * @param kind what is counted
+ * @param function name of the function the counter is in
+ * @param line source line
+ * @param column source column
+ * @return id of the counter, -1 on failure
+ */
+int counters_add(CounterList* list, CounterKind kind, const char* function, int line, int column) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 32;
+        Counter* items = realloc(list->items, capacity * sizeof(Counter));
+        if (!items) return -1;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    
+    char* copy = malloc(strlen(function) + 1);
+    if (!copy) return -1;
+    strcpy(copy, function);
+    
+    list->items[list->count] = (Counter){kind, copy, line, column};
+    return list->count++;
+}
+
+/**
+ * Writes map from counter ids to the source
+ * @param list counter list
+ * @param output map file
+ * @return true on success
+ */
+bool counters_write_map(const CounterList* list, FILE* output) {
+    for (int i = 0; i < list->count; i++) {
+        const Counter* counter = &list->items[i];
+        fprintf(output, "%d %s %s %d:%d\n", i, kind_names[counter->kind],
+                counter->function, counter->line, counter->column);
+    }
+    return !ferror(output);
+}
@@ -0,0 +1,52 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * instrument.h
+ * execution counters of an instrumented build
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// What a counter counts
+typedef enum {
+    COUNTER_ENTRY,      // calls of a function
+    COUNTER_LOOP,       // iterations of a loop
+    COUNTER_THEN,       // runs of the then block of if
+    COUNTER_ELSE        // runs of the else block of if
+} CounterKind;
+
+// Counter GF@%c<id>, id is the index in the list
+typedef struct Counter {
+    CounterKind kind;
+    char* function;
+    int line;
+    int column;
+} Counter;
+
+typedef struct CounterList {
+    Counter* items;
+    int count;
+    int capacity;
+} CounterList;
+
+// Initialize an empty list
+void counters_init(CounterList* list);
+
+// Free the list
+void counters_free(CounterList* list);
+
+// Add counter, returns its id or -1 on allocation failure
+int counters_add(CounterList* list, CounterKind kind, const char* function, int line, int column);
+
+// Write sidecar map, one "id kind function line:column" line per counter
+bool counters_write_map(const CounterList* list, FILE* output);
+
+#endif // INSTRUMENT_H
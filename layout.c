@@ -0,0 +1,605 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * layout.c
+ * placement of functions and blocks in the generated code
+ *
+ * The program is split into routines at their entry labels ($name for
+ * functions, $%name for built-in helpers). Blocks that can only end with
+ * EXIT are moved behind the rest of their routine, so the hot path falls
+ * through. Routines are then ordered by the Pettis-Hansen algorithm: the
+ * pairs of routines with the heaviest calls between them are placed next
+ * to each other first. Calls inside loops weigh more.
+ *
+ * With a profile, blocks whose entry label never executed are cold too and
+ * calls weigh as much as the count of the block they are in. Runs of labels
+ * are merged first, so labels starting with $ are the only ones left where
+ * a profile can name a block.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "layout.h"
+#include "cfg.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Weight of a call is multiplied by this for every enclosing loop
+#define LOOP_WEIGHT_SHIFT 3
+#define MAX_LOOP_DEPTH 4
+
+// Function or helper routine with its code
+typedef struct {
+    const char* name;    // entry label, owned by the first instruction
+    InstrList code;
+} Routine;
+
+// Candidate pair of routines for placing next to each other
+typedef struct {
+    int a;
+    int b;
+    long weight;
+} CallEdge;
+
+// Sequence of routines that stay together
+typedef struct {
+    int* items;
+    int count;
+    long weight;
+} Chain;
+
+/**
+ * Appends instruction to the list, the list becomes its owner
+ * @param list instruction list
+ * @param instr moved instruction
+ * @return true on success
+ */
+static bool move_instr(InstrList* list, const Instr* instr) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        Instr* items = realloc(list->items, capacity * sizeof(Instr));
+        if (!items) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = *instr;
+    return true;
+}
+
+// Checks if label keeps its name between builds, the parser numbers the
+// others within their function ($name%L0)
+static bool is_stable_label(const char* label) {
+    const char* kind = strchr(label, '%');
+    return label[0] == '$' && !(kind && kind[1] == 'L' && isdigit((unsigned char)kind[2]));
+}
+
+// Checks if execution never continues with the next instruction
+static bool is_unconditional(const Instr* instr) {
+    return instr_is(instr, "JUMP") || instr_is(instr, "RETURN") || instr_is(instr, "EXIT");
+}
+
+// Gets inverted conditional jump, NULL if the instruction is not one
+static const char* inverted_jump(const Instr* instr) {
+    if (instr_is(instr, "JUMPIFEQ")) return "JUMPIFNEQ";
+    if (instr_is(instr, "JUMPIFNEQ")) return "JUMPIFEQ";
+    if (instr_is(instr, "JUMPIFEQS")) return "JUMPIFNEQS";
+    if (instr_is(instr, "JUMPIFNEQS")) return "JUMPIFEQS";
+    return NULL;
+}
+
+// Gets target label of a jump, NULL for other instructions
+static const char* jump_target(const Instr* instr) {
+    if (instr_is(instr, "JUMP") || inverted_jump(instr)) {
+        return instr->argc > 0 ? instr->args[0] : NULL;
+    }
+    return NULL;
+}
+
+// Label renamed to another label at the same place
+typedef struct {
+    const char* from;
+    const char* to;
+} LabelAlias;
+
+// Orders aliases by the renamed label
+static int compare_aliases(const void* a, const void* b) {
+    return strcmp(((const LabelAlias*)a)->from, ((const LabelAlias*)b)->from);
+}
+
+/**
+ * Keeps one label of every run of consecutive labels, jumps to the others
+ * are redirected to it. Labels starting with $ are always kept.
+ * @param code whole program
+ * @return true on success
+ */
+static bool merge_label_runs(InstrList* code) {
+    LabelAlias* aliases = malloc((code->count + 1) * sizeof(LabelAlias));
+    bool* removed = calloc(code->count + 1, sizeof(bool));
+    if (!aliases || !removed) {
+        free(aliases);
+        free(removed);
+        return false;
+    }
+    
+    int alias_count = 0;
+    for (int i = 0; i < code->count; ) {
+        int end = i;
+        while (end < code->count && instr_is(&code->items[end], "LABEL")) end++;
+        if (end == i) {
+            i++;
+            continue;
+        }
+        
+        // Stable label of the run is preferred
+        int kept = i;
+        for (int j = i; j < end; j++) {
+            if (is_stable_label(code->items[j].args[0])) {
+                kept = j;
+                break;
+            }
+        }
+        for (int j = i; j < end; j++) {
+            if (j != kept && !is_stable_label(code->items[j].args[0])) {
+                aliases[alias_count++] = (LabelAlias){code->items[j].args[0], code->items[kept].args[0]};
+                removed[j] = true;
+            }
+        }
+        i = end;
+    }
+    
+    qsort(aliases, alias_count, sizeof(LabelAlias), compare_aliases);
+    
+    bool ok = true;
+    for (int i = 0; i < code->count && ok && alias_count > 0; i++) {
+        Instr* instr = &code->items[i];
+        if (!jump_target(instr) && !instr_is(instr, "CALL")) continue;
+        
+        LabelAlias key = {instr->args[0], NULL};
+        LabelAlias* alias = bsearch(&key, aliases, alias_count, sizeof(LabelAlias), compare_aliases);
+        if (alias) {
+            ok = instr_set_arg(instr, 0, alias->to);
+        }
+    }
+    
+    // Removed labels are freed only after all jumps are renamed
+    int count = 0;
+    for (int i = 0; i < code->count; i++) {
+        if (removed[i] && ok) {
+            free(code->items[i].op);
+            free(code->items[i].args[0]);
+        } else {
+            code->items[count++] = code->items[i];
+        }
+    }
+    code->count = count;
+    
+    free(aliases);
+    free(removed);
+    return ok;
+}
+
+/**
+ * Finds end of a cold block, the block runs straight to EXIT
+ * @param code routine code
+ * @param start first instruction of the block
+ * @return index of the EXIT or -1
+ */
+static int find_cold_end(const InstrList* code, int start) {
+    for (int i = start; i < code->count; i++) {
+        const Instr* instr = &code->items[i];
+        if (instr_is(instr, "EXIT")) return i;
+        if (is_unconditional(instr) || (i > start && instr_is(instr, "LABEL"))) return -1;
+    }
+    return -1;
+}
+
+/**
+ * Finds end of a block that never executed according to the profile. The
+ * block starts with a label and contains only labels that never executed,
+ * it ends with an unconditional instruction or by falling into a label.
+ * Interpreter lists only executed labels, so a missing stable label is 0.
+ * @param code routine code
+ * @param start first instruction of the block
+ * @param profile label counts
+ * @return index of the last instruction of the block or -1
+ */
+static int find_unexecuted_end(const InstrList* code, int start, const Profile* profile) {
+    if (!instr_is(&code->items[start], "LABEL")) return -1;
+    
+    for (int i = start; i < code->count; i++) {
+        const Instr* instr = &code->items[i];
+        long count = 0;
+        if (instr_is(instr, "LABEL") && (!is_stable_label(instr->args[0]) ||
+            (profile_count(profile, instr->args[0], &count) && count > 0))) {
+            return i > start ? i - 1 : -1;
+        }
+        if (is_unconditional(instr)) {
+            // Unreachable code behind it goes along
+            while (i + 1 < code->count && !instr_is(&code->items[i + 1], "LABEL")) i++;
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Removes jumps to the label right behind them
+ * @param code routine code
+ */
+static void drop_jumps_to_next(InstrList* code) {
+    int count = 0;
+    for (int i = 0; i < code->count; i++) {
+        Instr* instr = &code->items[i];
+        if (instr_is(instr, "JUMP") && i + 1 < code->count && instr_is(&code->items[i + 1], "LABEL") &&
+            strcmp(instr->args[0], code->items[i + 1].args[0]) == 0) {
+            free(instr->op);
+            free(instr->args[0]);
+            continue;
+        }
+        code->items[count++] = *instr;
+    }
+    code->count = count;
+}
+
+/**
+ * Moves blocks ending with EXIT, and with a profile blocks that never
+ * executed, to the end of the routine. A block entered by falling through
+ * a conditional jump gets the jump inverted, a block that falls out gets
+ * a jump to where it fell.
+ * @param code routine code, ending with an unconditional instruction
+ * @param profile label counts or NULL
+ * @return true on success
+ */
+static bool split_cold_blocks(InstrList* code, const Profile* profile) {
+    if (code->count == 0 || !is_unconditional(&code->items[code->count - 1])) {
+        return true;
+    }
+    
+    // Blocks of a routine that ran are cold when they did not
+    long entry_count;
+    bool profiled = profile_count(profile, code->items[0].args[0], &entry_count) && entry_count > 0;
+    
+    InstrList hot, cold;
+    ilist_init(&hot);
+    ilist_init(&cold);
+    bool ok = true;
+    
+    for (int i = 0; i < code->count && ok; i++) {
+        Instr* prev = hot.count > 0 ? &hot.items[hot.count - 1] : NULL;
+        int end = prev ? find_cold_end(code, i) : -1;
+        if (end < 0 && prev && profiled) {
+            end = find_unexecuted_end(code, i, profile);
+        }
+        
+        bool entered_by_jump = end >= 0 && instr_is(&code->items[i], "LABEL") && is_unconditional(prev);
+        bool skipped_by_branch = end >= 0 && end + 1 < code->count && inverted_jump(prev) &&
+            instr_is(&code->items[end + 1], "LABEL") &&
+            strcmp(code->items[end + 1].args[0], prev->args[0]) == 0;
+        
+        if (!entered_by_jump && !skipped_by_branch) {
+            ok = move_instr(&hot, &code->items[i]);
+            continue;
+        }
+        
+        if (skipped_by_branch) {
+            // Branch now jumps to the moved block and falls through otherwise
+            size_t len = strlen(prev->args[0]);
+            char* label = malloc(len + 6);
+            char* op = malloc(strlen(inverted_jump(prev)) + 1);
+            char* line = label ? malloc(len + 12) : NULL;
+            ok = label && op && line;
+            if (ok) {
+                sprintf(label, "%s%%cold", prev->args[0]);
+                strcpy(op, inverted_jump(prev));
+                sprintf(line, "LABEL %s", label);
+                ok = instr_set_arg(prev, 0, label) && ilist_append(&cold, line);
+                free(prev->op);
+                prev->op = op;
+                op = NULL;
+            }
+            free(label);
+            free(op);
+            free(line);
+        }
+        
+        for (int j = i; j <= end && ok; j++) {
+            ok = move_instr(&cold, &code->items[j]);
+        }
+        if (ok && !is_unconditional(&code->items[end])) {
+            char* line = malloc(strlen(code->items[end + 1].args[0]) + 6);
+            ok = line != NULL;
+            if (ok) {
+                sprintf(line, "JUMP %s", code->items[end + 1].args[0]);
+                ok = ilist_append(&cold, line);
+                free(line);
+            }
+        }
+        i = end;
+    }
+    
+    for (int i = 0; i < cold.count && ok; i++) {
+        ok = move_instr(&hot, &cold.items[i]);
+    }
+    
+    if (!ok) {
+        // Instructions are shared by the lists, only the arrays are freed
+        free(hot.items);
+        free(cold.items);
+        return false;
+    }
+    
+    free(cold.items);
+    free(code->items);
+    *code = hot;
+    drop_jumps_to_next(code);
+    return true;
+}
+
+/**
+ * Adds weights of calls from routine caller to the weight matrix
+ * @param routines all routines
+ * @param n number of routines
+ * @param caller index of the calling routine
+ * @param profile label counts or NULL
+ * @param weights n x n matrix of call weights
+ */
+static bool add_call_weights(const Routine* routines, int n, int caller, const Profile* profile, long* weights) {
+    const InstrList* code = &routines[caller].code;
+    int* depth = calloc(code->count + 1, sizeof(int));
+    if (!depth) return false;
+    
+    // Backward jump closes a loop starting at its target
+    for (int j = 0; j < code->count; j++) {
+        const char* target = jump_target(&code->items[j]);
+        if (!target) continue;
+        for (int l = 0; l < j; l++) {
+            if (instr_is(&code->items[l], "LABEL") && strcmp(code->items[l].args[0], target) == 0) {
+                for (int k = l; k <= j; k++) {
+                    depth[k]++;
+                }
+                break;
+            }
+        }
+    }
+    
+    // Profile count of the block the instruction is in, -1 when unknown
+    long block_count = -1;
+    
+    for (int i = 0; i < code->count; i++) {
+        const Instr* instr = &code->items[i];
+        if (instr_is(instr, "LABEL") && !profile_count(profile, instr->args[0], &block_count)) {
+            block_count = -1;
+        }
+        if (!instr_is(instr, "CALL") || instr->argc != 1) continue;
+        
+        for (int callee = 0; callee < n; callee++) {
+            if (callee != caller && strcmp(routines[callee].name, instr->args[0]) == 0) {
+                int loops = depth[i] < MAX_LOOP_DEPTH ? depth[i] : MAX_LOOP_DEPTH;
+                weights[caller * n + callee] += block_count >= 0 ? block_count : 1L << (LOOP_WEIGHT_SHIFT * loops);
+                break;
+            }
+        }
+    }
+    
+    free(depth);
+    return true;
+}
+
+// Heavier edges first, ties in source order
+static int compare_edges(const void* a, const void* b) {
+    const CallEdge* x = a;
+    const CallEdge* y = b;
+    if (x->weight != y->weight) return x->weight > y->weight ? -1 : 1;
+    if (x->a != y->a) return x->a - y->a;
+    return x->b - y->b;
+}
+
+// Heavier chains first, ties in source order of their first routine
+static int compare_chains(const void* a, const void* b) {
+    const Chain* x = a;
+    const Chain* y = b;
+    if (x->weight != y->weight) return x->weight > y->weight ? -1 : 1;
+    int min_x = x->items[0], min_y = y->items[0];
+    for (int i = 1; i < x->count; i++) if (x->items[i] < min_x) min_x = x->items[i];
+    for (int i = 1; i < y->count; i++) if (y->items[i] < min_y) min_y = y->items[i];
+    return min_x - min_y;
+}
+
+// Position of routine in the chain
+static int chain_index(const Chain* chain, int routine) {
+    for (int i = 0; i < chain->count; i++) {
+        if (chain->items[i] == routine) return i;
+    }
+    return -1;
+}
+
+// Reverses order of the chain
+static void chain_reverse(Chain* chain) {
+    for (int i = 0, j = chain->count - 1; i < j; i++, j--) {
+        int swap = chain->items[i];
+        chain->items[i] = chain->items[j];
+        chain->items[j] = swap;
+    }
+}
+
+/**
+ * Joins chain src behind dst so that routines a (in dst) and b (in src)
+ * end up as close as possible
+ */
+static bool chain_merge(Chain* dst, Chain* src, int a, int b, long weight) {
+    int* items = realloc(dst->items, (dst->count + src->count) * sizeof(int));
+    if (!items) return false;
+    dst->items = items;
+    
+    // a should be at the end of dst and b at the start of src
+    if (chain_index(dst, a) < dst->count - 1 - chain_index(dst, a)) {
+        chain_reverse(dst);
+    }
+    if (chain_index(src, b) > src->count - 1 - chain_index(src, b)) {
+        chain_reverse(src);
+    }
+    
+    memcpy(dst->items + dst->count, src->items, src->count * sizeof(int));
+    dst->count += src->count;
+    dst->weight += src->weight + weight;
+    
+    free(src->items);
+    src->items = NULL;
+    src->count = 0;
+    return true;
+}
+
+/**
+ * Orders routines by Pettis-Hansen chain merging
+ * @param routines all routines
+ * @param n number of routines
+ * @param profile label counts or NULL
+ * @param order filled with routine indices in the new order
+ * @return true on success
+ */
+static bool order_routines(const Routine* routines, int n, const Profile* profile, int* order) {
+    long* weights = calloc((size_t)n * n, sizeof(long));
+    CallEdge* edges = malloc(((size_t)n * n / 2 + 1) * sizeof(CallEdge));
+    Chain* chains = calloc(n, sizeof(Chain));
+    int* chain_of = malloc(n * sizeof(int));
+    bool ok = weights && edges && chains && chain_of;
+    
+    for (int i = 0; i < n && ok; i++) {
+        ok = add_call_weights(routines, n, i, profile, weights);
+        chains[i].items = malloc(sizeof(int));
+        ok = ok && chains[i].items;
+        if (ok) {
+            chains[i].items[0] = i;
+            chains[i].count = 1;
+            chain_of[i] = i;
+        }
+    }
+    
+    // Calls in both directions count for the pair
+    int edge_count = 0;
+    for (int a = 0; a < n && ok; a++) {
+        for (int b = a + 1; b < n; b++) {
+            long weight = weights[a * n + b] + weights[b * n + a];
+            if (weight > 0) {
+                edges[edge_count++] = (CallEdge){a, b, weight};
+            }
+        }
+    }
+    if (ok) {
+        qsort(edges, edge_count, sizeof(CallEdge), compare_edges);
+    }
+    
+    for (int i = 0; i < edge_count && ok; i++) {
+        int ca = chain_of[edges[i].a];
+        int cb = chain_of[edges[i].b];
+        if (ca == cb) continue;
+        
+        ok = chain_merge(&chains[ca], &chains[cb], edges[i].a, edges[i].b, edges[i].weight);
+        for (int j = 0; j < chains[ca].count && ok; j++) {
+            chain_of[chains[ca].items[j]] = ca;
+        }
+    }
+    
+    if (ok) {
+        // Chain of main goes first, the rest by weight
+        int main_chain = -1;
+        for (int i = 0; i < n; i++) {
+            if (strcmp(routines[i].name, "$main") == 0) main_chain = chain_of[i];
+        }
+        
+        int count = 0;
+        if (main_chain >= 0) {
+            Chain swap = chains[0];
+            chains[0] = chains[main_chain];
+            chains[main_chain] = swap;
+        }
+        for (int i = 0; i < n; i++) {
+            if (chains[i].count > 0) chains[count++] = chains[i];
+        }
+        for (int i = count; i < n; i++) {
+            chains[i] = (Chain){NULL, 0, 0};
+        }
+        int first = main_chain >= 0 ? 1 : 0;
+        qsort(chains + first, count - first, sizeof(Chain), compare_chains);
+        
+        int k = 0;
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < chains[i].count; j++) {
+                order[k++] = chains[i].items[j];
+            }
+        }
+    }
+    
+    for (int i = 0; chains && i < n; i++) {
+        free(chains[i].items);
+    }
+    free(weights);
+    free(edges);
+    free(chains);
+    free(chain_of);
+    return ok;
+}
+
+/**
+ * Reorders the program for better locality
+ * @param code whole program
+ * @param profile label counts or NULL
+ * @return true on success, code must not be printed on failure
+ */
+bool layout_program(InstrList* code, const Profile* profile) {
+    if (!merge_label_runs(code)) {
+        return false;
+    }
+    
+    int n = 0;
+    for (int i = 0; i < code->count; i++) {
+        if (cfg_is_routine_label(&code->items[i])) n++;
+    }
+    if (n == 0) return true;
+    
+    Routine* routines = calloc(n, sizeof(Routine));
+    int* order = malloc(n * sizeof(int));
+    InstrList result;
+    ilist_init(&result);
+    bool ok = routines && order;
+    
+    // Split the program, code before the first routine is the entry
+    int r = -1;
+    for (int i = 0; i < code->count && ok; i++) {
+        if (cfg_is_routine_label(&code->items[i])) {
+            routines[++r].name = code->items[i].args[0];
+        }
+        ok = move_instr(r < 0 ? &result : &routines[r].code, &code->items[i]);
+    }
+    
+    for (int i = 0; i < n && ok; i++) {
+        ok = split_cold_blocks(&routines[i].code, profile);
+    }
+    ok = ok && order_routines(routines, n, profile, order);
+    
+    for (int i = 0; i < n && ok; i++) {
+        InstrList* routine = &routines[order[i]].code;
+        for (int j = 0; j < routine->count && ok; j++) {
+            ok = move_instr(&result, &routine->items[j]);
+        }
+    }
+    
+    if (ok) {
+        free(code->items);
+        *code = result;
+    } else {
+        // Instructions may already be shared or changed, drop them all
+        free(result.items);
+        code->count = 0;
+    }
+    
+    for (int i = 0; routines && i < n; i++) {
+        free(routines[i].code.items);
+    }
+    free(routines);
+    free(order);
+    return ok;
+}
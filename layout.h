@@ -0,0 +1,24 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * layout.h
+ * placement of functions and blocks in the generated code
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "ilist.h"
+#include "profile.h"
+#include <stdbool.h>
+
+// Moves cold blocks to the end of each routine and orders routines by call
+// graph affinity. Code before the first routine label stays first.
+// Profile is optional.
+bool layout_program(InstrList* code, const Profile* profile);
+
+#endif // LAYOUT_H
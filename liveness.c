@@ -0,0 +1,417 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * liveness.c
+ * liveness of frame variables and sharing of their slots
+ *
+ * Every routine is split into basic blocks and the variables of its frame
+ * (LF@, or TF@ in a routine without PUSHFRAME) that it defines itself are
+ * analysed backwards. Two variables interfere when one is written while the
+ * other is live, a copy does not make its source interfere. Variables are
+ * then coloured greedily, all variables of one colour share the slot named
+ * after the first of them and copies between them disappear. A variable
+ * that is never read is dropped, its values are popped or read into the
+ * scratch register. Parameters passed by --frame-args are defined by the
+ * caller and keep their names.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "liveness.h"
+#include "cfg.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Routines with more variables keep them all
+#define MAX_VARIABLES 2048
+
+typedef uint64_t Word;
+#define WORD_BITS 64
+
+// Instructions with a first operand they do not write, SETCHAR changes it only partly
+static const char* const reading_ops[] = {
+    "PUSHS", "WRITE", "EXIT", "DPRINT", "LABEL", "CALL", "SETCHAR",
+    "JUMP", "JUMPIFEQ", "JUMPIFNEQ", "JUMPIFEQS", "JUMPIFNEQS", NULL
+};
+
+// Variables of a block
+typedef struct {
+    Word* gen;           // read before written in the block
+    Word* kill;          // written in the block
+    Word* in;            // live at its start
+    Word* out;           // live at its end
+} BlockSets;
+
+// Frame variables of one routine
+typedef struct {
+    InstrList* code;
+    int first;           // routine code first..last
+    int last;
+    const char* prefix;  // LF@ or TF@
+    char** names;        // operands of the variables
+    int count;
+    int capacity;
+    int words;           // words of a set of variables
+    int* def;            // variable written by each instruction or -1
+    int* use;            // variables read by each instruction, INSTR_MAX_ARGS per instruction
+    bool* read;
+    bool* removable;
+    Word* interfere;     // count sets, one per variable
+    Cfg cfg;
+    BlockSets* sets;     // one per block of the graph
+} Frame;
+
+// Checks if op is in the NULL terminated list
+static bool op_in(const char* op, const char* const* list) {
+    for (int i = 0; list[i]; i++) {
+        if (strcmp(op, list[i]) == 0) return true;
+    }
+    return false;
+}
+
+static bool set_has(const Word* set, int index) {
+    return (set[index / WORD_BITS] >> (index % WORD_BITS)) & 1;
+}
+
+static void set_add(Word* set, int index) {
+    set[index / WORD_BITS] |= (Word)1 << (index % WORD_BITS);
+}
+
+static void set_remove(Word* set, int index) {
+    set[index / WORD_BITS] &= ~((Word)1 << (index % WORD_BITS));
+}
+
+// Index of the variable, -1 for other operands
+static int find_variable(const Frame* frame, const char* operand) {
+    if (strncmp(operand, frame->prefix, 3) != 0) return -1;
+    for (int i = 0; i < frame->count; i++) {
+        if (strcmp(frame->names[i], operand) == 0) return i;
+    }
+    return -1;
+}
+
+// Variables are the ones the routine defines itself
+static bool collect_variables(Frame* frame) {
+    for (int i = frame->first; i < frame->last; i++) {
+        const Instr* instr = &frame->code->items[i];
+        if (!instr_is(instr, "DEFVAR") || strncmp(instr->args[0], frame->prefix, 3) != 0 ||
+            find_variable(frame, instr->args[0]) >= 0) {
+            continue;
+        }
+        if (frame->count == frame->capacity) {
+            int capacity = frame->capacity ? frame->capacity * 2 : 16;
+            char** names = realloc(frame->names, capacity * sizeof(char*));
+            if (!names) return false;
+            frame->names = names;
+            frame->capacity = capacity;
+        }
+        frame->names[frame->count] = malloc(strlen(instr->args[0]) + 1);
+        if (!frame->names[frame->count]) return false;
+        strcpy(frame->names[frame->count++], instr->args[0]);
+    }
+    return true;
+}
+
+// Variables written and read by every instruction
+static bool classify_instructions(Frame* frame) {
+    int count = frame->last - frame->first;
+    frame->def = malloc(count * sizeof(int));
+    frame->use = malloc(count * INSTR_MAX_ARGS * sizeof(int));
+    frame->read = calloc(frame->count, sizeof(bool));
+    frame->removable = malloc(frame->count * sizeof(bool));
+    if (!frame->def || !frame->use || !frame->read || !frame->removable) return false;
+    
+    for (int v = 0; v < frame->count; v++) {
+        frame->removable[v] = true;
+    }
+    for (int i = 0; i < count; i++) {
+        const Instr* instr = &frame->code->items[frame->first + i];
+        bool writes = instr->argc > 0 && !op_in(instr->op, reading_ops);
+        frame->def[i] = writes ? find_variable(frame, instr->args[0]) : -1;
+        for (int j = 0; j < INSTR_MAX_ARGS; j++) {
+            int v = j < instr->argc && (j > 0 || !writes) ? find_variable(frame, instr->args[j]) : -1;
+            frame->use[i * INSTR_MAX_ARGS + j] = v;
+            if (v >= 0) frame->read[v] = true;
+        }
+        
+        // Values of an unread variable can be dropped or popped elsewhere
+        int v = frame->def[i];
+        if (v >= 0 && !instr_is(instr, "DEFVAR") && !instr_is(instr, "MOVE") &&
+            !instr_is(instr, "POPS") && !instr_is(instr, "READ")) {
+            frame->removable[v] = false;
+        }
+    }
+    for (int v = 0; v < frame->count; v++) {
+        frame->removable[v] = frame->removable[v] && !frame->read[v];
+    }
+    return true;
+}
+
+// Splits routine into blocks and allocates their sets
+static bool build_blocks(Frame* frame) {
+    if (!cfg_build(&frame->cfg, frame->code, frame->first, frame->last)) return false;
+    frame->sets = calloc(frame->cfg.block_count > 0 ? frame->cfg.block_count : 1, sizeof(BlockSets));
+    if (!frame->sets) return false;
+    
+    for (int i = 0; i < frame->cfg.block_count; i++) {
+        BlockSets* sets = &frame->sets[i];
+        sets->gen = calloc(frame->words * 4, sizeof(Word));
+        if (!sets->gen) return false;
+        sets->kill = sets->gen + frame->words;
+        sets->in = sets->kill + frame->words;
+        sets->out = sets->in + frame->words;
+    }
+    return true;
+}
+
+// Variables live at the ends of blocks, iterated until nothing changes
+static void compute_liveness(Frame* frame) {
+    const Cfg* cfg = &frame->cfg;
+    for (int b = 0; b < cfg->block_count; b++) {
+        const CfgBlock* block = &cfg->blocks[b];
+        BlockSets* sets = &frame->sets[b];
+        for (int i = block->end - 1; i >= block->start; i--) {
+            int index = i - frame->first;
+            if (frame->def[index] >= 0) {
+                set_add(sets->kill, frame->def[index]);
+                set_remove(sets->gen, frame->def[index]);
+            }
+            for (int j = 0; j < INSTR_MAX_ARGS; j++) {
+                int v = frame->use[index * INSTR_MAX_ARGS + j];
+                if (v >= 0) set_add(sets->gen, v);
+            }
+        }
+    }
+    
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = cfg->block_count - 1; b >= 0; b--) {
+            const CfgBlock* block = &cfg->blocks[b];
+            BlockSets* sets = &frame->sets[b];
+            for (int w = 0; w < frame->words; w++) {
+                Word out = 0;
+                for (int s = 0; s < block->succ_count; s++) {
+                    out |= frame->sets[block->succ[s]].in[w];
+                }
+                Word in = sets->gen[w] | (out & ~sets->kill[w]);
+                changed = changed || in != sets->in[w];
+                sets->out[w] = out;
+                sets->in[w] = in;
+            }
+        }
+    }
+}
+
+static void add_interference(Frame* frame, int a, int b) {
+    set_add(&frame->interfere[a * frame->words], b);
+    set_add(&frame->interfere[b * frame->words], a);
+}
+
+// Variable written while another one is live interferes with it
+static bool compute_interference(Frame* frame) {
+    frame->interfere = calloc((size_t)frame->count * frame->words, sizeof(Word));
+    Word* live = malloc(frame->words * sizeof(Word));
+    if (!frame->interfere || !live) {
+        free(live);
+        return false;
+    }
+    
+    for (int b = 0; b < frame->cfg.block_count; b++) {
+        const CfgBlock* block = &frame->cfg.blocks[b];
+        memcpy(live, frame->sets[b].out, frame->words * sizeof(Word));
+        for (int i = block->end - 1; i >= block->start; i--) {
+            int index = i - frame->first;
+            int d = frame->def[index];
+            if (d >= 0) {
+                // Copy leaves source and destination equal, they may share the slot
+                const Instr* instr = &frame->code->items[i];
+                int source = instr_is(instr, "MOVE") ? frame->use[index * INSTR_MAX_ARGS + 1] : -1;
+                for (int v = 0; v < frame->count; v++) {
+                    if (v != d && v != source && set_has(live, v)) add_interference(frame, d, v);
+                }
+                set_remove(live, d);
+            }
+            for (int j = 0; j < INSTR_MAX_ARGS; j++) {
+                int v = frame->use[index * INSTR_MAX_ARGS + j];
+                if (v >= 0) set_add(live, v);
+            }
+        }
+    }
+    
+    // Variables read before any write at the entry must stay apart
+    if (frame->cfg.block_count > 0) {
+        const Word* entry = frame->sets[0].in;
+        for (int a = 0; a < frame->count; a++) {
+            for (int b = a + 1; b < frame->count && set_has(entry, a); b++) {
+                if (set_has(entry, b)) add_interference(frame, a, b);
+            }
+        }
+    }
+    free(live);
+    return true;
+}
+
+/**
+ * Gives each kept variable the first variable of its slot, greedy colouring
+ * in the order of definition
+ * @param frame analysed routine
+ * @param slot filled with the variable naming the slot, -1 for removed ones
+ * @return number of slots, -1 on allocation failure
+ */
+static int assign_slots(Frame* frame, int* slot) {
+    int* owners = malloc(frame->count * sizeof(int));
+    bool* taken = malloc(frame->count * sizeof(bool));
+    if (!owners || !taken) {
+        free(owners);
+        free(taken);
+        return -1;
+    }
+    
+    int slots = 0;
+    for (int v = 0; v < frame->count; v++) {
+        slot[v] = -1;
+        if (frame->removable[v]) continue;
+        
+        memset(taken, 0, slots * sizeof(bool));
+        for (int u = 0; u < v; u++) {
+            if (slot[u] >= 0 && set_has(&frame->interfere[v * frame->words], u)) {
+                for (int s = 0; s < slots; s++) {
+                    if (owners[s] == slot[u]) taken[s] = true;
+                }
+            }
+        }
+        int s = 0;
+        while (s < slots && taken[s]) s++;
+        if (s == slots) owners[slots++] = v;
+        slot[v] = owners[s];
+    }
+    free(owners);
+    free(taken);
+    return slots;
+}
+
+// Renames variables to their slots and defines the slots at the entry
+static bool rewrite_routine(Frame* frame, const int* slot) {
+    InstrList* code = frame->code;
+    for (int i = frame->last - 1; i >= frame->first; i--) {
+        Instr* instr = &code->items[i];
+        int index = i - frame->first;
+        int d = frame->def[index];
+        bool remove = instr_is(instr, "DEFVAR") && d >= 0;
+        if (d >= 0 && frame->removable[d]) {
+            if (instr_is(instr, "MOVE")) {
+                remove = true;
+            } else if (!remove && !instr_set_arg(instr, 0, "GF@%tmp0")) {
+                return false;
+            }
+        }
+        for (int j = 0; j < instr->argc && !remove; j++) {
+            int v = j == 0 && d >= 0 ? d : frame->use[index * INSTR_MAX_ARGS + j];
+            if (v >= 0 && slot[v] >= 0 && slot[v] != v && !instr_set_arg(instr, j, frame->names[slot[v]])) {
+                return false;
+            }
+        }
+        
+        // Copy between variables of one slot
+        if (instr_is(instr, "MOVE") && strcmp(instr->args[0], instr->args[1]) == 0) {
+            remove = true;
+        }
+        if (remove) {
+            ilist_remove(code, i);
+            frame->last--;
+        }
+    }
+    
+    // After the frame is made, a routine without PUSHFRAME uses the frame made for it
+    int entry = frame->first + 1;
+    while (entry < frame->last && (instr_is(&code->items[entry], "CREATEFRAME") ||
+                                   instr_is(&code->items[entry], "PUSHFRAME"))) {
+        entry++;
+    }
+    for (int v = frame->count - 1; v >= 0; v--) {
+        if (slot[v] != v) continue;
+        char* line = malloc(strlen(frame->names[v]) + 8);
+        if (!line) return false;
+        sprintf(line, "DEFVAR %s", frame->names[v]);
+        bool ok = ilist_insert(code, entry, line);
+        free(line);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static void frame_free(Frame* frame) {
+    for (int i = 0; i < frame->count; i++) {
+        free(frame->names[i]);
+    }
+    for (int i = 0; i < frame->cfg.block_count && frame->sets; i++) {
+        free(frame->sets[i].gen);
+    }
+    free(frame->names);
+    free(frame->def);
+    free(frame->use);
+    free(frame->read);
+    free(frame->removable);
+    free(frame->interfere);
+    free(frame->sets);
+    cfg_free(&frame->cfg);
+}
+
+/**
+ * Coalesces frame variables of one routine
+ * @param code generated program
+ * @param first label starting the routine
+ * @param last end of the routine, exclusive
+ * @param stats counts of variables before and after, increased, may be NULL
+ * @return true on success, code must not be printed on failure
+ */
+bool liveness_routine(InstrList* code, int first, int last, FrameStats* stats) {
+    // Helpers of built-ins have no frame
+    if (strncmp(code->items[first].args[0], "$%", 2) == 0) return true;
+    
+    Frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.code = code;
+    frame.first = first;
+    frame.last = last;
+    frame.prefix = "TF@";
+    for (int i = first; i < last; i++) {
+        if (instr_is(&code->items[i], "PUSHFRAME")) {
+            frame.prefix = "LF@";
+            break;
+        }
+    }
+    
+    bool ok = collect_variables(&frame);
+    if (!ok || frame.count == 0 || frame.count > MAX_VARIABLES) {
+        if (stats) stats->before += frame.count;
+        if (stats) stats->after += frame.count;
+        frame_free(&frame);
+        return ok;
+    }
+    frame.words = (frame.count + WORD_BITS - 1) / WORD_BITS;
+    
+    int* slot = malloc(frame.count * sizeof(int));
+    int slots = -1;
+    ok = slot && classify_instructions(&frame) && build_blocks(&frame);
+    if (ok) {
+        compute_liveness(&frame);
+        ok = compute_interference(&frame);
+    }
+    if (ok) {
+        slots = assign_slots(&frame, slot);
+        ok = slots >= 0 && rewrite_routine(&frame, slot);
+    }
+    if (ok && stats) {
+        stats->before += frame.count;
+        stats->after += slots;
+    }
+    free(slot);
+    frame_free(&frame);
+    return ok;
+}
@@ -0,0 +1,29 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * liveness.h
+ * liveness of frame variables and sharing of their slots
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include "ilist.h"
+#include <stdbool.h>
+
+// Frame variables of routines before and after coalescing
+typedef struct {
+    int before;
+    int after;
+} FrameStats;
+
+// Renames frame variables whose live ranges never overlap to one slot and
+// removes variables that are never read. DEFVARs move to the routine entry.
+// The routine is code first..last, stats may be NULL.
+bool liveness_routine(InstrList* code, int first, int last, FrameStats* stats);
+
+#endif // LIVENESS_H
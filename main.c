@@ -9,26 +9,231 @@
  * @author Martin Metelka - xmetelm00
  */
 #include "parser.h"
+#include "profile.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-int main() {
+// Sidecar map of --instrument when --instrument-map is not given
+#define DEFAULT_MAP_PATH "ifj25-counters.map"
+
+// Command line options
+typedef struct {
+    const char* profile_path;    // --profile-use
+    bool instrument;             // --instrument
+    const char* map_path;        // --instrument-map, where counter ids are described
+    bool frame_args;             // --frame-args, calling convention of user functions
+    bool unroll;                 // -funroll-loops or -fno-unroll-loops
+    bool unroll_given;           // unrolling chosen explicitly, not by the -O level
+    int unroll_factor;           // -funroll-factor, copies of the body of a loop unrolled by a factor
+    int unroll_budget;           // -funroll-budget, instructions all copies of one body may have
+    int level;                   // -O0 to -O2
+    const char* passes;          // --passes, replaces the pipeline of the level
+    const char* disabled[PIPELINE_MAX];  // --disable-pass, removed from the pipeline
+    int disabled_count;
+    bool time_passes;            // --time-passes
+    int size_budget;             // -fpass-size-budget, instructions of a function optimized fully
+    int time_budget;             // -fpass-time-budget, milliseconds of one pass on a function, 0 is off
+} Options;
+
+/**
+ * Gets value of option given as --name=value or --name value
+ * @param argc number of arguments
+ * @param argv arguments
+ * @param i index of the current argument, moved past the value
+ * @param name option name including the dashes
+ * @return value or NULL if the argument is not this option
+ */
+static const char* option_value(int argc, char** argv, int* i, const char* name) {
+    size_t len = strlen(name);
+    if (strncmp(argv[*i], name, len) != 0) return NULL;
+    
+    if (argv[*i][len] == '=') return argv[*i] + len + 1;
+    if (argv[*i][len] == '\0' && *i + 1 < argc) return argv[++*i];
+    return NULL;
+}
+
+/**
+ * Gets positive integer value of option name=value
+ * @param arg argument
+ * @param name option name including the dash
+ * @param value parsed value, 0 if the number is not positive
+ * @return true if the argument is this option
+ */
+static bool option_number(const char* arg, const char* name, int* value) {
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+    
+    char* end;
+    long number = strtol(arg + len + 1, &end, 10);
+    *value = *end == '\0' && number > 0 && number <= 1000000 ? (int)number : 0;
+    return true;
+}
+
+/**
+ * Parses command line
+ * @return true if all options are known
+ */
+static bool parse_options(int argc, char** argv, Options* options) {
+    options->profile_path = NULL;
+    options->instrument = false;
+    options->map_path = DEFAULT_MAP_PATH;
+    options->frame_args = false;
+    options->unroll = true;
+    options->unroll_given = false;
+    options->unroll_factor = UNROLL_FACTOR;
+    options->unroll_budget = UNROLL_BUDGET;
+    options->level = OPT_LEVEL_DEFAULT;
+    options->passes = NULL;
+    options->disabled_count = 0;
+    options->time_passes = false;
+    options->size_budget = PASS_SIZE_BUDGET;
+    options->time_budget = PASS_TIME_BUDGET;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* value;
+        if ((value = option_value(argc, argv, &i, "--profile-use"))) {
+            options->profile_path = value;
+        } else if (strcmp(argv[i], "--instrument") == 0) {
+            options->instrument = true;
+        } else if ((value = option_value(argc, argv, &i, "--instrument-map"))) {
+            options->map_path = value;
+        } else if (strcmp(argv[i], "--frame-args") == 0) {
+            options->frame_args = true;
+        } else if (strcmp(argv[i], "-funroll-loops") == 0 || strcmp(argv[i], "-fno-unroll-loops") == 0) {
+            options->unroll = argv[i][2] != 'n';
+            options->unroll_given = true;
+        } else if (option_number(argv[i], "-funroll-factor", &options->unroll_factor) ||
+                   option_number(argv[i], "-funroll-budget", &options->unroll_budget)) {
+            if (options->unroll_factor == 0 || options->unroll_budget == 0) {
+                fprintf(stderr, "Invalid value of %s\n", argv[i]);
+                return false;
+            }
+        } else if (option_number(argv[i], "-fpass-size-budget", &options->size_budget)) {
+            if (options->size_budget == 0) {
+                fprintf(stderr, "Invalid value of %s\n", argv[i]);
+                return false;
+            }
+        } else if (option_number(argv[i], "-fpass-time-budget", &options->time_budget)) {
+            // Time budget is off until it is given
+            if (options->time_budget == 0) {
+                fprintf(stderr, "Invalid value of %s\n", argv[i]);
+                return false;
+            }
+        } else if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '0' + OPT_LEVEL_MAX &&
+                   argv[i][3] == '\0') {
+            options->level = argv[i][2] - '0';
+        } else if ((value = option_value(argc, argv, &i, "--passes"))) {
+            options->passes = value;
+        } else if ((value = option_value(argc, argv, &i, "--disable-pass"))) {
+            if (options->disabled_count == PIPELINE_MAX) {
+                fprintf(stderr, "Too many --disable-pass options\n");
+                return false;
+            }
+            options->disabled[options->disabled_count++] = value;
+        } else if (strcmp(argv[i], "--time-passes") == 0) {
+            options->time_passes = true;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+    
+    // Fast compiles at lower levels do not copy loop bodies either
+    if (!options->unroll_given) {
+        options->unroll = options->level >= 2;
+    }
+    return true;
+}
+
+/**
+ * Builds pipeline of passes from the options
+ * @param options parsed options
+ * @param pipeline filled pipeline
+ * @return true if all named passes exist
+ */
+static bool build_pipeline(const Options* options, PassPipeline* pipeline) {
+    pipeline->time = options->time_passes;
+    pipeline->size_budget = options->size_budget;
+    pipeline->time_budget = options->time_budget;
+    pipeline_level(pipeline, options->level);
+    if (options->passes && !pipeline_parse(pipeline, options->passes)) {
+        fprintf(stderr, "Invalid pass list %s\n", options->passes);
+        return false;
+    }
+    for (int i = 0; i < options->disabled_count; i++) {
+        if (!pipeline_disable(pipeline, options->disabled[i])) {
+            fprintf(stderr, "Unknown pass %s\n", options->disabled[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
     // The compiler reads from stdin and writes to stdout
     FILE* source = stdin;
     FILE* output = stdout;
     
+    Options options;
+    PassPipeline pipeline;
+    if (!parse_options(argc, argv, &options) || !build_pipeline(&options, &pipeline)) {
+        fprintf(stderr, "Usage: %s [--profile-use FILE] [--instrument [--instrument-map FILE]] [--frame-args]\n"
+                "       [-f[no-]unroll-loops] [-funroll-factor=K] [-funroll-budget=N]\n"
+                "       [-O0|-O1|-O2] [--passes=P,...] [--disable-pass=P] [--time-passes]\n"
+                "       [-fpass-size-budget=N] [-fpass-time-budget=MS] < source > output\n"
+                "A profile guides loop rotation from -O1 and block layout with the layout pass.\n"
+                "Passes:\n", argv[0]);
+        passes_print(stderr);
+        return INTERNAL_ERROR;
+    }
+    
+    // Label counts of a previous run guide the layout and loop rotation
+    Profile profile;
+    if (options.profile_path && !profile_load(&profile, options.profile_path)) {
+        fprintf(stderr, "Failed to read profile %s\n", options.profile_path);
+        return INTERNAL_ERROR;
+    }
+    if (options.profile_path && options.level < 1) {
+        fprintf(stderr, "Warning: --profile-use has no effect at -O0\n");
+    } else if (options.profile_path && !pipeline_has(&pipeline, "layout")) {
+        fprintf(stderr, "Warning: --profile-use guides only loop rotation without the layout pass\n");
+    }
+    
     // Initialize parser
     Parser* parser = parser_init(source, output);
     if (!parser) {
         fprintf(stderr, "Failed to initialize parser\n");
+        if (options.profile_path) profile_free(&profile);
         return INTERNAL_ERROR;
     }
+    parser->profile = options.profile_path ? &profile : NULL;
+    parser->instrument = options.instrument;
+    parser->frame_args = options.frame_args;
+    parser->unroll = options.unroll;
+    parser->unroll_factor = options.unroll_factor;
+    parser->unroll_budget = options.unroll_budget;
+    parser->level = options.level;
+    parser->passes = pipeline;
     
     // Parse the program
     int result = parse_program(parser);
     
+    // Counter ids of the instrumented program
+    if (result == SUCCESS && options.instrument) {
+        FILE* map = fopen(options.map_path, "w");
+        if (!map || !counters_write_map(&parser->counters, map)) {
+            fprintf(stderr, "Failed to write counter map %s\n", options.map_path);
+            result = INTERNAL_ERROR;
+        }
+        if (map) fclose(map);
+    }
+    
     // Clean up
     parser_destroy(parser);
+    if (options.profile_path) {
+        profile_free(&profile);
+    }
     
     return result;
 }
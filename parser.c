@@ -10,9 +10,14 @@
  * @author Martin Metelka - xmetelm00
  */
 #include "parser.h"
+#include "builtins.h"
+#include "strenc.h"
+#include "cse.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
 
 // Helper macros for checking token types
 #define IS_REL_OPERATOR(token_type) \
@@ -24,6 +29,18 @@
 ((token_type) == TOKEN_NUM || (token_type) == TOKEN_STRING_TYPE || \
 (token_type) == TOKEN_NULL_TYPE)
 
+// Longest condition (in instructions) that is copied to the bottom of a loop
+#define LOOP_ROTATION_MAX_COND 12
+
+// Profile count from which a loop is considered hot
+#define PROFILE_HOT_COUNT 1000
+
+// Instructions a pure function may run when its call is evaluated at compile time
+#define EVAL_STEP_BUDGET 10000
+
+// Instructions all clones specialized for constant arguments may add together
+#define CLONE_BUDGET 2000
+
 // Expression stack implementation
 static void expr_stack_init(Parser* parser, int capacity) {
     parser->expr_stack.items = malloc(capacity * sizeof(char*));
@@ -38,26 +55,965 @@ static void expr_stack_push(Parser* parser, const char* item) {
     }
 }
 
-static char* expr_stack_pop(Parser* parser) {
-    if (parser->expr_stack.top >= 0) {
-        char* item = parser->expr_stack.items[parser->expr_stack.top];
-        free(parser->expr_stack.items[parser->expr_stack.top]);
-        parser->expr_stack.top--;
-        return item;
+static char* expr_stack_pop(Parser* parser) {
+    if (parser->expr_stack.top >= 0) {
+        char* item = parser->expr_stack.items[parser->expr_stack.top];
+        free(parser->expr_stack.items[parser->expr_stack.top]);
+        parser->expr_stack.top--;
+        return item;
+    }
+    return NULL;
+}
+*/
+static void expr_stack_clear(Parser* parser) {
+    while (parser->expr_stack.top >= 0) {
+        free(parser->expr_stack.items[parser->expr_stack.top]);
+        parser->expr_stack.top--;
+    }
+}
+
+static void expr_stack_free(Parser* parser) {
+    expr_stack_clear(parser);
+    free(parser->expr_stack.items);
+}
+
+// Label list implementation
+static void label_list_add(LabelList* list, char* label) {
+    if (list->count >= list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 4;
+        char** items = realloc(list->items, capacity * sizeof(char*));
+        if (!items) {
+            free(label);
+            return;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = label;
+}
+
+// Moves all labels of src to the end of dst
+static void label_list_move(LabelList* dst, LabelList* src) {
+    for (int i = 0; i < src->count; i++) {
+        label_list_add(dst, src->items[i]);
+    }
+    src->count = 0;
+}
+
+static void label_list_free(LabelList* list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i]);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+// Appends parameter name to the end of the list
+static void param_list_append(Param** list, const char* name) {
+    Param* param = malloc(sizeof(Param));
+    if (!param) return;
+    param->name = strdup(name);
+    param->next = NULL;
+    
+    while (*list) {
+        list = &(*list)->next;
+    }
+    *list = param;
+}
+
+static void param_list_free(Param* list) {
+    while (list) {
+        Param* next = list->next;
+        free(list->name);
+        free(list);
+        list = next;
+    }
+}
+
+// Inserts parameters of current function into the local table
+static void declare_parameters(Parser* parser) {
+    for (Param* p = parser->current_params; p; p = p->next) {
+        SymbolData* existing = NULL;
+        if (symtable_find(parser->local_table, p->name, &existing)) {
+            error(parser, SEMANTIC_REDEFINITION, "Parameter redefined");
+            return;
+        }
+        
+        SymbolData* param_data = symdata_create_var(IFJ_TYPE_NULL);
+        if (!param_data || !symtable_insert(parser->local_table, p->name, param_data)) {
+            error(parser, INTERNAL_ERROR, "Failed to insert parameter");
+            return;
+        }
+    }
+}
+
+// Writes frame operand of local variable, parameters live in LF@paramN
+static void local_operand(Parser* parser, const char* name, char* buffer, size_t size) {
+    int index = 0;
+    for (Param* p = parser->current_params; p; p = p->next, index++) {
+        if (strcmp(p->name, name) == 0) {
+            snprintf(buffer, size, "LF@param%d", index);
+            return;
+        }
+    }
+    snprintf(buffer, size, "LF@%s", name);
+}
+
+/**
+ * Initialize expression result as a plain value
+ */
+void expr_result_init(ExprResult* result) {
+    result->kind = EXPR_VALUE;
+    result->negated = false;
+    result->string = false;
+    result->always_string = false;
+    const_set_nil(&result->value);
+    result->true_list = (LabelList){NULL, 0, 0};
+    result->false_list = (LabelList){NULL, 0, 0};
+}
+
+/**
+ * Free labels owned by expression result
+ */
+void expr_result_free(ExprResult* result) {
+    const_free(&result->value);
+    label_list_free(&result->true_list);
+    label_list_free(&result->false_list);
+}
+
+// Checks if some paths of the expression end with a jump
+static bool has_jumps(const ExprResult* result) {
+    return result->true_list.count > 0 || result->false_list.count > 0;
+}
+
+// Continues expression with right operand of && or ||, right is consumed
+static void expr_result_merge(ExprResult* result, ExprResult* right) {
+    label_list_move(&result->true_list, &right->true_list);
+    label_list_move(&result->false_list, &right->false_list);
+    const_free(&result->value);
+    result->kind = right->kind;
+    result->negated = right->negated;
+    result->string = right->string;
+    result->always_string = right->always_string;
+    result->value = right->value;
+    const_set_nil(&right->value);
+    expr_result_free(right);
+}
+
+// Pushes constant at instruction index, it becomes a value on the stack
+static void push_constant(Parser* parser, ExprResult* result, int index) {
+    char* operand = const_operand(&result->value);
+    char* line = operand ? malloc(strlen(operand) + 7) : NULL;
+    
+    if (!line || (sprintf(line, "PUSHS %s", operand), !ilist_insert(&parser->code, index, line))) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+    
+    free(line);
+    free(operand);
+    const_free(&result->value);
+    result->kind = EXPR_VALUE;
+}
+
+// Operand of a binary operator, plain constants are kept so they can be folded
+static void generate_operand(Parser* parser, ExprResult* result) {
+    if (result->kind != EXPR_CONST || has_jumps(result)) {
+        generate_materialize(parser, result);
+    }
+}
+
+// Pushes operand kept by generate_operand at the position where it was parsed
+static void generate_operand_at(Parser* parser, ExprResult* result, int mark) {
+    if (result->kind == EXPR_CONST) {
+        push_constant(parser, result, mark);
+    }
+}
+
+static void generate_arithmetic(Parser* parser, TokenType op, ExprResult* left, ExprResult* right, int mark);
+static void generate_concat(Parser* parser, ExprResult* left, ExprResult* right, int mark);
+
+// Checks if the expression is known to be a string
+static bool is_string(const ExprResult* result) {
+    return result->kind == EXPR_CONST ? result->value.type == CONST_STRING : result->string;
+}
+
+// Checks if the expression is a string for certain, never nil
+static bool is_always_string(const ExprResult* result) {
+    return result->kind == EXPR_CONST ? result->value.type == CONST_STRING : result->always_string;
+}
+
+// Records read of a global variable
+static void note_global_read(Parser* parser, const char* name) {
+    GlobalVar* global = globals_add(&parser->globals, name);
+    if (!global) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    if (parser->straight_start && !global->written_first) {
+        global->read_early = true;
+    }
+}
+
+// Records write of a global variable, a write at the straight-line start of
+// main that is not preceded by a read there happens before any other access
+static void note_global_write(Parser* parser, const char* name) {
+    GlobalVar* global = globals_add(&parser->globals, name);
+    if (!global) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    if (parser->straight_start && !global->read_early) {
+        global->written_first = true;
+    }
+}
+
+// Appends copy of the token
+static bool token_buffer_add(TokenBuffer* buffer, const Token* token) {
+    if (buffer->count == buffer->capacity) {
+        int capacity = buffer->capacity ? buffer->capacity * 2 : 16;
+        Token* items = realloc(buffer->items, capacity * sizeof(Token));
+        if (!items) return false;
+        buffer->items = items;
+        buffer->capacity = capacity;
+    }
+    
+    Token copy = *token;
+    if (token->value) {
+        copy.value = strdup(token->value);
+        if (!copy.value) return false;
+    }
+    buffer->items[buffer->count++] = copy;
+    return true;
+}
+
+// Frees all tokens of the buffer
+static void token_buffer_free(TokenBuffer* buffer) {
+    for (int i = 0; i < buffer->count; i++) {
+        token_free(&buffer->items[i]);
+    }
+    free(buffer->items);
+    buffer->items = NULL;
+    buffer->count = 0;
+    buffer->capacity = 0;
+}
+
+// Starts copying every consumed token into buffer
+static void start_recording(Parser* parser, TokenBuffer* buffer) {
+    *buffer = (TokenBuffer){NULL, 0, 0, parser->recording};
+    parser->recording = buffer;
+}
+
+// Stops the innermost recording
+static void stop_recording(Parser* parser) {
+    parser->recording = parser->recording->outer;
+}
+
+// Makes recorded tokens the next ones to be parsed, current token follows them
+static void replay_tokens(Parser* parser, const TokenBuffer* tokens) {
+    if (tokens->count == 0) return;
+    
+    bool ok = token_buffer_add(&parser->pending, &parser->current_token);
+    for (int i = tokens->count - 1; i > 0 && ok; i--) {
+        ok = token_buffer_add(&parser->pending, &tokens->items[i]);
+    }
+    
+    token_free(&parser->current_token);
+    Token first = tokens->items[0];
+    first.value = first.value ? strdup(first.value) : NULL;
+    parser->current_token = first;
+    
+    if (!ok || (tokens->items[0].value && !first.value)) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+}
+
+// Label that keeps its name between builds, used to match profile counts. The
+// line is counted from the start of the function, so code above it does not
+// rename the label.
+static char* stable_label(Parser* parser, const char* kind, const Token* at) {
+    const char* function = parser->current_function ? parser->current_function : "";
+    char* label = malloc(strlen(function) + strlen(kind) + 32);
+    if (!label) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return NULL;
+    }
+    sprintf(label, "$%s%%%s%d_%d", function, kind, at->line - parser->function_line, at->column);
+    return label;
+}
+
+// Starts numbering labels and temporaries of a routine whose body starts at line
+static void start_routine_names(Parser* parser, int line) {
+    parser->label_counter = 0;
+    parser->temp_var_counter = 0;
+    parser->function_line = line;
+}
+
+// FNV-1a hash of the signature of a clone
+static uint32_t hash_signature(const char* signature) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = signature; *p; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Label of a branch or loop, in repeated copies of an unrolled body the stable
+// name belongs to the first copy
+static char* block_label(Parser* parser, char* stable) {
+    if (!stable || !parser->in_copy) return stable;
+    
+    free(stable);
+    char* label = generate_label(parser);
+    if (!label) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+    return label;
+}
+
+// Profile count of a stable label, labels missing in a function that ran never executed
+static bool label_profile_count(Parser* parser, const char* label, long* count) {
+    if (profile_count(parser->profile, label, count)) {
+        return true;
+    }
+    
+    char function[300];
+    snprintf(function, sizeof(function), "$%s", parser->current_function ? parser->current_function : "");
+    if (profile_count(parser->profile, function, count) && *count > 0) {
+        *count = 0;
+        return true;
+    }
+    return false;
+}
+
+// Increments a new execution counter in the instrumented build
+static void generate_counter(Parser* parser, CounterKind kind, const char* function, int line, int column) {
+    if (!parser->instrument) return;
+    
+    int id = counters_add(&parser->counters, kind, function ? function : "", line, column);
+    if (id < 0) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    emit(parser, "ADD GF@%%c%d GF@%%c%d int@1\n", id, id);
+}
+
+// Places labels of the list before instruction at index
+static void bind_labels_at(Parser* parser, LabelList* list, int index) {
+    for (int i = 0; i < list->count; i++) {
+        char line[300];
+        snprintf(line, sizeof(line), "LABEL %s", list->items[i]);
+        if (!ilist_insert(&parser->code, index, line)) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        }
+        free(list->items[i]);
+    }
+    list->count = 0;
+}
+
+// Leaf function keeps its variables in TF, PUSHFRAME and POPFRAME are dropped
+static void make_frameless(Parser* parser, int start) {
+    // With --frame-args the frame is made by the caller
+    InstrList* code = &parser->code;
+    int push = start + (parser->frame_args ? 1 : 2);
+    if (parser->level < 1 || parser->had_error || push >= code->count || !instr_is(&code->items[push], "PUSHFRAME")) {
+        return;
+    }
+    
+    // Any call except helpers of built-ins would replace TF
+    for (int i = push + 1; i < code->count; i++) {
+        const Instr* instr = &code->items[i];
+        if (instr_is(instr, "CREATEFRAME") || instr_is(instr, "PUSHFRAME")) return;
+        if (instr_is(instr, "CALL") && strncmp(instr->args[0], "$%", 2) != 0) return;
+        for (int j = 0; j < instr->argc; j++) {
+            if (strncmp(instr->args[j], "TF@", 3) == 0) return;
+        }
+    }
+    
+    ilist_remove(code, push);
+    for (int i = push; i < code->count; i++) {
+        Instr* instr = &code->items[i];
+        if (instr_is(instr, "POPFRAME")) {
+            ilist_remove(code, i--);
+            continue;
+        }
+        for (int j = 0; j < instr->argc; j++) {
+            if (strncmp(instr->args[j], "LF@", 3) == 0) {
+                instr->args[j][0] = 'T';
+            }
+        }
+    }
+}
+
+// Local of the parsed function, defined once at its entry
+static void declare_entry_variable(Parser* parser, const char* name) {
+    for (int i = 0; i < parser->entry_vars.count; i++) {
+        if (strcmp(parser->entry_vars.items[i], name) == 0) return;
+    }
+    
+    char* copy = strdup(name);
+    int count = parser->entry_vars.count;
+    if (copy) {
+        label_list_add(&parser->entry_vars, copy);
+    }
+    if (parser->entry_vars.count == count) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+}
+
+// Defines locals after PUSHFRAME of the function at start, loops may repeat their declarations
+static void define_entry_variables(Parser* parser, int start) {
+    int push = start + (parser->frame_args ? 1 : 2);
+    for (int i = 0; i < parser->entry_vars.count && !parser->had_error; i++) {
+        char line[300];
+        snprintf(line, sizeof(line), "DEFVAR LF@%s", parser->entry_vars.items[i]);
+        if (!ilist_insert(&parser->code, push + 1, line)) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        }
+    }
+    label_list_free(&parser->entry_vars);
+}
+
+// Records code of a finished function and whether calls of it can be evaluated
+static void note_function_code(Parser* parser, const InstrList* code, const char* name, int start) {
+    char label[256];
+    snprintf(label, sizeof(label), "$%s", name);
+    
+    FunctionCode* function = functions_add(&parser->functions, code, label, start, code->count);
+    if (!function) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    function->frame_args = parser->frame_args;
+    function->pure = eval_is_pure(&parser->functions, function);
+}
+
+// Evaluates call with constant arguments, built-ins by folding, user functions if pure
+static bool fold_call(Parser* parser, const char* func_name, bool is_builtin, ExprResult* args, int arg_count, ConstValue* result) {
+    ConstValue* values = malloc((arg_count ? arg_count : 1) * sizeof(ConstValue));
+    if (!values) return false;
+    for (int i = 0; i < arg_count; i++) {
+        values[i] = args[i].value;
+    }
+    
+    bool folded = false;
+    if (is_builtin) {
+        folded = fold_builtin_call(func_name, values, arg_count, result);
+    } else {
+        char label[256];
+        snprintf(label, sizeof(label), "$%s", func_name);
+        const FunctionCode* function = functions_find(&parser->functions, label);
+        folded = function && function->pure &&
+                 eval_call(&parser->functions, function, values, arg_count, EVAL_STEP_BUDGET, result);
+    }
+    
+    free(values);
+    return folded;
+}
+
+// Stack arithmetic and the instruction computing the same into a variable
+static const char* const stack_operations[][2] = {
+    {"ADDS", "ADD"}, {"SUBS", "SUB"}, {"MULS", "MUL"}, {"DIVS", "DIV"}, {"IDIVS", "IDIV"}
+};
+
+// Makes the code from begin to end, which leaves one value on the stack, store
+// it to target. A final push becomes MOVE, arithmetic on two pushes computes
+// into target, anything else is popped.
+static void store_value_at(Parser* parser, int begin, int end, const char* target) {
+    InstrList* code = &parser->code;
+    const char* op = "POPS";
+    int first = end;
+    if (end - begin >= 1 && instr_is(&code->items[end - 1], "PUSHS")) {
+        op = "MOVE";
+        first = end - 1;
+    } else if (end - begin >= 3 && instr_is(&code->items[end - 3], "PUSHS") && instr_is(&code->items[end - 2], "PUSHS")) {
+        for (size_t i = 0; i < sizeof(stack_operations) / sizeof(stack_operations[0]); i++) {
+            if (instr_is(&code->items[end - 1], stack_operations[i][0])) {
+                op = stack_operations[i][1];
+                first = end - 3;
+            }
+        }
+    }
+    
+    // Operands are the pushed ones, in order
+    size_t size = strlen(op) + strlen(target) + 2;
+    for (int i = first; i < end; i++) {
+        if (instr_is(&code->items[i], "PUSHS")) size += strlen(code->items[i].args[0]) + 1;
+    }
+    char* line = malloc(size);
+    if (!line) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    int len = sprintf(line, "%s %s", op, target);
+    for (int i = first; i < end; i++) {
+        if (instr_is(&code->items[i], "PUSHS")) len += sprintf(line + len, " %s", code->items[i].args[0]);
+    }
+    ilist_remove_range(code, first, end);
+    if (!ilist_insert(code, first, line)) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+    free(line);
+}
+
+// Computes arguments of a call straight into TF@paramN of a frame made before
+// them, false if an argument makes a frame itself
+static bool generate_direct_arguments(Parser* parser, ExprResult* args, int* marks, int start, int arg_count, const bool* skip) {
+    for (int i = start; i < parser->code.count; i++) {
+        const Instr* instr = &parser->code.items[i];
+        if (instr_is(instr, "CREATEFRAME") || (instr_is(instr, "CALL") && strncmp(instr->args[0], "$%", 2) != 0)) {
+            return false;
+        }
+    }
+    
+    // Last one first, the code of earlier arguments stays where it is
+    char target[32];
+    for (int i = arg_count - 1; i >= 0; i--) {
+        if (!skip[i] && args[i].kind != EXPR_CONST) {
+            snprintf(target, sizeof(target), "TF@param%d", i);
+            store_value_at(parser, i > 0 ? marks[i - 1] : start, marks[i], target);
+        }
+    }
+    for (int i = arg_count - 1; i >= 0; i--) {
+        snprintf(target, sizeof(target), "DEFVAR TF@param%d", i);
+        if (!skip[i] && !ilist_insert(&parser->code, start, target)) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        }
+    }
+    if (!ilist_insert(&parser->code, start, "CREATEFRAME")) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+    
+    for (int i = 0; i < arg_count; i++) {
+        if (!skip[i] && args[i].kind == EXPR_CONST) {
+            char* operand = const_operand(&args[i].value);
+            if (!operand) {
+                error(parser, INTERNAL_ERROR, "Memory allocation failed");
+                return true;
+            }
+            emit(parser, "MOVE TF@param%d %s\n", i, operand);
+            free(operand);
+        }
+    }
+    return true;
+}
+
+/**
+ * Moves arguments of a user call to TF@paramN of a new frame (--frame-args)
+ * @param parser parser with output
+ * @param args parsed arguments, constants are not emitted yet
+ * @param marks end of the code of each argument
+ * @param start start of the code of the first argument
+ * @param arg_count number of arguments
+ * @param skip arguments substituted in the callee, they are not passed
+ */
+static void generate_frame_arguments(Parser* parser, ExprResult* args, int* marks, int start, int arg_count, const bool* skip) {
+    if (generate_direct_arguments(parser, args, marks, start, arg_count, skip)) return;
+    
+    // Operand moved directly for constants and arguments that are a single local variable
+    char** operands = calloc(arg_count ? arg_count : 1, sizeof(char*));
+    if (!operands) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    
+    // Last one first, removing a push moves only the code of later arguments
+    for (int i = arg_count - 1; i >= 0; i--) {
+        int begin = i > 0 ? marks[i - 1] : start;
+        Instr* instr = &parser->code.items[begin];
+        if (skip[i]) {
+            continue;
+        } else if (args[i].kind == EXPR_CONST) {
+            operands[i] = const_operand(&args[i].value);
+        } else if (marks[i] - begin == 1 && instr_is(instr, "PUSHS") && strncmp(instr->args[0], "LF@", 3) == 0) {
+            // Callees cannot change locals of the caller, so the read can move past later arguments
+            operands[i] = strdup(instr->args[0]);
+            if (operands[i]) {
+                ilist_remove(&parser->code, begin);
+            }
+        } else {
+            continue;
+        }
+        if (!operands[i]) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        }
+    }
+    
+    emit(parser, "CREATEFRAME\n");
+    for (int i = 0; i < arg_count; i++) {
+        if (!skip[i]) {
+            emit(parser, "DEFVAR TF@param%d\n", i);
+        }
+    }
+    for (int i = arg_count - 1; i >= 0; i--) {
+        if (!operands[i] && args[i].kind != EXPR_CONST) {
+            emit(parser, "POPS TF@param%d\n", i);
+        }
+    }
+    for (int i = 0; i < arg_count; i++) {
+        if (operands[i]) {
+            emit(parser, "MOVE TF@param%d %s\n", i, operands[i]);
+        }
+        free(operands[i]);
+    }
+    free(operands);
+}
+
+// Frees recorded body of a function and its clones
+static void source_free(FunctionSource* source) {
+    free(source->key);
+    free(source->name);
+    free(source->assigned);
+    token_buffer_free(&source->body);
+    while (source->clones) {
+        FunctionClone* next = source->clones->next;
+        free(source->clones->signature);
+        free(source->clones->name);
+        free(source->clones);
+        source->clones = next;
+    }
+}
+
+// Checks that the token is the identifier name
+static bool is_identifier(const Token* token, const char* name) {
+    return token->type == TOKEN_IDENTIFIER && strcmp(token->value, name) == 0;
+}
+
+// Checks if token i of the recorded body writes the variable, by = or as the
+// variable of a nested for
+static bool writes_identifier(const TokenBuffer* body, int i, const char* name) {
+    if (!is_identifier(&body->items[i], name)) return false;
+    
+    bool loop = (i > 0 && body->items[i - 1].type == TOKEN_FOR) ||
+                (i > 1 && body->items[i - 1].type == TOKEN_LEFT_PAREN && body->items[i - 2].type == TOKEN_FOR);
+    return loop || (i + 1 < body->count && body->items[i + 1].type == TOKEN_ASSIGN);
+}
+
+// Keeps body of a finished function so it can be parsed again for constant arguments
+static void note_function_source(Parser* parser, const char* key, const char* name, Param* params, int param_count, TokenBuffer* body, int start) {
+    FunctionSource source = {strdup(key), strdup(name), params, *body,
+                             calloc(param_count ? param_count : 1, sizeof(bool)), start, parser->code.count, 0, NULL};
+    source.body.outer = NULL;
+    
+    SourceList* list = &parser->sources;
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 8;
+        FunctionSource* items = realloc(list->items, capacity * sizeof(FunctionSource));
+        if (items) {
+            list->items = items;
+            list->capacity = capacity;
+        }
+    }
+    if (!source.key || !source.name || !source.assigned || list->count == list->capacity) {
+        source_free(&source);
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    
+    // Parameter written by = or a for is assigned, its value is not the argument everywhere
+    int index = 0;
+    for (Param* p = params; p; p = p->next, index++) {
+        for (int i = 0; i < body->count; i++) {
+            source.assigned[index] = source.assigned[index] || writes_identifier(body, i, p->name);
+        }
+    }
+    list->items[list->count++] = source;
+}
+
+// Recorded body of a function by its key, NULL while it is being parsed
+static FunctionSource* find_source(Parser* parser, const char* key) {
+    for (int i = 0; i < parser->sources.count; i++) {
+        if (strcmp(parser->sources.items[i].key, key) == 0) {
+            return &parser->sources.items[i];
+        }
+    }
+    return NULL;
+}
+
+// Parameter substituted by the argument in a clone. Strings are passed: the
+// generic code adds two parameters by ADDS, which fails on strings, while a
+// substituted string literal would be joined.
+static bool is_specialized(const FunctionSource* source, const ExprResult* args, int index) {
+    return args[index].kind == EXPR_CONST && args[index].value.type != CONST_STRING && !source->assigned[index];
+}
+
+// Key and the constant of every substituted parameter, NULL in signature if there is none
+static bool clone_signature(const FunctionSource* source, ExprResult* args, int arg_count, char** signature) {
+    *signature = NULL;
+    char** operands = calloc(arg_count ? arg_count : 1, sizeof(char*));
+    if (!operands) return false;
+    
+    bool ok = true;
+    bool any = false;
+    size_t length = strlen(source->key) + 1;
+    for (int i = 0; i < arg_count; i++) {
+        if (is_specialized(source, args, i)) {
+            operands[i] = const_operand(&args[i].value);
+            ok = ok && operands[i];
+            any = true;
+        }
+        length += operands[i] ? strlen(operands[i]) + 1 : 2;
+    }
+    
+    // Operands never contain a line break
+    if (ok && any) {
+        *signature = malloc(length);
+        ok = *signature != NULL;
+    }
+    if (*signature) {
+        strcpy(*signature, source->key);
+        for (int i = 0; i < arg_count; i++) {
+            strcat(*signature, "\n");
+            strcat(*signature, operands[i] ? operands[i] : "-");
+        }
+    }
+    
+    for (int i = 0; i < arg_count; i++) {
+        free(operands[i]);
+    }
+    free(operands);
+    return ok;
+}
+
+// Parses the body again as a new routine in which constant parameters are replaced
+// by the arguments, the routine is moved to the clone code
+static FunctionClone* generate_clone(Parser* parser, FunctionSource* source, ExprResult* args, int arg_count, char* signature) {
+    FunctionClone* clone = malloc(sizeof(FunctionClone));
+    char* name = malloc(strlen(source->name) + 16);
+    const ConstValue** specialized = calloc(arg_count ? arg_count : 1, sizeof(ConstValue*));
+    SymTable* table = symtable_init();
+    if (!clone || !name || !specialized || !table) {
+        free(clone);
+        free(name);
+        free(specialized);
+        free(signature);
+        if (table) symtable_free(table);
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return NULL;
+    }
+    
+    // Named after the constants, not after the clones made before it
+    uint32_t hash = hash_signature(signature);
+    bool taken = true;
+    while (taken) {
+        sprintf(name, "%s$%08x", source->name, (unsigned)hash++);
+        taken = false;
+        for (const FunctionClone* other = source->clones; other && !taken; other = other->next) {
+            taken = strcmp(other->name, name) == 0;
+        }
+    }
+    for (int i = 0; i < arg_count; i++) {
+        specialized[i] = is_specialized(source, args, i) ? &args[i].value : NULL;
+    }
+    
+    // Registered first, recursive calls with the same constants use the clone
+    *clone = (FunctionClone){signature, name, source->clones};
+    source->clones = clone;
+    parser->clone_budget -= source->end - source->start;
+    
+    // Context of the caller
+    char* current_function = parser->current_function;
+    Param* current_params = parser->current_params;
+    bool in_function = parser->in_function;
+    int function_param_count = parser->function_param_count;
+    SymTable* local_table = parser->local_table;
+    bool straight_start = parser->straight_start;
+    const ConstValue** outer_specialized = parser->specialized;
+    TokenBuffer* recording = parser->recording;
+    LabelList entry_vars = parser->entry_vars;
+    int label_counter = parser->label_counter;
+    int temp_var_counter = parser->temp_var_counter;
+    int function_line = parser->function_line;
+    parser->entry_vars = (LabelList){NULL, 0, 0};
+    
+    // Replayed tokens are not part of any recording of the caller
+    int start = parser->code.count;
+    parser->specialized = specialized;
+    parser->straight_start = false;
+    parser->recording = NULL;
+    generate_function_prolog(parser, name, arg_count);
+    
+    parser->current_function = strdup(name);
+    start_routine_names(parser, source->body.count > 0 ? source->body.items[0].line : 0);
+    parser->current_params = source->params;
+    parser->in_function = true;
+    parser->function_param_count = arg_count;
+    parser->local_table = table;
+    declare_parameters(parser);
+    
+    replay_tokens(parser, &source->body);
+    parse_block(parser);
+    generate_function_epilog(parser);
+    define_entry_variables(parser, start);
+    make_frameless(parser, start);
+    
+    free(parser->current_function);
+    symtable_free(parser->local_table);
+    free(specialized);
+    parser->current_function = current_function;
+    parser->current_params = current_params;
+    parser->in_function = in_function;
+    parser->function_param_count = function_param_count;
+    parser->local_table = local_table;
+    parser->straight_start = straight_start;
+    parser->specialized = outer_specialized;
+    parser->recording = recording;
+    parser->entry_vars = entry_vars;
+    parser->label_counter = label_counter;
+    parser->temp_var_counter = temp_var_counter;
+    parser->function_line = function_line;
+    
+    // Clone is kept apart, the code of the caller continues where it was
+    int clone_start = parser->clone_code.count;
+    if (!ilist_move_tail(&parser->code, start, &parser->clone_code)) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return clone;
+    }
+    note_function_code(parser, &parser->clone_code, name, clone_start);
+    return clone;
+}
+
+/**
+ * Chooses routine for a user call, constant arguments of parameters that are
+ * never assigned are substituted in a clone of the function made for them
+ * @param parser parser with output
+ * @param key callee key, name_arity
+ * @param name callee name
+ * @param args parsed arguments, constants are not emitted yet
+ * @param arg_count number of arguments
+ * @param skip set for arguments the chosen routine does not take
+ * @return name of the routine to call
+ */
+static const char* specialize_call(Parser* parser, const char* key, const char* name, ExprResult* args, int arg_count, bool* skip) {
+    FunctionSource* source = find_source(parser, key);
+    if (!source) return name;
+    
+    // -O0 calls the generic code only
+    char* signature = NULL;
+    if (parser->level >= 1 && !clone_signature(source, args, arg_count, &signature)) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return name;
+    }
+    
+    FunctionClone* clone = NULL;
+    if (signature) {
+        for (clone = source->clones; clone && strcmp(clone->signature, signature) != 0; clone = clone->next);
+        if (clone) {
+            free(signature);
+        } else if (source->end - source->start <= parser->clone_budget) {
+            clone = generate_clone(parser, source, args, arg_count, signature);
+        } else {
+            free(signature);
+        }
+    }
+    
+    // Generic code stays while something calls it
+    if (!clone) {
+        source->generic_calls++;
+        return name;
+    }
+    for (int i = 0; i < arg_count; i++) {
+        skip[i] = is_specialized(source, args, i);
+    }
+    return clone->name;
+}
+
+// Constant that replaces a parameter in the clone being parsed, NULL otherwise
+static const ConstValue* specialized_parameter(Parser* parser, const char* name) {
+    if (!parser->specialized) return NULL;
+    
+    int index = 0;
+    for (Param* p = parser->current_params; p; p = p->next, index++) {
+        if (strcmp(p->name, name) == 0) {
+            return parser->specialized[index];
+        }
+    }
+    return NULL;
+}
+
+// Generic code of functions called only through their clones is dropped,
+// clones are placed after all functions
+static void place_clones(Parser* parser) {
+    for (int i = parser->sources.count - 1; i >= 0; i--) {
+        const FunctionSource* source = &parser->sources.items[i];
+        if (source->clones && source->generic_calls == 0) {
+            ilist_remove_range(&parser->code, source->start, source->end);
+        }
+    }
+    if (!ilist_splice(&parser->code, parser->code.count, &parser->clone_code)) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+}
+
+// Routine name of an accessor, getter and setter of one property get different labels
+static char* accessor_name(const char* name, bool setter) {
+    char* label = malloc(strlen(name) + 5);
+    if (label) {
+        sprintf(label, "%s$%s", name, setter ? "set" : "get");
     }
-    return NULL;
+    return label;
 }
-*/
-static void expr_stack_clear(Parser* parser) {
-    while (parser->expr_stack.top >= 0) {
-        free(parser->expr_stack.items[parser->expr_stack.top]);
-        parser->expr_stack.top--;
+
+// Global of a trivial accessor body { return __g } or { __g = param }, NULL otherwise
+static char* trivial_accessor_global(const TokenBuffer* body, const char* param) {
+    const Token* tokens[5];
+    int count = 0;
+    for (int i = 0; i < body->count; i++) {
+        if (body->items[i].type == TOKEN_EOL) continue;
+        if (count == 5) return NULL;
+        tokens[count++] = &body->items[i];
+    }
+    
+    const Token* global = NULL;
+    if (!param && count == 4 && tokens[1]->type == TOKEN_RETURN) {
+        global = tokens[2];
+    } else if (param && count == 5 && tokens[2]->type == TOKEN_ASSIGN &&
+               tokens[3]->type == TOKEN_IDENTIFIER && strcmp(tokens[3]->value, param) == 0) {
+        global = tokens[1];
+    }
+    
+    if (!global || global->type != TOKEN_GLOBAL_IDENTIFIER) return NULL;
+    return strdup(global->value);
+}
+
+// Getter (name_0) or setter (name_1) of a property, NULL if there is none
+static SymbolData* find_accessor(Parser* parser, const char* name, bool setter) {
+    char key[256];
+    snprintf(key, sizeof(key), "%s_%d", name, setter ? 1 : 0);
+    
+    SymbolData* data = NULL;
+    if (!symtable_find(parser->global_table, key, &data)) return NULL;
+    return data->kind == (setter ? IFJ_SYMBOL_SETTER : IFJ_SYMBOL_GETTER) ? data : NULL;
+}
+
+// Calls a getter, or a setter with the new value on the stack
+static void generate_accessor_call(Parser* parser, const char* name, bool setter) {
+    char* label = accessor_name(name, setter);
+    if (!label) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
     }
+    
+    if (parser->frame_args) {
+        emit(parser, "CREATEFRAME\n");
+        if (setter) {
+            emit(parser, "DEFVAR TF@param0\n");
+            emit(parser, "POPS TF@param0\n");
+        }
+    }
+    generate_function_call(parser, label, setter ? 1 : 0, false, !setter);
+    free(label);
 }
 
-static void expr_stack_free(Parser* parser) {
-    expr_stack_clear(parser);
-    free(parser->expr_stack.items);
+// Frees arguments of a function call
+static void free_arguments(ExprResult* args, int* marks, int arg_count) {
+    for (int i = 0; i < arg_count; i++) {
+        expr_result_free(&args[i]);
+    }
+    free(args);
+    free(marks);
 }
 
 /**
@@ -74,15 +1030,47 @@ Parser* parser_init(FILE* source, FILE* output) {
     }
     
     parser->output = output;
+    ilist_init(&parser->code);
+    globals_init(&parser->globals);
+    parser->returns_string = false;
+    parser->straight_start = false;
+    parser->profile = NULL;
+    parser->instrument = false;
+    parser->frame_args = false;
+    counters_init(&parser->counters);
+    functions_init(&parser->functions);
+    parser->sources = (SourceList){NULL, 0, 0};
+    parser->specialized = NULL;
+    ilist_init(&parser->clone_code);
+    parser->clone_budget = CLONE_BUDGET;
+    parser->cse_temps = 0;
+    parser->level = OPT_LEVEL_DEFAULT;
+    pipeline_level(&parser->passes, OPT_LEVEL_DEFAULT);
+    parser->passes.time = false;
+    parser->passes.size_budget = PASS_SIZE_BUDGET;
+    parser->passes.time_budget = PASS_TIME_BUDGET;
+    parser->entry_vars = (LabelList){NULL, 0, 0};
     parser->global_table = symtable_init();
     parser->local_table = NULL;
     parser->had_error = false;
     parser->error_code = SUCCESS;
     parser->label_counter = 0;
     parser->temp_var_counter = 0;
+    parser->function_line = 0;
     parser->current_function = NULL;
+    parser->current_params = NULL;
     parser->in_function = false;
     parser->function_param_count = 0;
+    parser->used_helpers = 0;
+    parser->current_token.value = NULL;
+    parser->lookahead.value = NULL;
+    parser->has_lookahead = false;
+    parser->pending = (TokenBuffer){NULL, 0, 0, NULL};
+    parser->recording = NULL;
+    parser->in_copy = false;
+    parser->unroll = true;
+    parser->unroll_factor = UNROLL_FACTOR;
+    parser->unroll_budget = UNROLL_BUDGET;
     
     // Initialize expression stack
     expr_stack_init(parser, 100);
@@ -115,6 +1103,24 @@ void parser_destroy(Parser* parser) {
         free(parser->current_function);
     }
     
+    ilist_free(&parser->code);
+    globals_free(&parser->globals);
+    counters_free(&parser->counters);
+    functions_free(&parser->functions);
+    for (int i = 0; i < parser->sources.count; i++) {
+        source_free(&parser->sources.items[i]);
+    }
+    free(parser->sources.items);
+    ilist_free(&parser->clone_code);
+    label_list_free(&parser->entry_vars);
+    strenc_cache_free();
+    
+    token_free(&parser->current_token);
+    if (parser->has_lookahead) {
+        token_free(&parser->lookahead);
+    }
+    token_buffer_free(&parser->pending);
+    
     expr_stack_free(parser);
     
     free(parser);
@@ -124,10 +1130,38 @@ void parser_destroy(Parser* parser) {
  * Get next token from scanner
  */
 void next_token(Parser* parser) {
+    for (TokenBuffer* buffer = parser->recording; buffer; buffer = buffer->outer) {
+        if (!token_buffer_add(buffer, &parser->current_token)) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        }
+    }
+    
     if (parser->current_token.value) {
         token_free(&parser->current_token);
     }
-    parser->current_token = get_next_token(parser->scanner);
+    
+    if (parser->pending.count > 0) {
+        parser->current_token = parser->pending.items[--parser->pending.count];
+    } else if (parser->has_lookahead) {
+        parser->current_token = parser->lookahead;
+        parser->has_lookahead = false;
+    } else {
+        parser->current_token = get_next_token(parser->scanner);
+    }
+}
+
+/**
+ * Look at the token following the current one without consuming it
+ */
+Token* peek_token(Parser* parser) {
+    if (parser->pending.count > 0) {
+        return &parser->pending.items[parser->pending.count - 1];
+    }
+    if (!parser->has_lookahead) {
+        parser->lookahead = get_next_token(parser->scanner);
+        parser->has_lookahead = true;
+    }
+    return &parser->lookahead;
 }
 
 /**
@@ -189,10 +1223,6 @@ void error(Parser* parser, int code, const char* message) {
  * Parse entire program
  */
 int parse_program(Parser* parser) {
-    // Generate prolog
-    fprintf(parser->output, ".IFJcode25\n");
-    generate_prolog(parser);
-    
     // Parse prolog (import statement)
     parse_prolog(parser);
     if (parser->had_error) return parser->error_code;
@@ -205,18 +1235,135 @@ int parse_program(Parser* parser) {
     parse_function_definitions(parser);
     if (parser->had_error) return parser->error_code;
     
+    // Clones follow the functions
+    place_clones(parser);
+    if (parser->had_error) return parser->error_code;
+    
     // Generate epilog
     generate_epilog(parser);
+    if (parser->had_error) return parser->error_code;
+    
+    // Passes over the function bodies, the prolog depends on what they leave
+    PassContext context = {&parser->code, &parser->globals, &parser->cse_temps, parser->profile};
+    if (!pipeline_run(&parser->passes, &context, false)) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return parser->error_code;
+    }
+    
+    // Prolog defines globals, so it is generated once all of them are known
+    InstrList body = parser->code;
+    ilist_init(&parser->code);
+    generate_prolog(parser);
+    if (!ilist_splice(&parser->code, parser->code.count, &body)) {
+        ilist_free(&body);
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+    if (!parser->had_error && !pipeline_run(&parser->passes, &context, true)) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+    if (parser->had_error) return parser->error_code;
+    
+    // Whole program is known, print it
+    fprintf(parser->output, ".IFJcode25\n");
+    ilist_write(&parser->code, parser->output);
     
     return parser->error_code;
 }
 
+/**
+ * Append one instruction to the generated code
+ */
+void emit(Parser* parser, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (len < 0) {
+        error(parser, INTERNAL_ERROR, "Failed to generate instruction");
+        return;
+    }
+    
+    // Long string literals do not fit the buffer
+    char* line = buffer;
+    if ((size_t)len >= sizeof(buffer)) {
+        line = malloc(len + 1);
+        if (!line) {
+            error(parser, INTERNAL_ERROR, "Memory allocation failed");
+            return;
+        }
+        va_start(args, format);
+        vsnprintf(line, len + 1, format, args);
+        va_end(args);
+    }
+    
+    if (!ilist_append(&parser->code, line)) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    }
+    
+    if (line != buffer) {
+        free(line);
+    }
+}
+
 /**
  * Generate prolog code
  */
 void generate_prolog(Parser* parser) {
-    fprintf(parser->output, "CREATEFRAME\n");
-    fprintf(parser->output, "PUSHFRAME\n");
+    emit(parser, "CREATEFRAME\n");
+    emit(parser, "PUSHFRAME\n");
+    
+    // Scratch registers for built-ins (GF@%tmp0) and their helpers (GF@%r*)
+    emit(parser, "DEFVAR GF@%%tmp0\n");
+    for (int i = 0; i < 7; i++) {
+        emit(parser, "DEFVAR GF@%%r%d\n", i);
+    }
+    
+    // Return value of the frame calling convention
+    if (parser->frame_args) {
+        emit(parser, "DEFVAR GF@%%retval\n");
+    }
+    
+    // Temporaries of repeated computations
+    for (int i = 0; i < parser->cse_temps; i++) {
+        emit(parser, "DEFVAR %s%d\n", CSE_TEMP_PREFIX, i);
+    }
+    
+    // Every global referenced by the program, nil unless main writes it first
+    GlobalVar** globals = globals_sorted(&parser->globals);
+    if (!globals) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    for (int i = 0; i < parser->globals.count; i++) {
+        if (globals[i]->constant) continue;
+        emit(parser, "DEFVAR GF@%s\n", globals[i]->name);
+        if (!globals[i]->written_first) {
+            emit(parser, "MOVE GF@%s nil@nil\n", globals[i]->name);
+        }
+    }
+    free(globals);
+    
+    // Execution counters start at zero
+    for (int i = 0; i < parser->counters.count; i++) {
+        emit(parser, "DEFVAR GF@%%c%d\n", i);
+        emit(parser, "MOVE GF@%%c%d int@0\n", i);
+    }
+    
+    // Function bodies follow the prolog, so main has to be entered before them
+    if (parser->frame_args) {
+        emit(parser, "CREATEFRAME\n");
+    }
+    emit(parser, "CALL $main\n");
+    
+    // Table of counters, "id count" per line on stderr
+    for (int i = 0; i < parser->counters.count; i++) {
+        emit(parser, "DPRINT string@%d\\032\n", i);
+        emit(parser, "DPRINT GF@%%c%d\n", i);
+        emit(parser, "DPRINT string@\\010\n");
+    }
+    emit(parser, "EXIT int@0\n");
 }
 
 /**
@@ -229,9 +1376,8 @@ void generate_epilog(Parser* parser) {
         return;
     }
     
-    
-    fprintf(parser->output, "CALL $main\n");
-    fprintf(parser->output, "EXIT int@0\n");
+    // Helper routines of built-ins go after all functions
+    generate_builtin_helpers(parser);
 }
 
 /**
@@ -355,12 +1501,14 @@ void parse_function(Parser* parser) {
     
     // Parse parameters
     int param_count = 0;
+    Param* params = NULL;
     if (!accept(parser, TOKEN_RIGHT_PAREN)) {
         // Parse first parameter
         if (!expect(parser, TOKEN_IDENTIFIER)) {
             free(func_name);
             return;
         }
+        param_list_append(&params, parser->current_token.value);
         param_count++;
         next_token(parser);
         
@@ -368,9 +1516,11 @@ void parse_function(Parser* parser) {
         while (accept(parser, TOKEN_COMMA)) {
             next_token(parser);
             if (!expect(parser, TOKEN_IDENTIFIER)) {
+                param_list_free(params);
                 free(func_name);
                 return;
             }
+            param_list_append(&params, parser->current_token.value);
             param_count++;
             next_token(parser);
         }
@@ -378,6 +1528,7 @@ void parse_function(Parser* parser) {
     
     // Expect )
     if (!expect(parser, TOKEN_RIGHT_PAREN)) {
+        param_list_free(params);
         free(func_name);
         return;
     }
@@ -387,9 +1538,11 @@ void parse_function(Parser* parser) {
     SymbolData* func_data = symdata_create_func(IFJ_SYMBOL_FUNC, param_count);
     if (!func_data) {
         error(parser, INTERNAL_ERROR, "Failed to create function data");
+        param_list_free(params);
         free(func_name);
         return;
     }
+    func_data->func->params = params;
     
     // Create unique key: name_arity
     char key[256];
@@ -413,10 +1566,13 @@ void parse_function(Parser* parser) {
     }
     
     // Generate function prolog
+    int code_start = parser->code.count;
     generate_function_prolog(parser, func_name, param_count);
     
     // Set current function context
     parser->current_function = strdup(func_name);
+    start_routine_names(parser, parser->current_token.line);
+    parser->current_params = params;
     parser->in_function = true;
     parser->function_param_count = param_count;
     
@@ -425,16 +1581,37 @@ void parse_function(Parser* parser) {
         symtable_free(parser->local_table);
     }
     parser->local_table = symtable_init();
+    declare_parameters(parser);
+    
+    // Program starts in main, its code up to the first branch or call runs first
+    parser->straight_start = strcmp(func_name, "main") == 0 && param_count == 0;
     
-    // Parse function body
+    // Parse function body, it is recorded for clones with constant arguments
+    TokenBuffer body;
+    parser->returns_string = true;
+    start_recording(parser, &body);
     parse_block(parser);
+    stop_recording(parser);
+    parser->straight_start = false;
+    func_data->func->returns_string = parser->returns_string;
     
     // Generate function epilog
     generate_function_epilog(parser);
+    define_entry_variables(parser, code_start);
+    make_frameless(parser, code_start);
+    note_function_code(parser, &parser->code, func_name, code_start);
+    
+    // Counters of an instrumented build belong to the generic code
+    if (parser->instrument || parser->had_error) {
+        token_buffer_free(&body);
+    } else {
+        note_function_source(parser, key, func_name, params, param_count, &body, code_start);
+    }
     
     // Clean up function context
     free(parser->current_function);
     parser->current_function = NULL;
+    parser->current_params = NULL;
     parser->in_function = false;
     parser->function_param_count = 0;
     
@@ -445,18 +1622,27 @@ void parse_function(Parser* parser) {
  * Generate function prolog
  */
 void generate_function_prolog(Parser* parser, const char* name, int param_count) {
-    fprintf(parser->output, "LABEL $%s\n", name);
+    emit(parser, "LABEL $%s\n", name);
+    
+    // Caller made the frame and defined the parameters in it
+    if (parser->frame_args) {
+        emit(parser, "PUSHFRAME\n");
+        generate_counter(parser, COUNTER_ENTRY, name, parser->current_token.line, parser->current_token.column);
+        return;
+    }
     
     // Create new frame
-    fprintf(parser->output, "CREATEFRAME\n");
-    fprintf(parser->output, "PUSHFRAME\n");
+    emit(parser, "CREATEFRAME\n");
+    emit(parser, "PUSHFRAME\n");
+    generate_counter(parser, COUNTER_ENTRY, name, parser->current_token.line, parser->current_token.column);
     
-    // Initialize parameters (they will be on stack in reverse order)
+    // Initialize parameters (they will be on stack in reverse order), constants of a clone are not passed
     for (int i = param_count - 1; i >= 0; i--) {
+        if (parser->specialized && parser->specialized[i]) continue;
         char param_name[32];
         snprintf(param_name, sizeof(param_name), "param%d", i);
-        fprintf(parser->output, "DEFVAR LF@%s\n", param_name);
-        fprintf(parser->output, "POPS LF@%s\n", param_name);
+        emit(parser, "DEFVAR LF@%s\n", param_name);
+        emit(parser, "POPS LF@%s\n", param_name);
     }
 }
 
@@ -465,12 +1651,14 @@ void generate_function_prolog(Parser* parser, const char* name, int param_count)
  */
 void generate_function_epilog(Parser* parser) {
     // If no explicit return, push nil
-    if (parser->current_function && strcmp(parser->current_function, "main") == 0) {
-        fprintf(parser->output, "PUSHS nil@nil\n");
+    if (parser->frame_args) {
+        emit(parser, "MOVE GF@%%retval nil@nil\n");
+    } else {
+        emit(parser, "PUSHS nil@nil\n");
     }
     
-    fprintf(parser->output, "POPFRAME\n");
-    fprintf(parser->output, "RETURN\n");
+    emit(parser, "POPFRAME\n");
+    emit(parser, "RETURN\n");
 }
 
 /**
@@ -505,28 +1693,31 @@ void parse_block(Parser* parser) {
  * Parse statement
  */
 void parse_statement(Parser* parser) {
+    // Order of accesses to globals is not tracked across branches
+    if (accept(parser, TOKEN_IF) || accept(parser, TOKEN_WHILE) || accept(parser, TOKEN_FOR) || accept(parser, TOKEN_RETURN)) {
+        parser->straight_start = false;
+    }
+    
     if (accept(parser, TOKEN_VAR)) {
         parse_var_declaration(parser);
     } else if (accept(parser, TOKEN_IF)) {
         parse_if_statement(parser);
     } else if (accept(parser, TOKEN_WHILE)) {
         parse_while_statement(parser);
+    } else if (accept(parser, TOKEN_FOR)) {
+        parse_for_statement(parser);
     } else if (accept(parser, TOKEN_RETURN)) {
         parse_return(parser);
+    } else if (accept(parser, TOKEN_IFJ_NAMESPACE)) {
+        parse_function_call_statement(parser);
     } else if (accept(parser, TOKEN_IDENTIFIER) || accept(parser, TOKEN_GLOBAL_IDENTIFIER)) {
         // Could be assignment or function call
-        Token saved_token = parser->current_token;
-        next_token(parser);
-        
-        if (accept(parser, TOKEN_ASSIGN)) {
-            // It's an assignment - put token back and parse assignment
-            parser->current_token = saved_token;
+        if (peek_token(parser)->type == TOKEN_ASSIGN) {
             parse_assignment(parser);
+        } else if (accept(parser, TOKEN_IDENTIFIER) && peek_token(parser)->type == TOKEN_LEFT_PAREN) {
+            parse_function_call_statement(parser);
         } else {
-            // It's a function call without assignment (only for builtins in basic version)
-            // For now, treat as error unless it's EXTFUN extension
-            parser->current_token = saved_token;
-            error(parser, SEMANTIC_OTHER, "Function call without assignment not supported in basic version");
+            error(parser, SYNTAX_ERROR, "Expected assignment or function call");
         }
     } else {
         error(parser, SYNTAX_ERROR, "Invalid statement");
@@ -538,11 +1729,11 @@ void parse_statement(Parser* parser) {
  */
 void generate_var_declaration(Parser* parser, const char* name, bool is_global) {
     if (is_global) {
-        fprintf(parser->output, "DEFVAR GF@%s\n", name);
-        fprintf(parser->output, "MOVE GF@%s nil@nil\n", name);
+        emit(parser, "DEFVAR GF@%s\n", name);
+        emit(parser, "MOVE GF@%s nil@nil\n", name);
     } else {
-        fprintf(parser->output, "DEFVAR LF@%s\n", name);
-        fprintf(parser->output, "MOVE LF@%s nil@nil\n", name);
+        declare_entry_variable(parser, name);
+        emit(parser, "MOVE LF@%s nil@nil\n", name);
     }
 }
 
@@ -598,10 +1789,21 @@ void parse_var_declaration(Parser* parser) {
  */
 void generate_assignment(Parser* parser, const char* name, bool is_global) {
     // Value should be on stack from expression evaluation
+    char operand[300];
     if (is_global) {
-        fprintf(parser->output, "POPS GF@%s\n", name);
+        note_global_write(parser, name);
+        snprintf(operand, sizeof(operand), "GF@%s", name);
+    } else {
+        local_operand(parser, name, operand, sizeof(operand));
+    }
+    
+    // Result of a call with --frame-args is taken from GF@%retval directly
+    Instr* last = ilist_last(&parser->code);
+    if (parser->frame_args && instr_is(last, "PUSHS") && strcmp(last->args[0], "GF@%retval") == 0) {
+        ilist_remove(&parser->code, parser->code.count - 1);
+        emit(parser, "MOVE %s GF@%%retval\n", operand);
     } else {
-        fprintf(parser->output, "POPS LF@%s\n", name);
+        emit(parser, "POPS %s\n", operand);
     }
 }
 
@@ -629,52 +1831,41 @@ void parse_assignment(Parser* parser) {
         return;
     }
     
-    // For local variables, check if they exist
+    // For local variables, check if they exist, otherwise it is a property with a setter
+    SymbolData* setter = NULL;
     if (!is_global) {
         SymbolData* var_data = NULL;
         if (!symtable_find(parser->local_table, var_name, &var_data)) {
-            error(parser, SEMANTIC_UNDEFINED, "Undefined local variable");
-            free(var_name);
-            return;
+            setter = find_accessor(parser, var_name, true);
+            if (!setter) {
+                error(parser, SEMANTIC_UNDEFINED, "Undefined local variable");
+                free(var_name);
+                return;
+            }
         }
     }
     
     
+    // Consume identifier and =
+    next_token(parser);
+    if (!expect(parser, TOKEN_ASSIGN)) {
+        free(var_name);
+        return;
+    }
     next_token(parser);
     
-    // Check if this is a function call
-    if (accept(parser, TOKEN_IDENTIFIER)) {
-        // Could be function call or getter
-        char* func_name = strdup(parser->current_token.value);
-        next_token(parser);
-        
-        if (accept(parser, TOKEN_LEFT_PAREN)) {
-            // Function call
-            parse_function_call(parser, func_name);
-        } else {
-            // Simple expression
-            // Put the token back and parse expression
-            Token saved_token = parser->current_token;
-            parser->current_token.type = TOKEN_IDENTIFIER;
-            parser->current_token.value = func_name;
-            parser->current_token.line = parser->current_token.line;
-            parser->current_token.column = parser->current_token.column - 1;
-            
-            parse_expression(parser);
-            
-            // Restore token
-            parser->current_token = saved_token;
-        }
-        
-        free(func_name);
+    // Parse expression (result will be on stack)
+    parse_expression(parser);
+    
+    // Generate code for assignment, a trivial setter writes the global itself
+    if (!setter) {
+        generate_assignment(parser, var_name, is_global);
+    } else if (setter->func->global) {
+        generate_assignment(parser, setter->func->global, true);
     } else {
-        // Parse expression (result will be on stack)
-        parse_expression(parser);
+        generate_accessor_call(parser, var_name, true);
     }
     
-    // Generate code for assignment
-    generate_assignment(parser, var_name, is_global);
-    
     free(var_name);
 }
 
@@ -682,49 +1873,61 @@ void parse_assignment(Parser* parser) {
  * Parse if statement: if (expression) block else block
  */
 void parse_if_statement(Parser* parser) {
-    // Generate labels
-    char* else_label = generate_label(parser);
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    
+    // Generate labels, arms get stable names for profiling
     char* end_label = generate_label(parser);
+    char* then_label = block_label(parser, stable_label(parser, "then", &parser->current_token));
+    char* else_label = block_label(parser, stable_label(parser, "else", &parser->current_token));
     
     // Consume if
     next_token(parser);
     
     // Expect (
-    if (!expect(parser, TOKEN_LEFT_PAREN)) {
-        free(else_label);
+    if (!then_label || !else_label || !expect(parser, TOKEN_LEFT_PAREN)) {
         free(end_label);
+        free(then_label);
+        free(else_label);
         return;
     }
     next_token(parser);
     
-    // Parse condition expression
-    parse_expression(parser);
-    
-    // Condition result is on stack
-    fprintf(parser->output, "POPS LF@cond\n");
-    fprintf(parser->output, "JUMPIFEQ %s LF@cond bool@false\n", else_label);
+    // Parse condition, false paths jump to the else block
+    ExprResult cond;
+    parse_condition(parser, &cond);
+    generate_branch_false(parser, &cond);
+    generate_bind_labels(parser, &cond.true_list);
     
     // Expect )
     if (!expect(parser, TOKEN_RIGHT_PAREN)) {
-        free(else_label);
+        expr_result_free(&cond);
         free(end_label);
+        free(then_label);
+        free(else_label);
         return;
     }
     next_token(parser);
     
     // Parse then block
+    emit(parser, "LABEL %s\n", then_label);
+    generate_counter(parser, COUNTER_THEN, parser->current_function, line, column);
     parse_block(parser);
     
     // Jump to end after then block
-    fprintf(parser->output, "JUMP %s\n", end_label);
-    
-    // Generate else label
-    fprintf(parser->output, "LABEL %s\n", else_label);
+    emit(parser, "JUMP %s\n", end_label);
+    
+    // Else block starts where the condition jumps when false
+    generate_bind_labels(parser, &cond.false_list);
+    emit(parser, "LABEL %s\n", else_label);
+    generate_counter(parser, COUNTER_ELSE, parser->current_function, line, column);
+    expr_result_free(&cond);
+    free(then_label);
+    free(else_label);
     
     // Expect else
     if (!expect(parser, TOKEN_ELSE)) {
         error(parser, SYNTAX_ERROR, "Expected else in if statement");
-        free(else_label);
         free(end_label);
         return;
     }
@@ -734,69 +1937,534 @@ void parse_if_statement(Parser* parser) {
     parse_block(parser);
     
     // Generate end label
-    fprintf(parser->output, "LABEL %s\n", end_label);
+    emit(parser, "LABEL %s\n", end_label);
     
-    free(else_label);
     free(end_label);
 }
 
+// Records tokens until depth brackets are closed, the closing bracket included,
+// errors are left to the parse of the recorded tokens
+static void record_balanced(Parser* parser, TokenBuffer* tokens, TokenType open, TokenType close, int depth) {
+    start_recording(parser, tokens);
+    while (!accept(parser, TOKEN_EOF) && !accept(parser, TOKEN_ERROR)) {
+        depth += accept(parser, open) ? 1 : accept(parser, close) ? -1 : 0;
+        next_token(parser);
+        if (depth == 0) break;
+    }
+    stop_recording(parser);
+}
+
+// Parses a recorded loop body once more, repeated copies get plain labels
+static void generate_body_copy(Parser* parser, const TokenBuffer* body, bool repeated) {
+    bool in_copy = parser->in_copy;
+    parser->in_copy = in_copy || repeated;
+    replay_tokens(parser, body);
+    parse_block(parser);
+    parser->in_copy = in_copy;
+}
+
+/**
+ * Generates while loop from recorded tokens, the condition is tested before
+ * the first iteration and again at the bottom
+ * @param parser parser with output
+ * @param cond condition tokens including the closing parenthesis
+ * @param body block tokens
+ * @param copies copies of the body in one iteration
+ * @param label label of the body
+ * @param max_cond longest condition copied in front of the loop
+ * @param line line of the loop, identifies its counter
+ * @param column column of the loop
+ * @return instructions of the last copy of the body
+ */
+static int generate_loop(Parser* parser, const TokenBuffer* cond, const TokenBuffer* body, int copies,
+                         const char* label, int max_cond, int line, int column) {
+    // Guard before the first iteration, false paths leave the loop
+    int cond_start = parser->code.count;
+    ExprResult guard;
+    replay_tokens(parser, cond);
+    parse_condition(parser, &guard);
+    generate_branch_false(parser, &guard);
+    if (parser->had_error || !expect(parser, TOKEN_RIGHT_PAREN)) {
+        expr_result_free(&guard);
+        return 0;
+    }
+    next_token(parser);
+    
+    // Long condition is not duplicated, the loop is entered at the bottom test
+    char* test_label = NULL;
+    if (parser->code.count - cond_start > max_cond) {
+        ilist_truncate(&parser->code, cond_start);
+        expr_result_free(&guard);
+        expr_result_init(&guard);
+        test_label = generate_label(parser);
+        emit(parser, "JUMP %s\n", test_label);
+    }
+    
+    // Parse loop body
+    int body_start = parser->code.count;
+    emit(parser, "LABEL %s\n", label);
+    generate_counter(parser, COUNTER_LOOP, parser->current_function, line, column);
+    int size = 0;
+    for (int i = 0; i < copies && !parser->had_error; i++) {
+        int copy_start = parser->code.count;
+        generate_body_copy(parser, body, i > 0);
+        size = parser->code.count - copy_start;
+    }
+    
+    if (test_label) {
+        emit(parser, "LABEL %s\n", test_label);
+        free(test_label);
+    }
+    
+    // Bottom test, true paths jump back to the body
+    ExprResult test;
+    replay_tokens(parser, cond);
+    parse_condition(parser, &test);
+    generate_branch_true(parser, &test);
+    if (parser->had_error || !expect(parser, TOKEN_RIGHT_PAREN)) {
+        expr_result_free(&guard);
+        expr_result_free(&test);
+        return size;
+    }
+    next_token(parser);
+    
+    bind_labels_at(parser, &guard.true_list, body_start);
+    bind_labels_at(parser, &test.true_list, body_start);
+    
+    // Loop ends where the conditions jump when false
+    generate_bind_labels(parser, &guard.false_list);
+    generate_bind_labels(parser, &test.false_list);
+    expr_result_free(&guard);
+    expr_result_free(&test);
+    return size;
+}
+
+// Canonical counted loop: condition i < n or i <= n with n an integer literal or
+// a local, the body ends with i = i + step and writes neither i elsewhere nor n
+static bool counted_loop(Parser* parser, const TokenBuffer* cond, const TokenBuffer* body, long long* step) {
+    if (cond->count != 4 || cond->items[0].type != TOKEN_IDENTIFIER ||
+        (cond->items[1].type != TOKEN_LESS && cond->items[1].type != TOKEN_LESS_EQUAL) ||
+        (cond->items[2].type != TOKEN_INT_LITERAL && cond->items[2].type != TOKEN_IDENTIFIER)) {
+        return false;
+    }
+    const char* counter = cond->items[0].value;
+    const Token* limit = &cond->items[2];
+    
+    // Properties are not locals, any call may change them
+    SymbolData* data = NULL;
+    if (!symtable_find(parser->local_table, counter, &data) ||
+        (limit->type == TOKEN_IDENTIFIER && (strcmp(limit->value, counter) == 0 ||
+                                             !symtable_find(parser->local_table, limit->value, &data)))) {
+        return false;
+    }
+    
+    // Last statement of { EOL ... EOL i = i + step }
+    int end = body->count - 1;
+    while (end > 0 && body->items[end - 1].type == TOKEN_EOL) end--;
+    int increment = end - 5;
+    const Token* t = &body->items[increment];
+    if (increment < 2 || t[-1].type != TOKEN_EOL || !is_identifier(&t[0], counter) || t[1].type != TOKEN_ASSIGN ||
+        !is_identifier(&t[2], counter) || t[3].type != TOKEN_PLUS || t[4].type != TOKEN_INT_LITERAL) {
+        return false;
+    }
+    ConstValue value;
+    if (!const_from_literal(TOKEN_INT_LITERAL, t[4].value, &value) || value.type != CONST_INT || value.value.integer <= 0) {
+        return false;
+    }
+    *step = value.value.integer;
+    
+    // Declarations would be repeated in the copies
+    for (int i = 0; i + 1 < body->count; i++) {
+        if (body->items[i].type == TOKEN_VAR) return false;
+        if (i != increment && (writes_identifier(body, i, counter) ||
+                               (limit->type == TOKEN_IDENTIFIER && writes_identifier(body, i, limit->value)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Trip count of a counted loop with a literal limit that is entered right after
+// a constant is assigned to its counter
+static bool loop_trip_count(Parser* parser, const TokenBuffer* cond, int loop_start, long long step, unsigned long long* trip) {
+    ConstValue limit;
+    if (cond->items[2].type != TOKEN_INT_LITERAL || loop_start < 2 ||
+        !const_from_literal(TOKEN_INT_LITERAL, cond->items[2].value, &limit) || limit.type != CONST_INT) {
+        return false;
+    }
+    
+    // Straight-line PUSHS int@c, POPS i right before the loop
+    char operand[300];
+    local_operand(parser, cond->items[0].value, operand, sizeof(operand));
+    const Instr* push = &parser->code.items[loop_start - 2];
+    const Instr* pop = &parser->code.items[loop_start - 1];
+    if (!instr_is(push, "PUSHS") || strncmp(push->args[0], "int@", 4) != 0 ||
+        !instr_is(pop, "POPS") || strcmp(pop->args[0], operand) != 0) {
+        return false;
+    }
+    long long start = strtoll(push->args[0] + 4, NULL, 10);
+    long long n = limit.value.integer;
+    
+    // Difference of the bounds always fits unsigned
+    if (cond->items[1].type == TOKEN_LESS) {
+        *trip = start < n ? ((unsigned long long)n - (unsigned long long)start - 1) / step + 1 : 0;
+    } else {
+        *trip = start <= n ? ((unsigned long long)n - (unsigned long long)start) / step + 1 : 0;
+    }
+    return true;
+}
+
+// Condition i + offset < n of a loop unrolled by a factor, relation and limit are kept
+static bool unrolled_condition(const TokenBuffer* cond, long long offset, TokenBuffer* unrolled) {
+    char number[32];
+    snprintf(number, sizeof(number), "%lld", offset);
+    Token plus = {TOKEN_PLUS, NULL, cond->items[0].line, cond->items[0].column};
+    Token literal = {TOKEN_INT_LITERAL, number, cond->items[0].line, cond->items[0].column};
+    
+    *unrolled = (TokenBuffer){NULL, 0, 0, NULL};
+    return token_buffer_add(unrolled, &cond->items[0]) && token_buffer_add(unrolled, &plus) &&
+           token_buffer_add(unrolled, &literal) && token_buffer_add(unrolled, &cond->items[1]) &&
+           token_buffer_add(unrolled, &cond->items[2]) && token_buffer_add(unrolled, &cond->items[3]);
+}
+
+/**
+ * Generates counted loop again unrolled, fully when the trip count is known and
+ * small, otherwise by a factor followed by the loop for the remaining iterations
+ * @param parser parser with output
+ * @param cond condition tokens
+ * @param body block tokens
+ * @param loop_start index of the first instruction of the loop
+ * @param size instructions of one copy of the body
+ * @param label label of the body
+ * @param max_cond longest condition copied in front of the loop
+ * @param line line of the loop
+ * @param column column of the loop
+ */
+static void unroll_loop(Parser* parser, const TokenBuffer* cond, const TokenBuffer* body, int loop_start, int size,
+                        const char* label, int max_cond, int line, int column) {
+    long long step;
+    if (!parser->unroll || size <= 0 || !counted_loop(parser, cond, body, &step)) return;
+    
+    // Body is repeated without any test
+    unsigned long long trip;
+    if (loop_trip_count(parser, cond, loop_start, step, &trip) && trip <= (unsigned long long)(parser->unroll_budget / size)) {
+        ilist_truncate(&parser->code, loop_start);
+        for (unsigned long long i = 0; i < trip && !parser->had_error; i++) {
+            generate_body_copy(parser, body, i > 0);
+        }
+        return;
+    }
+    
+    int factor = parser->unroll_factor;
+    while (factor > 1 && factor * size > parser->unroll_budget) factor--;
+    if (factor < 2) return;
+    
+    // Unrolled loop runs while all its copies would, the original one runs the rest
+    TokenBuffer unrolled = {NULL, 0, 0, NULL};
+    char* rest_label = generate_label(parser);
+    if (!rest_label || !unrolled_condition(cond, (factor - 1) * step, &unrolled)) {
+        free(rest_label);
+        token_buffer_free(&unrolled);
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    ilist_truncate(&parser->code, loop_start);
+    generate_loop(parser, &unrolled, body, factor, label, max_cond, line, column);
+    
+    bool in_copy = parser->in_copy;
+    parser->in_copy = true;
+    generate_loop(parser, cond, body, 1, rest_label, max_cond, line, column);
+    parser->in_copy = in_copy;
+    
+    free(rest_label);
+    token_buffer_free(&unrolled);
+}
+
+// Loop of -O0 tested at its top, label of the body counts iterations as in
+// the rotated loop
+static int generate_plain_loop(Parser* parser, const TokenBuffer* cond, const TokenBuffer* body, const char* label,
+                               int line, int column) {
+    char* test_label = generate_label(parser);
+    if (!test_label) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return 0;
+    }
+    emit(parser, "LABEL %s\n", test_label);
+    
+    // False paths leave the loop
+    ExprResult test;
+    replay_tokens(parser, cond);
+    parse_condition(parser, &test);
+    generate_branch_false(parser, &test);
+    generate_bind_labels(parser, &test.true_list);
+    if (parser->had_error || !expect(parser, TOKEN_RIGHT_PAREN)) {
+        expr_result_free(&test);
+        free(test_label);
+        return 0;
+    }
+    next_token(parser);
+    
+    // Parse loop body and jump back to the test
+    emit(parser, "LABEL %s\n", label);
+    generate_counter(parser, COUNTER_LOOP, parser->current_function, line, column);
+    int body_start = parser->code.count;
+    generate_body_copy(parser, body, false);
+    int size = parser->code.count - body_start;
+    emit(parser, "JUMP %s\n", test_label);
+    
+    generate_bind_labels(parser, &test.false_list);
+    expr_result_free(&test);
+    free(test_label);
+    return size;
+}
+
 /**
  * Parse while statement: while (expression) block
  */
 void parse_while_statement(Parser* parser) {
-    // Generate labels
-    char* start_label = generate_label(parser);
-    char* end_label = generate_label(parser);
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    char* body_label = stable_label(parser, "loop", &parser->current_token);
+    if (!body_label) return;
     
-    // Generate start label
-    fprintf(parser->output, "LABEL %s\n", start_label);
+    // Hot loops may copy longer conditions, loops that never iterate none
+    int max_cond = LOOP_ROTATION_MAX_COND;
+    long count = -1;
+    if (label_profile_count(parser, body_label, &count)) {
+        max_cond = count == 0 ? 0 : count >= PROFILE_HOT_COUNT ? max_cond * 4 : max_cond;
+    }
+    body_label = block_label(parser, body_label);
+    if (!body_label) return;
     
     // Consume while
+    int loop_start = parser->code.count;
     next_token(parser);
     
     // Expect (
     if (!expect(parser, TOKEN_LEFT_PAREN)) {
-        free(start_label);
-        free(end_label);
+        free(body_label);
         return;
     }
     next_token(parser);
     
-    // Parse condition expression
-    parse_expression(parser);
+    // Condition and body are recorded first, the loop is generated from the copies
+    TokenBuffer cond_tokens;
+    TokenBuffer body_tokens = {NULL, 0, 0, NULL};
+    record_balanced(parser, &cond_tokens, TOKEN_LEFT_PAREN, TOKEN_RIGHT_PAREN, 1);
+    if (!parser->had_error && expect(parser, TOKEN_LEFT_BRACE)) {
+        record_balanced(parser, &body_tokens, TOKEN_LEFT_BRACE, TOKEN_RIGHT_BRACE, 0);
+    }
     
-    // Condition result is on stack
-    fprintf(parser->output, "POPS LF@cond\n");
-    fprintf(parser->output, "JUMPIFEQ %s LF@cond bool@false\n", end_label);
+    // Recordings of enclosing code got the tokens already
+    TokenBuffer* recording = parser->recording;
+    parser->recording = NULL;
+    if (!parser->had_error) {
+        int size = parser->level < 1 ? generate_plain_loop(parser, &cond_tokens, &body_tokens, body_label, line, column)
+                                     : generate_loop(parser, &cond_tokens, &body_tokens, 1, body_label, max_cond, line, column);
+        if (count != 0 && !parser->instrument && !parser->had_error) {
+            unroll_loop(parser, &cond_tokens, &body_tokens, loop_start, size, body_label, max_cond, line, column);
+        }
+    }
+    parser->recording = recording;
     
-    // Expect )
-    if (!expect(parser, TOKEN_RIGHT_PAREN)) {
-        free(start_label);
-        free(end_label);
+    token_buffer_free(&cond_tokens);
+    token_buffer_free(&body_tokens);
+    free(body_label);
+}
+
+/**
+ * Parse for statement: for i in a..b { } or for i in a...b { }, the header may
+ * be in parentheses. Bounds are rounded down to integers and evaluated once,
+ * a..b leaves b out and a...b includes it. The counter starts below the end,
+ * so one ADD and JUMPIFNEQ close each iteration. A body assigning i gets a
+ * hidden counter copied to i at the start of each iteration.
+ */
+void parse_for_statement(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    char* body_label = block_label(parser, stable_label(parser, "loop", &parser->current_token));
+    if (!body_label) return;
+    
+    // Consume for, the header may be in parentheses
+    next_token(parser);
+    bool parens = accept(parser, TOKEN_LEFT_PAREN);
+    if (parens) {
+        next_token(parser);
+    }
+    
+    // Counter is a local, declared by the loop unless it exists
+    if (!expect(parser, TOKEN_IDENTIFIER)) {
+        free(body_label);
+        return;
+    }
+    char* name = strdup(parser->current_token.value);
+    if (!name) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        free(body_label);
+        return;
+    }
+    SymbolData* var_data = NULL;
+    if (!symtable_find(parser->local_table, name, &var_data)) {
+        var_data = symdata_create_var(IFJ_TYPE_NULL);
+        if (!var_data || !symtable_insert(parser->local_table, name, var_data)) {
+            error(parser, INTERNAL_ERROR, "Failed to insert variable");
+            symdata_free(var_data);
+        } else {
+            declare_entry_variable(parser, name);
+        }
+    }
+    next_token(parser);
+    if (!parser->had_error && !is_identifier(&parser->current_token, "in")) {
+        error(parser, SYNTAX_ERROR, "Expected in after for loop variable");
+    }
+    if (parser->had_error) {
+        free(name);
+        free(body_label);
         return;
     }
     next_token(parser);
     
-    // Parse loop body
-    parse_block(parser);
+    // Start stays on the stack until the end is evaluated, the end may read i
+    ExprResult start;
+    parse_simple_expression(parser, &start);
+    long long first = 0;
+    bool constant_start = start.kind == EXPR_CONST && !has_jumps(&start) && start.value.type == CONST_INT;
+    if (constant_start) {
+        first = start.value.value.integer;
+    } else {
+        generate_materialize(parser, &start);
+        parser->used_helpers |= HELPER_FLOOR;
+        emit(parser, "CALL $%%floor\n");
+    }
+    expr_result_free(&start);
     
-    // Jump back to start
-    fprintf(parser->output, "JUMP %s\n", start_label);
+    bool inclusive = accept(parser, TOKEN_RANGE_INCLUSIVE);
+    if (!inclusive && !accept(parser, TOKEN_RANGE_EXCLUSIVE)) {
+        error(parser, SYNTAX_ERROR, "Expected .. or ... in for loop");
+        free(name);
+        free(body_label);
+        return;
+    }
+    next_token(parser);
     
-    // Generate end label
-    fprintf(parser->output, "LABEL %s\n", end_label);
+    // End is a constant or a hidden local, a...b ends before b + 1
+    char limit[300];
+    ExprResult end;
+    parse_simple_expression(parser, &end);
+    bool constant_end = end.kind == EXPR_CONST && !has_jumps(&end) && end.value.type == CONST_INT;
+    long long last = 0;
+    if (constant_end) {
+        last = end.value.value.integer + (inclusive ? 1 : 0);
+        snprintf(limit, sizeof(limit), "int@%lld", last);
+    } else {
+        char hidden[64];
+        snprintf(hidden, sizeof(hidden), "%%end%d_%d", line - parser->function_line, column);
+        declare_entry_variable(parser, hidden);
+        snprintf(limit, sizeof(limit), "LF@%s", hidden);
+        generate_materialize(parser, &end);
+        parser->used_helpers |= HELPER_FLOOR;
+        emit(parser, "CALL $%%floor\n");
+        if (inclusive) {
+            emit(parser, "PUSHS int@1\n");
+            emit(parser, "ADDS\n");
+        }
+        emit(parser, "POPS %s\n", limit);
+    }
+    expr_result_free(&end);
+    if (parens && !parser->had_error && expect(parser, TOKEN_RIGHT_PAREN)) {
+        next_token(parser);
+    }
+    
+    // Body is recorded first, it decides whether i can be the counter itself
+    TokenBuffer body = {NULL, 0, 0, NULL};
+    if (!parser->had_error && expect(parser, TOKEN_LEFT_BRACE)) {
+        record_balanced(parser, &body, TOKEN_LEFT_BRACE, TOKEN_RIGHT_BRACE, 0);
+    }
+    bool assigned = false;
+    for (int i = 1; i + 1 < body.count; i++) {
+        assigned = assigned || writes_identifier(&body, i, name);
+    }
+    
+    char variable[300];
+    char counter[300];
+    local_operand(parser, name, variable, sizeof(variable));
+    snprintf(counter, sizeof(counter), "%s", variable);
+    if (assigned) {
+        char hidden[64];
+        snprintf(hidden, sizeof(hidden), "%%for%d_%d", line - parser->function_line, column);
+        declare_entry_variable(parser, hidden);
+        snprintf(counter, sizeof(counter), "LF@%s", hidden);
+    }
+    
+    // Empty range skips the loop
+    char* exit_label = parser->had_error ? NULL : generate_label(parser);
+    if (exit_label) {
+        if (constant_start) {
+            emit(parser, "MOVE %s int@%lld\n", counter, first);
+        } else {
+            emit(parser, "POPS %s\n", counter);
+        }
+        
+        // An empty range leaves i at the start with either counter
+        if (assigned) {
+            emit(parser, "MOVE %s %s\n", variable, counter);
+        }
+        if (!constant_start || !constant_end) {
+            emit(parser, "LT GF@%%tmp0 %s %s\n", counter, limit);
+            emit(parser, "JUMPIFEQ %s GF@%%tmp0 bool@false\n", exit_label);
+        } else if (first >= last) {
+            emit(parser, "JUMP %s\n", exit_label);
+        }
+    }
+    
+    // Replayed body is not part of any recording of the enclosing code
+    TokenBuffer* recording = parser->recording;
+    parser->recording = NULL;
+    if (exit_label) {
+        emit(parser, "LABEL %s\n", body_label);
+        generate_counter(parser, COUNTER_LOOP, parser->current_function, line, column);
+        if (assigned) {
+            emit(parser, "MOVE %s %s\n", variable, counter);
+        }
+        generate_body_copy(parser, &body, false);
+        emit(parser, "ADD %s %s int@1\n", counter, counter);
+        emit(parser, "JUMPIFNEQ %s %s %s\n", body_label, counter, limit);
+        emit(parser, "LABEL %s\n", exit_label);
+    }
+    parser->recording = recording;
     
-    free(start_label);
-    free(end_label);
+    token_buffer_free(&body);
+    free(exit_label);
+    free(name);
+    free(body_label);
 }
 
 /**
- * Generate return code
+ * Generate return code, return value is on the stack
  */
-/*
 void generate_return(Parser* parser) {
+    if (parser->frame_args) {
+        // Value pushed by the last instruction is moved to the slot directly
+        Instr* last = ilist_last(&parser->code);
+        if (instr_is(last, "PUSHS")) {
+            char* value = strdup(last->args[0]);
+            if (!value) {
+                error(parser, INTERNAL_ERROR, "Memory allocation failed");
+                return;
+            }
+            ilist_remove(&parser->code, parser->code.count - 1);
+            if (strcmp(value, "GF@%retval") != 0) {
+                emit(parser, "MOVE GF@%%retval %s\n", value);
+            }
+            free(value);
+        } else {
+            emit(parser, "POPS GF@%%retval\n");
+        }
+    }
+    emit(parser, "POPFRAME\n");
+    emit(parser, "RETURN\n");
 }
-*/
+
 /**
  * Parse return statement: return expression
  */
@@ -805,37 +2473,108 @@ void parse_return(Parser* parser) {
     next_token(parser);
     
     // Parse return expression (result will be on stack)
-    parse_expression(parser);
+    ExprResult result;
+    parse_or_expression(parser, &result);
+    
+    // Clones are replayed inside other functions, the type comes from the generic code
+    if (!parser->specialized) {
+        parser->returns_string = parser->returns_string && is_string(&result);
+    }
+    generate_materialize(parser, &result);
+    expr_result_free(&result);
     
     // Generate return code
-    //generate_return(parser);
+    generate_return(parser);
+}
+
+/**
+ * Parse name of called function: id or Ifj.id
+ */
+static char* parse_callee_name(Parser* parser) {
+    char* name = NULL;
+    
+    if (accept(parser, TOKEN_IFJ_NAMESPACE)) {
+        next_token(parser);
+        if (!expect(parser, TOKEN_DOT)) return NULL;
+        next_token(parser);
+        if (!expect(parser, TOKEN_IDENTIFIER)) return NULL;
+        
+        name = malloc(strlen(parser->current_token.value) + 5);
+        if (name) {
+            sprintf(name, "Ifj.%s", parser->current_token.value);
+        }
+    } else {
+        if (!expect(parser, TOKEN_IDENTIFIER)) return NULL;
+        name = strdup(parser->current_token.value);
+    }
+    
+    if (!name) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return NULL;
+    }
+    next_token(parser);
+    return name;
+}
+
+/**
+ * Parse function call used as a statement, its result is thrown away
+ */
+void parse_function_call_statement(Parser* parser) {
+    char* func_name = parse_callee_name(parser);
+    if (!func_name) return;
+    
+    parse_function_call(parser, func_name, NULL);
+    free(func_name);
 }
 
 /**
- * Parse function call
+ * Parse function call, result is NULL when the call is a statement
  */
-void parse_function_call(Parser* parser, const char* func_name) {
+void parse_function_call(Parser* parser, const char* func_name, ExprResult* result) {
+    if (result) {
+        expr_result_init(result);
+    }
+    
     // Consume (
     if (!expect(parser, TOKEN_LEFT_PAREN)) return;
     next_token(parser);
     
-    // Parse arguments
+    // Parse arguments, constants are pushed only if the call is not folded
+    int args_start = parser->code.count;
+    ExprResult* args = NULL;
+    int* marks = NULL;
     int arg_count = 0;
-    if (!accept(parser, TOKEN_RIGHT_PAREN)) {
-        // Parse first argument
-        parse_expression(parser);
-        arg_count++;
-        
-        // Parse additional arguments
-        while (accept(parser, TOKEN_COMMA)) {
+    int capacity = 0;
+    
+    while (!accept(parser, TOKEN_RIGHT_PAREN) && !parser->had_error) {
+        if (arg_count > 0) {
+            if (!expect(parser, TOKEN_COMMA)) break;
             next_token(parser);
-            parse_expression(parser);
-            arg_count++;
         }
+        
+        if (arg_count >= capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            ExprResult* new_args = realloc(args, capacity * sizeof(ExprResult));
+            int* new_marks = new_args ? realloc(marks, capacity * sizeof(int)) : NULL;
+            if (new_args) args = new_args;
+            if (new_marks) marks = new_marks;
+            if (!new_args || !new_marks) {
+                error(parser, INTERNAL_ERROR, "Memory allocation failed");
+                break;
+            }
+        }
+        
+        parse_or_expression(parser, &args[arg_count]);
+        generate_operand(parser, &args[arg_count]);
+        marks[arg_count] = parser->code.count;
+        arg_count++;
     }
     
     // Expect )
-    if (!expect(parser, TOKEN_RIGHT_PAREN)) return;
+    if (parser->had_error || !expect(parser, TOKEN_RIGHT_PAREN)) {
+        free_arguments(args, marks, arg_count);
+        return;
+    }
     next_token(parser);
     
     // Check if function exists
@@ -847,51 +2586,185 @@ void parse_function_call(Parser* parser, const char* func_name) {
     
     if (strncmp(func_name, "Ifj.", 4) == 0) {
         // Built-in function
+        if (!is_builtin_function(func_name)) {
+            error(parser, SEMANTIC_UNDEFINED, "Built-in function not defined");
+            free_arguments(args, marks, arg_count);
+            return;
+        }
+        if (get_builtin_arity(func_name) != arg_count) {
+            error(parser, SEMANTIC_ARG_COUNT, "Wrong number of arguments of built-in function");
+            free_arguments(args, marks, arg_count);
+            return;
+        }
         is_builtin = true;
     } else if (!symtable_find(parser->global_table, key, &func_data)) {
         error(parser, SEMANTIC_UNDEFINED, "Function not defined");
+        free_arguments(args, marks, arg_count);
+        return;
+    }
+    
+    bool all_constant = true;
+    for (int i = 0; i < arg_count; i++) {
+        all_constant = all_constant && args[i].kind == EXPR_CONST;
+    }
+    
+    // Pure function with constant arguments is evaluated now
+    ConstValue folded;
+    if (all_constant && parser->level >= 1 && fold_call(parser, func_name, is_builtin, args, arg_count, &folded)) {
+        if (result) {
+            result->kind = EXPR_CONST;
+            result->value = folded;
+        } else {
+            const_free(&folded);
+        }
+        free_arguments(args, marks, arg_count);
+        return;
+    }
+    
+    if (is_builtin) {
+        // Constant is written directly, consecutive writes are merged
+        if (strcmp(func_name, "Ifj.write") == 0 && args[0].kind == EXPR_CONST) {
+            generate_write_constant(parser, &args[0].value);
+            if (result) {
+                result->kind = EXPR_CONST;
+                const_set_nil(&result->value);
+            }
+            free_arguments(args, marks, arg_count);
+            return;
+        }
+        
+        // Concatenation of strings that is only written becomes writes of its
+        // parts, a part of another type has to fail in CONCAT before any output
+        if (strcmp(func_name, "Ifj.write") == 0 && args[0].kind == EXPR_VALUE && args[0].always_string &&
+            parser->level >= 1 && generate_write_concat(parser, args_start)) {
+            if (result) {
+                emit(parser, "PUSHS nil@nil\n");
+            }
+            free_arguments(args, marks, arg_count);
+            return;
+        }
+    }
+    
+    // Constant arguments may be substituted in a clone, they are not passed then
+    bool* skip = calloc(arg_count ? arg_count : 1, sizeof(bool));
+    if (!skip) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        free_arguments(args, marks, arg_count);
         return;
     }
+    const char* callee = is_builtin ? func_name : specialize_call(parser, key, func_name, args, arg_count, skip);
+    
+    if (!is_builtin && parser->frame_args) {
+        generate_frame_arguments(parser, args, marks, args_start, arg_count, skip);
+    } else {
+        // Push postponed constants where they were parsed, last one first so marks stay valid
+        for (int i = arg_count - 1; i >= 0; i--) {
+            if (!skip[i]) {
+                generate_operand_at(parser, &args[i], marks[i]);
+            }
+        }
+    }
+    free_arguments(args, marks, arg_count);
+    free(skip);
     
     // Generate function call
-    generate_function_call(parser, func_name, arg_count, is_builtin);
+    generate_function_call(parser, callee, arg_count, is_builtin, result != NULL);
+    if (result) {
+        result->string = is_builtin ? builtin_returns_string(func_name) : func_data->func->returns_string;
+        result->always_string = is_builtin && builtin_always_string(func_name);
+    }
 }
 
 /**
  * Generate function call code
  */
-void generate_function_call(Parser* parser, const char* func_name, int arg_count, bool is_builtin) {
+void generate_function_call(Parser* parser, const char* func_name, int arg_count, bool is_builtin, bool use_result) {
+    (void)arg_count;
+    
     if (is_builtin) {
-        // Built-in functions need special handling
-        // For now, just push arguments in reverse order
-        for (int i = 0; i < arg_count; i++) {
-            // Arguments are on stack in correct order
-            // No special generation for builtins in basic version
-        }
-        
-        fprintf(parser->output, "# Call to built-in function %s\n", func_name);
-        
-        // For basic version, just leave values on stack
-        // Real implementation would generate specific IFJcode25 instructions
+        // Built-ins are lowered to instructions, arguments are on stack in correct order
+        generate_builtin_call(parser, func_name, use_result);
     } else {
         // User-defined function
         // Arguments should already be on stack in correct order
-        fprintf(parser->output, "CALL $%s\n", func_name);
+        parser->straight_start = false;
+        emit(parser, "CALL $%s\n", func_name);
+        
+        // Frame convention returns in GF@%retval
+        if (parser->frame_args) {
+            if (use_result) {
+                emit(parser, "PUSHS GF@%%retval\n");
+            }
+            return;
+        }
+        
+        // Every function returns a value, drop it if unused
+        if (!use_result) {
+            emit(parser, "POPS GF@%%tmp0\n");
+        }
     }
 }
 
 /**
- * Parse expression using precedence
+ * Parse expression using precedence, result is left on the stack
  */
 void parse_expression(Parser* parser) {
-    parse_is_expression(parser);
+    ExprResult result;
+    parse_or_expression(parser, &result);
+    generate_materialize(parser, &result);
+    expr_result_free(&result);
+}
+
+/**
+ * Parse expression used as a condition, booleans stay as jumps
+ */
+void parse_condition(Parser* parser, ExprResult* result) {
+    parse_or_expression(parser, result);
 }
 
 /**
- * Parse is expression (lowest priority)
+ * Parse || expression (lowest priority)
  */
-void parse_is_expression(Parser* parser) {
-    parse_relation(parser);
+void parse_or_expression(Parser* parser, ExprResult* result) {
+    parse_and_expression(parser, result);
+    
+    while (accept(parser, TOKEN_OR)) {
+        next_token(parser);
+        
+        // Left operand decides when true, right one is evaluated only when false
+        generate_branch_true(parser, result);
+        generate_bind_labels(parser, &result->false_list);
+        
+        ExprResult right;
+        parse_and_expression(parser, &right);
+        expr_result_merge(result, &right);
+    }
+}
+
+/**
+ * Parse && expression
+ */
+void parse_and_expression(Parser* parser, ExprResult* result) {
+    parse_is_expression(parser, result);
+    
+    while (accept(parser, TOKEN_AND)) {
+        next_token(parser);
+        
+        // Left operand decides when false, right one is evaluated only when true
+        generate_branch_false(parser, result);
+        generate_bind_labels(parser, &result->true_list);
+        
+        ExprResult right;
+        parse_is_expression(parser, &right);
+        expr_result_merge(result, &right);
+    }
+}
+
+/**
+ * Parse is expression
+ */
+void parse_is_expression(Parser* parser, ExprResult* result) {
+    parse_relation(parser, result);
     
     if (accept(parser, TOKEN_IS)) {
         next_token(parser);
@@ -905,119 +2778,224 @@ void parse_is_expression(Parser* parser) {
         TokenType type_token = parser->current_token.type;
         next_token(parser);
         
+        // Type of a constant is known now
+        if (result->kind == EXPR_CONST && !has_jumps(result) && parser->level >= 1) {
+            ConstType type = result->value.type;
+            bool is_type = (type_token == TOKEN_NUM && (type == CONST_INT || type == CONST_FLOAT)) ||
+                (type_token == TOKEN_STRING_TYPE && type == CONST_STRING) ||
+                (type_token == TOKEN_NULL_TYPE && type == CONST_NIL);
+            const_free(&result->value);
+            const_set_bool(&result->value, is_type);
+            return;
+        }
+        
         // Generate is operation
+        generate_materialize(parser, result);
         generate_is_op(parser, type_token);
+        result->kind = EXPR_BOOL;
     }
 }
 
 /**
  * Parse relation expressions (==, !=, <, >, <=, >=)
  */
-void parse_relation(Parser* parser) {
-    parse_simple_expression(parser);
+void parse_relation(Parser* parser, ExprResult* result) {
+    parse_simple_expression(parser, result);
     
     while (IS_REL_OPERATOR(parser->current_token.type)) {
         TokenType op = parser->current_token.type;
         next_token(parser);
         
-        parse_simple_expression(parser);
+        generate_operand(parser, result);
+        int mark = parser->code.count;
+        
+        ExprResult right;
+        parse_simple_expression(parser, &right);
+        
+        // Comparison of constants
+        bool folded;
+        if (result->kind == EXPR_CONST && right.kind == EXPR_CONST && !has_jumps(&right) && parser->level >= 1 &&
+            fold_relational(op, &result->value, &right.value, &folded)) {
+            const_free(&result->value);
+            const_set_bool(&result->value, folded);
+            expr_result_free(&right);
+            continue;
+        }
+        
+        generate_materialize(parser, &right);
+        generate_operand_at(parser, result, mark);
+        expr_result_free(&right);
         
         // Generate relational operation
-        generate_relational_op(parser, op);
+        generate_relational_op(parser, op, result);
     }
 }
 
 /**
  * Parse simple expression (+, -)
  */
-void parse_simple_expression(Parser* parser) {
-    parse_term(parser);
+void parse_simple_expression(Parser* parser, ExprResult* result) {
+    parse_term(parser, result);
     
     while (accept(parser, TOKEN_PLUS) || accept(parser, TOKEN_MINUS)) {
         TokenType op = parser->current_token.type;
         next_token(parser);
         
-        parse_term(parser);
+        generate_operand(parser, result);
+        int mark = parser->code.count;
         
-        // Generate binary operation
-        generate_binary_op(parser, op);
+        ExprResult right;
+        parse_term(parser, &right);
+        generate_arithmetic(parser, op, result, &right, mark);
     }
 }
 
 /**
  * Parse term (*, /)
  */
-void parse_term(Parser* parser) {
-    parse_factor(parser);
+void parse_term(Parser* parser, ExprResult* result) {
+    parse_factor(parser, result);
     
     while (accept(parser, TOKEN_MULTIPLY) || accept(parser, TOKEN_DIVIDE)) {
         TokenType op = parser->current_token.type;
         next_token(parser);
         
-        parse_factor(parser);
+        generate_operand(parser, result);
+        int mark = parser->code.count;
         
-        // Generate binary operation
-        generate_binary_op(parser, op);
+        ExprResult right;
+        parse_factor(parser, &right);
+        generate_arithmetic(parser, op, result, &right, mark);
     }
 }
 
 /**
  * Parse factor (basic elements)
  */
-void parse_factor(Parser* parser) {
+void parse_factor(Parser* parser, ExprResult* result) {
+    expr_result_init(result);
+    
     switch (parser->current_token.type) {
         case TOKEN_IDENTIFIER: {
+            // Function call
+            if (peek_token(parser)->type == TOKEN_LEFT_PAREN) {
+                char* func_name = parse_callee_name(parser);
+                if (func_name) {
+                    parse_function_call(parser, func_name, result);
+                    free(func_name);
+                }
+                break;
+            }
+            
             // Local variable
             char* name = parser->current_token.value;
             
-            // Check if variable exists
+            // Property read through its getter, a trivial one reads the global itself
             SymbolData* var_data = NULL;
             if (!symtable_find(parser->local_table, name, &var_data)) {
-                error(parser, SEMANTIC_UNDEFINED, "Undefined variable");
-                return;
+                SymbolData* getter = find_accessor(parser, name, false);
+                if (!getter) {
+                    error(parser, SEMANTIC_UNDEFINED, "Undefined variable");
+                    return;
+                }
+                if (getter->func->global) {
+                    note_global_read(parser, getter->func->global);
+                    emit(parser, "PUSHS GF@%s\n", getter->func->global);
+                } else {
+                    generate_accessor_call(parser, name, false);
+                }
+                next_token(parser);
+                break;
+            }
+            
+            // Parameter of a clone may be a constant
+            const ConstValue* constant = specialized_parameter(parser, name);
+            if (constant) {
+                if (!const_copy(&result->value, constant)) {
+                    error(parser, INTERNAL_ERROR, "Memory allocation failed");
+                    return;
+                }
+                result->kind = EXPR_CONST;
+                next_token(parser);
+                break;
             }
             
             // Push variable value onto stack
-            fprintf(parser->output, "PUSHS LF@%s\n", name);
+            char operand[300];
+            local_operand(parser, name, operand, sizeof(operand));
+            emit(parser, "PUSHS %s\n", operand);
             
             next_token(parser);
             break;
         }
+        
+        case TOKEN_IFJ_NAMESPACE: {
+            // Built-in function call
+            char* func_name = parse_callee_name(parser);
+            if (func_name) {
+                parse_function_call(parser, func_name, result);
+                free(func_name);
+            }
+            break;
+        }
             
         case TOKEN_GLOBAL_IDENTIFIER: {
             // Global variable
             char* name = parser->current_token.value;
             
             // Global variables always exist (value is null if not initialized)
-            fprintf(parser->output, "PUSHS GF@%s\n", name);
+            note_global_read(parser, name);
+            emit(parser, "PUSHS GF@%s\n", name);
             
             next_token(parser);
             break;
         }
             
         case TOKEN_INT_LITERAL:
-            fprintf(parser->output, "PUSHS int@%s\n", parser->current_token.value);
-            next_token(parser);
-            break;
-            
         case TOKEN_FLOAT_LITERAL:
-            fprintf(parser->output, "PUSHS float@%s\n", parser->current_token.value);
-            next_token(parser);
-            break;
-            
         case TOKEN_STRING_LITERAL:
-            fprintf(parser->output, "PUSHS string@%s\n", parser->current_token.value);
+        case TOKEN_MULTILINE_STRING_LITERAL:
+        case TOKEN_NULL:
+            // Literals are pushed only once we know they are not folded
+            if (!const_from_literal(parser->current_token.type, parser->current_token.value, &result->value)) {
+                error(parser, INTERNAL_ERROR, "Memory allocation failed");
+                return;
+            }
+            result->kind = EXPR_CONST;
             next_token(parser);
             break;
             
-        case TOKEN_NULL:
-            fprintf(parser->output, "PUSHS nil@nil\n");
+        case TOKEN_NOT:
+            // Negation only swaps the meaning of the operand's jumps
             next_token(parser);
+            parse_factor(parser, result);
+            
+            if (result->kind == EXPR_CONST && result->value.type == CONST_BOOL && parser->level >= 1) {
+                result->value.value.boolean = !result->value.value.boolean;
+            } else {
+                if (result->kind == EXPR_CONST) {
+                    generate_materialize(parser, result);
+                }
+                if (result->kind == EXPR_VALUE) {
+                    result->kind = EXPR_BOOL;
+                }
+                if (result->kind == EXPR_COND_TRUE) {
+                    result->kind = EXPR_COND_FALSE;
+                } else if (result->kind == EXPR_COND_FALSE) {
+                    result->kind = EXPR_COND_TRUE;
+                } else {
+                    result->negated = !result->negated;
+                }
+            }
+            
+            LabelList swap = result->true_list;
+            result->true_list = result->false_list;
+            result->false_list = swap;
             break;
             
         case TOKEN_LEFT_PAREN:
             next_token(parser);
-            parse_expression(parser);
+            parse_or_expression(parser, result);
             if (!expect(parser, TOKEN_RIGHT_PAREN)) return;
             next_token(parser);
             break;
@@ -1028,6 +3006,110 @@ void parse_factor(Parser* parser) {
     return;
 }
 
+/**
+ * Generate arithmetic on two operands, left operand is either on the stack
+ * or a constant that belongs to position mark
+ */
+static void generate_arithmetic(Parser* parser, TokenType op, ExprResult* left, ExprResult* right, int mark) {
+    ConstValue folded;
+    if (left->kind == EXPR_CONST && right->kind == EXPR_CONST && !has_jumps(right) && parser->level >= 1 &&
+        fold_binary(op, &left->value, &right->value, &folded)) {
+        const_free(&left->value);
+        left->value = folded;
+        expr_result_free(right);
+        return;
+    }
+    
+    if (op == TOKEN_PLUS && (is_string(left) || is_string(right)) && !has_jumps(right)) {
+        generate_concat(parser, left, right, mark);
+        expr_result_free(right);
+        return;
+    }
+    
+    generate_materialize(parser, right);
+    generate_operand_at(parser, left, mark);
+    expr_result_free(right);
+    
+    // Generate binary operation
+    generate_binary_op(parser, op);
+}
+
+// Removes PUSHS at index and returns its operand, caller frees
+static char* take_pushed_operand(Parser* parser, int index) {
+    Instr* push = &parser->code.items[index];
+    char* operand = push->args[0];
+    push->args[0] = NULL;
+    push->argc = 0;
+    ilist_remove(&parser->code, index);
+    return operand;
+}
+
+/**
+ * Generate concatenation of two strings into GF@%tmp0, the result is pushed.
+ * Operands pushed by the last instruction are read directly, so a chain
+ * a + b + c builds one accumulator with a CONCAT per part and literals at
+ * its end are joined into the last CONCAT.
+ */
+static void generate_concat(Parser* parser, ExprResult* left, ExprResult* right, int mark) {
+    InstrList* code = &parser->code;
+    bool always_string = is_always_string(left) && is_always_string(right);
+    char* right_operand = NULL;
+    char* left_operand = NULL;
+    bool right_simple = false;
+    
+    if (right->kind == EXPR_CONST) {
+        right_operand = const_operand(&right->value);
+        right_simple = true;
+    } else if (code->count > mark && instr_is(&code->items[code->count - 1], "PUSHS")) {
+        right_simple = code->count == mark + 1;
+        right_operand = take_pushed_operand(parser, code->count - 1);
+    }
+    if (left->kind == EXPR_CONST) {
+        left_operand = const_operand(&left->value);
+    } else if (right_operand && right_simple && mark > 0 && instr_is(&code->items[mark - 1], "PUSHS")) {
+        left_operand = take_pushed_operand(parser, mark - 1);
+    }
+    if ((right->kind == EXPR_CONST && !right_operand) || (left->kind == EXPR_CONST && !left_operand)) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+    } else if (!right_operand) {
+        // Both operands on the stack, or the right one behind a constant
+        emit(parser, "POPS GF@%%tmp0\n");
+        if (left_operand) {
+            emit(parser, "CONCAT GF@%%tmp0 %s GF@%%tmp0\n", left_operand);
+        } else {
+            emit(parser, "POPS GF@%%r0\n");
+            emit(parser, "CONCAT GF@%%tmp0 GF@%%r0 GF@%%tmp0\n");
+        }
+    } else if (!left_operand) {
+        emit(parser, "POPS GF@%%r0\n");
+        emit(parser, "CONCAT GF@%%tmp0 GF@%%r0 %s\n", right_operand);
+    } else {
+        // Literal continuing a chain that ends with a literal is joined to it
+        Instr* last = ilist_last(code);
+        if (parser->level >= 1 && strcmp(left_operand, "GF@%tmp0") == 0 && strncmp(right_operand, "string@", 7) == 0 &&
+            last && instr_is(last, "CONCAT") && strcmp(last->args[0], "GF@%tmp0") == 0 &&
+            strncmp(last->args[2], "string@", 7) == 0) {
+            size_t len = strlen(last->args[2]);
+            char* joined = malloc(len + strlen(right_operand + 7) + 1);
+            if (!joined || (strcpy(joined, last->args[2]), strcpy(joined + len, right_operand + 7),
+                            !instr_set_arg(last, 2, joined))) {
+                error(parser, INTERNAL_ERROR, "Memory allocation failed");
+            }
+            free(joined);
+        } else {
+            emit(parser, "CONCAT GF@%%tmp0 %s %s\n", left_operand, right_operand);
+        }
+    }
+    emit(parser, "PUSHS GF@%%tmp0\n");
+    
+    free(left_operand);
+    free(right_operand);
+    const_free(&left->value);
+    left->kind = EXPR_VALUE;
+    left->string = true;
+    left->always_string = always_string;
+}
+
 /**
  * Generate binary operation code
  */
@@ -1036,16 +3118,16 @@ void generate_binary_op(Parser* parser, TokenType op) {
     
     switch (op) {
         case TOKEN_PLUS:
-            fprintf(parser->output, "ADDS\n");
+            emit(parser, "ADDS\n");
             break;
         case TOKEN_MINUS:
-            fprintf(parser->output, "SUBS\n");
+            emit(parser, "SUBS\n");
             break;
         case TOKEN_MULTIPLY:
-            fprintf(parser->output, "MULS\n");
+            emit(parser, "MULS\n");
             break;
         case TOKEN_DIVIDE:
-            fprintf(parser->output, "DIVS\n");
+            emit(parser, "DIVS\n");
             break;
         default:
             error(parser, INTERNAL_ERROR, "Unknown binary operator");
@@ -1057,65 +3139,191 @@ void generate_binary_op(Parser* parser, TokenType op) {
 }
 
 /**
- * Generate relational operation code
+ * Generate relational operation code, both operands are on the stack.
+ * The comparison stays on the stack so a condition can branch on it directly.
  */
-void generate_relational_op(Parser* parser, TokenType op) {
-    char* temp = generate_temp_var(parser);
+void generate_relational_op(Parser* parser, TokenType op, ExprResult* result) {
+    expr_result_init(result);
     
     switch (op) {
         case TOKEN_EQUAL:
-            fprintf(parser->output, "EQS\n");
+            // Compared by JUMPIFEQS/JUMPIFNEQS or EQS once we know how it is used
+            result->kind = EXPR_EQ_PAIR;
             break;
         case TOKEN_NOT_EQUAL:
-            // For !=, we need to negate the result of EQ
-            fprintf(parser->output, "EQS\n");
-            fprintf(parser->output, "NOTS\n");
+            result->kind = EXPR_EQ_PAIR;
+            result->negated = true;
             break;
         case TOKEN_LESS:
-            fprintf(parser->output, "LTS\n");
+            emit(parser, "LTS\n");
+            result->kind = EXPR_BOOL;
             break;
         case TOKEN_GREATER:
-            // For >, we can use LT with swapped operands
-            fprintf(parser->output, "POPS LF@temp2\n");
-            fprintf(parser->output, "POPS LF@temp1\n");
-            fprintf(parser->output, "PUSHS LF@temp2\n");
-            fprintf(parser->output, "PUSHS LF@temp1\n");
-            fprintf(parser->output, "LTS\n");
+            emit(parser, "GTS\n");
+            result->kind = EXPR_BOOL;
             break;
         case TOKEN_LESS_EQUAL:
-            // For <=, we can use !(b < a)
-            fprintf(parser->output, "POPS LF@temp2\n");
-            fprintf(parser->output, "POPS LF@temp1\n");
-            fprintf(parser->output, "PUSHS LF@temp1\n");
-            fprintf(parser->output, "PUSHS LF@temp2\n");
-            fprintf(parser->output, "LTS\n");
-            fprintf(parser->output, "NOTS\n");
+            // a <= b is !(a > b)
+            emit(parser, "GTS\n");
+            result->kind = EXPR_BOOL;
+            result->negated = true;
             break;
         case TOKEN_GREATER_EQUAL:
-            // For >=, we can use !(a < b)
-            fprintf(parser->output, "LTS\n");
-            fprintf(parser->output, "NOTS\n");
+            // a >= b is !(a < b)
+            emit(parser, "LTS\n");
+            result->kind = EXPR_BOOL;
+            result->negated = true;
             break;
         default:
             error(parser, INTERNAL_ERROR, "Unknown relational operator");
-            free(temp);
             return;
     }
+}
+
+/**
+ * Make the expression fall through when true, false paths are added to false_list
+ */
+void generate_branch_false(Parser* parser, ExprResult* result) {
+    char* label = NULL;
+    
+    // Only a non-boolean constant needs to be evaluated at runtime
+    if (result->kind == EXPR_CONST && result->value.type != CONST_BOOL) {
+        push_constant(parser, result, parser->code.count);
+    }
     
-    free(temp);
+    switch (result->kind) {
+        case EXPR_CONST:
+            if (!result->value.value.boolean) {
+                label = generate_label(parser);
+                emit(parser, "JUMP %s\n", label);
+            }
+            break;
+        case EXPR_VALUE:
+        case EXPR_BOOL:
+            label = generate_label(parser);
+            emit(parser, "PUSHS bool@%s\n", result->negated ? "true" : "false");
+            emit(parser, "JUMPIFEQS %s\n", label);
+            break;
+        case EXPR_EQ_PAIR:
+            label = generate_label(parser);
+            emit(parser, "%s %s\n", result->negated ? "JUMPIFEQS" : "JUMPIFNEQS", label);
+            break;
+        case EXPR_COND_FALSE:
+            label = generate_label(parser);
+            emit(parser, "JUMP %s\n", label);
+            break;
+        case EXPR_COND_TRUE:
+            break;
+    }
+    
+    if (label) {
+        label_list_add(&result->false_list, label);
+    }
+    result->kind = EXPR_COND_TRUE;
+    result->negated = false;
 }
 
 /**
- * Generate is operation code
+ * Make the expression fall through when false, true paths are added to true_list
  */
-void generate_is_op(Parser* parser, TokenType type_token) {
-    char* temp = generate_temp_var(parser);
+void generate_branch_true(Parser* parser, ExprResult* result) {
+    char* label = NULL;
+    
+    // Only a non-boolean constant needs to be evaluated at runtime
+    if (result->kind == EXPR_CONST && result->value.type != CONST_BOOL) {
+        push_constant(parser, result, parser->code.count);
+    }
+    
+    switch (result->kind) {
+        case EXPR_CONST:
+            if (result->value.value.boolean) {
+                label = generate_label(parser);
+                emit(parser, "JUMP %s\n", label);
+            }
+            break;
+        case EXPR_VALUE:
+        case EXPR_BOOL:
+            label = generate_label(parser);
+            emit(parser, "PUSHS bool@%s\n", result->negated ? "false" : "true");
+            emit(parser, "JUMPIFEQS %s\n", label);
+            break;
+        case EXPR_EQ_PAIR:
+            label = generate_label(parser);
+            emit(parser, "%s %s\n", result->negated ? "JUMPIFNEQS" : "JUMPIFEQS", label);
+            break;
+        case EXPR_COND_TRUE:
+            label = generate_label(parser);
+            emit(parser, "JUMP %s\n", label);
+            break;
+        case EXPR_COND_FALSE:
+            break;
+    }
+    
+    if (label) {
+        label_list_add(&result->true_list, label);
+    }
+    result->kind = EXPR_COND_FALSE;
+    result->negated = false;
+}
+
+/**
+ * Place all labels of the list at the current position
+ */
+void generate_bind_labels(Parser* parser, LabelList* list) {
+    for (int i = 0; i < list->count; i++) {
+        emit(parser, "LABEL %s\n", list->items[i]);
+        free(list->items[i]);
+    }
+    list->count = 0;
+}
+
+/**
+ * Turn the expression into a single value on the stack
+ */
+void generate_materialize(Parser* parser, ExprResult* result) {
+    if (!has_jumps(result) && result->kind == EXPR_CONST) {
+        push_constant(parser, result, parser->code.count);
+        return;
+    }
+    
+    if (!has_jumps(result) && result->kind == EXPR_VALUE) {
+        return;
+    }
+    
+    // Plain comparison, just finish it on the stack
+    if (!has_jumps(result) && (result->kind == EXPR_BOOL || result->kind == EXPR_EQ_PAIR)) {
+        if (result->kind == EXPR_EQ_PAIR) {
+            emit(parser, "EQS\n");
+        }
+        if (result->negated) {
+            emit(parser, "NOTS\n");
+        }
+        result->kind = EXPR_VALUE;
+        result->negated = false;
+        return;
+    }
+    
+    // Control flow, push a boolean at the true and false targets
+    char* end_label = generate_label(parser);
     
-    // Get type of value on stack
-    fprintf(parser->output, "POPS LF@value\n");
-    fprintf(parser->output, "TYPE LF@type LF@value\n");
+    generate_branch_false(parser, result);
+    generate_bind_labels(parser, &result->true_list);
+    emit(parser, "PUSHS bool@true\n");
+    emit(parser, "JUMP %s\n", end_label);
+    generate_bind_labels(parser, &result->false_list);
+    emit(parser, "PUSHS bool@false\n");
+    emit(parser, "LABEL %s\n", end_label);
     
-    // Compare with expected type
+    free(end_label);
+    result->kind = EXPR_VALUE;
+    result->negated = false;
+}
+
+/**
+ * Generate is operation code
+ */
+void generate_is_op(Parser* parser, TokenType type_token) {
+    // Compare type of value on stack with the expected one, Num is int or float
     const char* expected_type = "";
     switch (type_token) {
         case TOKEN_NUM:
@@ -1129,15 +3337,21 @@ void generate_is_op(Parser* parser, TokenType type_token) {
             break;
         default:
             error(parser, SYNTAX_ERROR, "Invalid type in is expression");
-            free(temp);
             return;
     }
     
-    fprintf(parser->output, "PUSHS string@%s\n", expected_type);
-    fprintf(parser->output, "PUSHS LF@type\n");
-    fprintf(parser->output, "EQS\n");
-    
-    free(temp);
+    // Type goes to another register, CSE drops TYPE x x whose result it knows
+    emit(parser, "POPS GF@%%tmp0\n");
+    emit(parser, "TYPE GF@%%r0 GF@%%tmp0\n");
+    emit(parser, "PUSHS GF@%%r0\n");
+    emit(parser, "PUSHS string@%s\n", expected_type);
+    emit(parser, "EQS\n");
+    if (type_token == TOKEN_NUM) {
+        emit(parser, "PUSHS GF@%%r0\n");
+        emit(parser, "PUSHS string@int\n");
+        emit(parser, "EQS\n");
+        emit(parser, "ORS\n");
+    }
 }
 
 /**
@@ -1171,10 +3385,17 @@ void parse_getter(Parser* parser, const char* name) {
     }
     
     // Generate function prolog for getter
-    generate_function_prolog(parser, name, 0);
+    char* routine = accessor_name(name, false);
+    if (!routine) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        return;
+    }
+    int code_start = parser->code.count;
+    generate_function_prolog(parser, routine, 0);
     
     // Set current function context
-    parser->current_function = strdup(name);
+    parser->current_function = routine;
+    start_routine_names(parser, parser->current_token.line);
     parser->in_function = true;
     parser->function_param_count = 0;
     
@@ -1185,14 +3406,28 @@ void parse_getter(Parser* parser, const char* name) {
     parser->local_table = symtable_init();
     
     // Parse getter body
+    TokenBuffer body;
+    start_recording(parser, &body);
     parse_block(parser);
+    stop_recording(parser);
     
     // Generate function epilog
     generate_function_epilog(parser);
+    define_entry_variables(parser, code_start);
+    
+    // Above -O0 a trivial getter is never called, its uses read the global directly
+    getter_data->func->global = parser->level >= 1 ? trivial_accessor_global(&body, NULL) : NULL;
+    token_buffer_free(&body);
+    if (getter_data->func->global) {
+        ilist_truncate(&parser->code, code_start);
+    } else {
+        make_frameless(parser, code_start);
+    }
     
     // Clean up function context
     free(parser->current_function);
     parser->current_function = NULL;
+    parser->current_params = NULL;
     parser->in_function = false;
     parser->function_param_count = 0;
 }
@@ -1255,10 +3490,18 @@ void parse_setter(Parser* parser, const char* name) {
     }
     
     // Generate function prolog for setter
-    generate_function_prolog(parser, name, 1);
+    char* routine = accessor_name(name, true);
+    if (!routine) {
+        error(parser, INTERNAL_ERROR, "Memory allocation failed");
+        free(param_name);
+        return;
+    }
+    int code_start = parser->code.count;
+    generate_function_prolog(parser, routine, 1);
     
     // Set current function context
-    parser->current_function = strdup(name);
+    parser->current_function = routine;
+    start_routine_names(parser, parser->current_token.line);
     parser->in_function = true;
     parser->function_param_count = 1;
     
@@ -1269,20 +3512,33 @@ void parse_setter(Parser* parser, const char* name) {
     parser->local_table = symtable_init();
     
     // Add parameter to local table
-    SymbolData* param_data = symdata_create_var(IFJ_TYPE_NULL);
-    if (param_data) {
-        symtable_insert(parser->local_table, param_name, param_data);
-    }
+    param_list_append(&setter_data->func->params, param_name);
+    parser->current_params = setter_data->func->params;
+    declare_parameters(parser);
     
     // Parse setter body
+    TokenBuffer body;
+    start_recording(parser, &body);
     parse_block(parser);
+    stop_recording(parser);
     
     // Generate function epilog
     generate_function_epilog(parser);
+    define_entry_variables(parser, code_start);
+    
+    // Above -O0 a trivial setter is never called, its uses write the global directly
+    setter_data->func->global = parser->level >= 1 ? trivial_accessor_global(&body, param_name) : NULL;
+    token_buffer_free(&body);
+    if (setter_data->func->global) {
+        ilist_truncate(&parser->code, code_start);
+    } else {
+        make_frameless(parser, code_start);
+    }
     
     // Clean up function context
     free(parser->current_function);
     parser->current_function = NULL;
+    parser->current_params = NULL;
     parser->in_function = false;
     parser->function_param_count = 0;
     
@@ -1290,18 +3546,22 @@ void parse_setter(Parser* parser, const char* name) {
 }
 
 /**
- * Generate a unique label
+ * Generate a label unique within the current function, $name%L0 and so on
  */
 char* generate_label(Parser* parser) {
-    char* label = malloc(32);
-    if (label) {
-        snprintf(label, 32, "label_%d", parser->label_counter++);
+    const char* function = parser->current_function;
+    size_t size = (function ? strlen(function) : 0) + 32;
+    char* label = malloc(size);
+    if (label && function) {
+        snprintf(label, size, "$%s%%L%d", function, parser->label_counter++);
+    } else if (label) {
+        snprintf(label, size, "label_%d", parser->label_counter++);
     }
     return label;
 }
 
 /**
- * Generate a unique temporary variable
+ * Generate a temporary variable unique within the current function
  */
 char* generate_temp_var(Parser* parser) {
     char* temp = malloc(32);
@@ -15,6 +15,13 @@
 
 #include "scanner.h"
 #include "symtable.h"
+#include "ilist.h"
+#include "fold.h"
+#include "globals.h"
+#include "profile.h"
+#include "instrument.h"
+#include "eval.h"
+#include "passes.h"
 #include <stdio.h>
 #include <stdbool.h>
 
@@ -29,22 +36,116 @@
 #define SEMANTIC_OTHER 10
 #define INTERNAL_ERROR 99
 
+// Defaults of -funroll-factor and -funroll-budget
+#define UNROLL_FACTOR 4
+#define UNROLL_BUDGET 64
+
+// List of pending jump targets (labels emitted once their target is known)
+typedef struct {
+    char** items;
+    int count;
+    int capacity;
+} LabelList;
+
+// Copied tokens, used to parse a part of the source again
+typedef struct TokenBuffer {
+    Token* items;
+    int count;
+    int capacity;
+    struct TokenBuffer* outer;   // enclosing recording, receives the same tokens
+} TokenBuffer;
+
+// Copy of a function specialized for constant arguments
+typedef struct FunctionClone {
+    char* signature;              // key and constant of each parameter, - if passed
+    char* name;                   // routine name, name$ and hash of the signature
+    struct FunctionClone* next;
+} FunctionClone;
+
+// Body of a finished function, parsed again to make its clones
+typedef struct {
+    char* key;                    // name_arity
+    char* name;
+    Param* params;
+    TokenBuffer body;             // tokens from { to }
+    bool* assigned;               // parameters written in the body, never specialized
+    int start;                    // generic code in parser->code
+    int end;
+    int generic_calls;            // calls of the generic code after its definition
+    FunctionClone* clones;
+} FunctionSource;
+
+typedef struct {
+    FunctionSource* items;
+    int count;
+    int capacity;
+} SourceList;
+
+// Where the value of a parsed expression currently lives
+typedef enum {
+    EXPR_CONST,      // value known at compile time, nothing emitted yet
+    EXPR_VALUE,      // value on the data stack
+    EXPR_BOOL,       // boolean on the data stack (see negated)
+    EXPR_EQ_PAIR,    // both operands of == on the data stack (see negated)
+    EXPR_COND_TRUE,  // nothing on the stack, falling through means true
+    EXPR_COND_FALSE  // nothing on the stack, falling through means false
+} ExprKind;
+
+// Result of expression parsing; booleans are kept as jumps for as long as possible
+typedef struct {
+    ExprKind kind;
+    bool negated;
+    bool string;           // value on the stack is a string, or fails as one
+    bool always_string;    // value on the stack is a string, never nil
+    ConstValue value;      // for EXPR_CONST
+    LabelList true_list;   // labels jumped to when the expression is true
+    LabelList false_list;  // labels jumped to when the expression is false
+} ExprResult;
+
 // Parser state structure
 typedef struct {
     Scanner* scanner;
     Token current_token;
+    Token lookahead;             // one token of lookahead, see peek_token
+    bool has_lookahead;
+    TokenBuffer pending;         // tokens read again before the lookahead, last one is next
+    TokenBuffer* recording;      // innermost recording of consumed tokens or NULL
     SymTable* global_table;      // For global variables and functions
     SymTable* local_table;       // For local variables (current scope)
     FILE* output;                // For generated IFJcode25 code
+    InstrList code;              // Generated code, printed once parsing succeeds
     bool had_error;
     int error_code;
     
     // Code generation state
-    int label_counter;
-    int temp_var_counter;
+    int label_counter;           // labels of the current function, $name%L0 and so on
+    int temp_var_counter;        // temporaries of the current function
+    int function_line;           // line the current function starts at, stable labels count from it
     char* current_function;
+    Param* current_params;       // parameters of current function (LF@paramN)
     bool in_function;
     int function_param_count;
+    unsigned used_helpers;       // BuiltinHelper routines to generate
+    GlobalSet globals;           // globals referenced by the program, defined in prolog
+    bool straight_start;         // main has run only straight-line code without calls so far
+    bool returns_string;         // returns of the parsed function seen so far give strings
+    const Profile* profile;      // label counts from --profile-use or NULL
+    bool instrument;             // --instrument, count entries, iterations and branches
+    CounterList counters;        // counters of the instrumented build
+    bool frame_args;             // --frame-args, arguments in TF@paramN, result in GF@%retval
+    FunctionTable functions;     // code of the functions parsed so far
+    SourceList sources;          // bodies of the functions parsed so far
+    const ConstValue** specialized;  // constant of each parameter of the clone being parsed or NULL
+    InstrList clone_code;        // clones, appended to the code after parsing
+    int clone_budget;            // instructions the clones may still add
+    int cse_temps;               // temporaries keeping reused values, GF@%cseN, shared by routines
+    int level;                   // -O level, 0 emits the code as it is parsed
+    PassPipeline passes;         // optimization passes run on the emitted code
+    bool in_copy;                // parsing repeated copy of an unrolled loop body
+    bool unroll;                 // -funroll-loops, counted loops are unrolled
+    int unroll_factor;           // -funroll-factor, body copies of a loop unrolled by a factor
+    int unroll_budget;           // -funroll-budget, instructions the copies of a body may have
+    LabelList entry_vars;        // locals of the parsed function, defined at its entry
     
     // Stack for expression evaluation
     struct {
@@ -65,6 +166,7 @@ int parse_program(Parser* parser);
 
 // Token handling
 void next_token(Parser* parser);
+Token* peek_token(Parser* parser);
 bool accept(Parser* parser, TokenType type);
 bool expect(Parser* parser, TokenType type);
 void error(Parser* parser, int code, const char* message);
@@ -81,19 +183,23 @@ void parse_var_declaration(Parser* parser);
 void parse_assignment(Parser* parser);
 void parse_if_statement(Parser* parser);
 void parse_while_statement(Parser* parser);
+void parse_for_statement(Parser* parser);
 void parse_function_call_statement(Parser* parser);
 void parse_return(Parser* parser);
 
 // Expression parsing (precedence-based)
 void parse_expression(Parser* parser);
-void parse_simple_expression(Parser* parser);
-void parse_term(Parser* parser);
-void parse_factor(Parser* parser);
-void parse_relation(Parser* parser);
-void parse_is_expression(Parser* parser);
+void parse_condition(Parser* parser, ExprResult* result);
+void parse_or_expression(Parser* parser, ExprResult* result);
+void parse_and_expression(Parser* parser, ExprResult* result);
+void parse_simple_expression(Parser* parser, ExprResult* result);
+void parse_term(Parser* parser, ExprResult* result);
+void parse_factor(Parser* parser, ExprResult* result);
+void parse_relation(Parser* parser, ExprResult* result);
+void parse_is_expression(Parser* parser, ExprResult* result);
 
 // Function call parsing
-void parse_function_call(Parser* parser, const char* func_name);
+void parse_function_call(Parser* parser, const char* func_name, ExprResult* result);
 int parse_argument_list(Parser* parser);
 
 // Getters and setters
@@ -107,6 +213,7 @@ bool check_type_compatibility(ifj25_type_t t1, ifj25_type_t t2, TokenType op);
 ifj25_type_t get_expression_type(Parser* parser);
 
 // Code generation
+void emit(Parser* parser, const char* format, ...);
 void generate_prolog(Parser* parser);
 void generate_epilog(Parser* parser);
 void generate_function_prolog(Parser* parser, const char* name, int param_count);
@@ -115,22 +222,24 @@ void generate_var_declaration(Parser* parser, const char* name, bool is_global);
 void generate_assignment(Parser* parser, const char* name, bool is_global);
 void generate_if(Parser* parser, const char* else_label, const char* end_label);
 void generate_while(Parser* parser, const char* start_label, const char* end_label);
-void generate_function_call(Parser* parser, const char* func_name, int arg_count, bool is_builtin);
+void generate_function_call(Parser* parser, const char* func_name, int arg_count, bool is_builtin, bool use_result);
 void generate_return(Parser* parser);
 void generate_expression_start(Parser* parser);
 void generate_expression_end(Parser* parser);
 void generate_binary_op(Parser* parser, TokenType op);
-void generate_relational_op(Parser* parser, TokenType op);
+void generate_relational_op(Parser* parser, TokenType op, ExprResult* result);
 void generate_is_op(Parser* parser, TokenType type_token);
+void generate_branch_false(Parser* parser, ExprResult* result);
+void generate_branch_true(Parser* parser, ExprResult* result);
+void generate_bind_labels(Parser* parser, LabelList* list);
+void generate_materialize(Parser* parser, ExprResult* result);
 
 // Helper functions
 char* generate_label(Parser* parser);
 char* generate_temp_var(Parser* parser);
 void push_expr_stack(Parser* parser, const char* item);
 char* pop_expr_stack(Parser* parser);
-
-// Built-in function handling
-bool is_builtin_function(const char* name);
-int get_builtin_arity(const char* name);
+void expr_result_init(ExprResult* result);
+void expr_result_free(ExprResult* result);
 
 #endif // PARSER_H
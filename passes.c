@@ -0,0 +1,278 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * passes.c
+ * optimization passes over the generated code and their pipelines
+ *
+ * The parser emits code directly, every pass then rewrites the whole
+ * program. Passes run in the order of the pipeline; the ones working on the
+ * whole program run after the prolog is generated, because the prolog
+ * depends on what the others leave (globals still referenced, temporaries).
+ *
+ * Function passes are superlinear in the size of a function, so one huge
+ * function could take most of the compile time. A function larger than the
+ * size budget gets the reduced form of the remaining passes: block-local CSE,
+ * no SSA and no coalescing. The program stays correct, only less optimized.
+ * With -fpass-time-budget so does a function a pass spent more than that
+ * many milliseconds on. It is off by default, the output would depend on
+ * the speed of the machine.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#define _POSIX_C_SOURCE 199309L
+#include "passes.h"
+#include "ssa.h"
+#include "cse.h"
+#include "liveness.h"
+#include "layout.h"
+#include "icf.h"
+#include "cfg.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static bool run_globals(PassContext* context) {
+    return globals_propagate(context->globals, context->code);
+}
+
+static bool run_ssa(PassContext* context, int first, int last, bool reduced) {
+    return reduced || ssa_routine(context->code, first, last);
+}
+
+static bool run_cse(PassContext* context, int first, int last, bool reduced) {
+    return cse_routine(context->code, first, last, context->cse_temps, reduced);
+}
+
+static bool run_liveness(PassContext* context, int first, int last, bool reduced) {
+    return reduced || liveness_routine(context->code, first, last, NULL);
+}
+
+static bool run_icf(PassContext* context) {
+    return icf_program(context->code, NULL);
+}
+
+static bool run_layout(PassContext* context) {
+    return layout_program(context->code, context->profile);
+}
+
+// All passes in the order of the default pipeline
+static const PassInfo registry[] = {
+    {"globals", "replace write-once globals by their constant", 1, false, run_globals, NULL},
+    {"ssa", "propagate copies and constants of frame variables", 2, false, NULL, run_ssa},
+    {"cse", "read values computed before instead of computing them again", 1, false, NULL, run_cse},
+    {"liveness", "share frame slots of variables, drop unread ones", 2, false, NULL, run_liveness},
+    {"icf", "fold functions with identical code into one", 1, true, run_icf, NULL},
+    {"layout", "order routines by calls, move cold blocks out of line", 1, true, run_layout, NULL},
+};
+
+#define PASS_COUNT (int)(sizeof(registry) / sizeof(registry[0]))
+
+/**
+ * Finds a pass by name
+ * @param name name of the pass
+ * @return pass or NULL if there is none of that name
+ */
+const PassInfo* pass_find(const char* name) {
+    for (int i = 0; i < PASS_COUNT; i++) {
+        if (strcmp(registry[i].name, name) == 0) return &registry[i];
+    }
+    return NULL;
+}
+
+/**
+ * Sets pipeline to the passes of an optimization level
+ * @param pipeline pipeline, its time flag is kept
+ * @param level 0 to OPT_LEVEL_MAX
+ */
+void pipeline_level(PassPipeline* pipeline, int level) {
+    pipeline->count = 0;
+    for (int i = 0; i < PASS_COUNT; i++) {
+        if (registry[i].level <= level) {
+            pipeline->items[pipeline->count++] = &registry[i];
+        }
+    }
+}
+
+/**
+ * Sets pipeline to a list of passes
+ * @param pipeline pipeline, its time flag is kept
+ * @param list names separated by commas, may be empty
+ * @return true if all names are known and fit
+ */
+bool pipeline_parse(PassPipeline* pipeline, const char* list) {
+    pipeline->count = 0;
+    while (*list) {
+        size_t len = strcspn(list, ",");
+        char name[32];
+        const PassInfo* pass = NULL;
+        if (len > 0 && len < sizeof(name)) {
+            memcpy(name, list, len);
+            name[len] = '\0';
+            pass = pass_find(name);
+        }
+        if (!pass || pipeline->count == PIPELINE_MAX) return false;
+        pipeline->items[pipeline->count++] = pass;
+        
+        list += len;
+        if (*list == ',') list++;
+    }
+    return true;
+}
+
+/**
+ * Removes a pass from the pipeline
+ * @param pipeline pipeline
+ * @param name name of the pass
+ * @return false if there is no pass of that name
+ */
+bool pipeline_disable(PassPipeline* pipeline, const char* name) {
+    const PassInfo* pass = pass_find(name);
+    if (!pass) return false;
+    
+    int count = 0;
+    for (int i = 0; i < pipeline->count; i++) {
+        if (pipeline->items[i] != pass) {
+            pipeline->items[count++] = pipeline->items[i];
+        }
+    }
+    pipeline->count = count;
+    return true;
+}
+
+/**
+ * Checks if the pipeline runs a pass
+ * @param pipeline pipeline
+ * @param name name of the pass
+ * @return true if the pass is in the pipeline
+ */
+bool pipeline_has(const PassPipeline* pipeline, const char* name) {
+    for (int i = 0; i < pipeline->count; i++) {
+        if (strcmp(pipeline->items[i]->name, name) == 0) return true;
+    }
+    return false;
+}
+
+// Wall clock in milliseconds
+static double now_ms(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+// Function over its budget, reduced passes run on it from then on
+typedef struct {
+    bool over;
+    bool reduced;        // some pass ran its reduced form on it
+    int size;            // instructions it had, 0 if it ran out of time
+    const char* pass;    // pass that took too long
+    double ms;
+} Budget;
+
+// Next routine label from index on, count of the code if there is none
+static int next_routine(const InstrList* code, int index) {
+    while (index < code->count && !cfg_is_routine_label(&code->items[index])) {
+        index++;
+    }
+    return index;
+}
+
+/**
+ * Runs a function pass on every routine, code before the first one has no frame
+ * @param pipeline pipeline with the budgets
+ * @param pass function pass
+ * @param context program and the state the passes share
+ * @param budgets state of every routine, in order of the code
+ * @return true on success
+ */
+static bool run_functions(const PassPipeline* pipeline, const PassInfo* pass, PassContext* context,
+                          Budget* budgets) {
+    InstrList* code = context->code;
+    int routine = 0;
+    for (int first = next_routine(code, 0); first < code->count; routine++) {
+        int last = next_routine(code, first + 1);
+        Budget* budget = &budgets[routine];
+        if (!budget->over && last - first > pipeline->size_budget) {
+            *budget = (Budget){true, false, last - first, NULL, 0.0};
+        }
+        
+        // The pass changes the length of this routine only
+        int before = code->count;
+        double start = now_ms();
+        if (!pass->run_function(context, first, last, budget->over)) return false;
+        double ms = now_ms() - start;
+        budget->reduced = budget->reduced || budget->over;
+        if (!budget->over && pipeline->time_budget > 0 && ms > pipeline->time_budget) {
+            *budget = (Budget){true, false, 0, pass->name, ms};
+        }
+        first = last + code->count - before;
+    }
+    return true;
+}
+
+// Lists functions that got reduced passes on stderr
+static void report_budgets(const PassPipeline* pipeline, const InstrList* code, const Budget* budgets) {
+    int routine = 0;
+    for (int first = next_routine(code, 0); first < code->count; first = next_routine(code, first + 1)) {
+        const Budget* budget = &budgets[routine++];
+        if (!budget->reduced) continue;
+        
+        const char* name = code->items[first].args[0] + 1;
+        if (budget->pass) {
+            fprintf(stderr, "budget: %s got reduced passes after %s took %.3f ms (budget %d ms)\n",
+                    name, budget->pass, budget->ms, pipeline->time_budget);
+        } else {
+            fprintf(stderr, "budget: %s got reduced passes, %d instructions (budget %d)\n",
+                    name, budget->size, pipeline->size_budget);
+        }
+    }
+}
+
+/**
+ * Runs passes of one stage of the pipeline
+ * @param pipeline pipeline
+ * @param context program and the state the passes share
+ * @param whole_program true for the passes run once the prolog is in the code
+ * @return true on success, code must not be printed on failure
+ */
+bool pipeline_run(const PassPipeline* pipeline, PassContext* context, bool whole_program) {
+    // Function passes do not add or remove routines, so they keep their order
+    int routines = 0;
+    for (int i = 0; i < context->code->count; i++) {
+        if (cfg_is_routine_label(&context->code->items[i])) routines++;
+    }
+    Budget* budgets = calloc(routines + 1, sizeof(Budget));
+    if (!budgets) return false;
+    
+    bool ok = true;
+    for (int i = 0; i < pipeline->count && ok; i++) {
+        const PassInfo* pass = pipeline->items[i];
+        if (pass->whole_program != whole_program) continue;
+        
+        int before = context->code->count;
+        double start = pipeline->time ? now_ms() : 0.0;
+        ok = pass->run_function ? run_functions(pipeline, pass, context, budgets) : pass->run(context);
+        if (ok && pipeline->time) {
+            int after = context->code->count;
+            fprintf(stderr, "pass %-10s %10.3f ms %8d -> %8d instructions (%+d)\n",
+                    pass->name, now_ms() - start, before, after, after - before);
+        }
+    }
+    if (ok) {
+        report_budgets(pipeline, context->code, budgets);
+    }
+    free(budgets);
+    return ok;
+}
+
+/**
+ * Prints the registry, one pass per line
+ * @param output stream
+ */
+void passes_print(FILE* output) {
+    for (int i = 0; i < PASS_COUNT; i++) {
+        fprintf(output, "  %-10s -O%d  %s\n", registry[i].name, registry[i].level, registry[i].description);
+    }
+}
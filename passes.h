@@ -0,0 +1,86 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * passes.h
+ * optimization passes over the generated code and their pipelines
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef PASSES_H
+#define PASSES_H
+
+#include "ilist.h"
+#include "globals.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+// Level of -O when none is given
+#define OPT_LEVEL_DEFAULT 2
+#define OPT_LEVEL_MAX 2
+
+// Passes one pipeline may run, a pass may be listed more times
+#define PIPELINE_MAX 16
+
+// Budget of one function in instructions and in milliseconds of one pass,
+// time budget 0 is no limit, so the output does not depend on the machine
+#define PASS_SIZE_BUDGET 10000
+#define PASS_TIME_BUDGET 0
+
+// What the passes work on
+typedef struct {
+    InstrList* code;             // program, with the prolog for passes marked so
+    GlobalSet* globals;          // globals referenced by the program
+    int* cse_temps;              // temporaries defined by the prolog, GF@%cseN
+    const Profile* profile;      // label counts from --profile-use or NULL
+} PassContext;
+
+// Named pass of the registry, it works either on the program or on every
+// function in turn. A function over its budget gets the reduced form of the
+// function passes, which runs in linear time or does nothing.
+typedef struct {
+    const char* name;
+    const char* description;
+    int level;                   // lowest -O level running it
+    bool whole_program;          // runs once the prolog is in the code
+    bool (*run)(PassContext* context);
+    bool (*run_function)(PassContext* context, int first, int last, bool reduced);
+} PassInfo;
+
+// Passes to run, in order
+typedef struct {
+    const PassInfo* items[PIPELINE_MAX];
+    int count;
+    bool time;                   // --time-passes, report of every pass on stderr
+    int size_budget;             // instructions of a function the full passes get
+    int time_budget;             // milliseconds a full pass may spend on a function, 0 for no limit
+} PassPipeline;
+
+// Pass of the given name or NULL
+const PassInfo* pass_find(const char* name);
+
+// Pipeline of an -O level, -O0 runs no pass and prints what the parser emitted
+void pipeline_level(PassPipeline* pipeline, int level);
+
+// Pipeline of --passes, names separated by commas. False for an unknown
+// name or too many passes.
+bool pipeline_parse(PassPipeline* pipeline, const char* list);
+
+// Removes every run of the pass, false for an unknown name
+bool pipeline_disable(PassPipeline* pipeline, const char* name);
+
+// Checks if the pipeline runs the pass of the name
+bool pipeline_has(const PassPipeline* pipeline, const char* name);
+
+// Runs passes working on the program without (whole_program false) or with
+// the prolog, false on allocation failure. Functions over a budget run the
+// cheaper pipeline of reduced passes from then on, they are listed on stderr.
+bool pipeline_run(const PassPipeline* pipeline, PassContext* context, bool whole_program);
+
+// Prints names and descriptions of all passes
+void passes_print(FILE* output);
+
+#endif // PASSES_H
@@ -0,0 +1,147 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * profile.c
+ * execution counts of labels from a previous run of the program
+ *
+ * Counts are matched by label name. Only labels starting with $ are stable
+ * between builds ($name for functions, $name%kind<line>_<column> for loops
+ * and branches), other labels are numbered and change with the code.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "profile.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_INITIAL_CAPACITY 64
+#define PROFILE_MAX_LINE 512
+
+// FNV-1a hash of the label
+static uint32_t hash_label(const char* label) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)label; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Finds slot of the label, or the empty slot where it belongs
+static int find_slot(const Profile* profile, const char* label) {
+    int slot = (int)(hash_label(label) & (uint32_t)(profile->capacity - 1));
+    while (profile->entries[slot].label && strcmp(profile->entries[slot].label, label) != 0) {
+        slot = (slot + 1) & (profile->capacity - 1);
+    }
+    return slot;
+}
+
+// Doubles capacity of the map
+static bool profile_grow(Profile* profile) {
+    int capacity = profile->capacity ? profile->capacity * 2 : PROFILE_INITIAL_CAPACITY;
+    Profile grown = {calloc(capacity, sizeof(ProfileEntry)), profile->count, capacity};
+    if (!grown.entries) return false;
+    
+    for (int i = 0; i < profile->capacity; i++) {
+        if (profile->entries[i].label) {
+            grown.entries[find_slot(&grown, profile->entries[i].label)] = profile->entries[i];
+        }
+    }
+    
+    free(profile->entries);
+    *profile = grown;
+    return true;
+}
+
+// Adds count to the label
+static bool profile_add(Profile* profile, const char* label, long count) {
+    if (profile->count * 2 >= profile->capacity && !profile_grow(profile)) {
+        return false;
+    }
+    
+    ProfileEntry* entry = &profile->entries[find_slot(profile, label)];
+    if (!entry->label) {
+        entry->label = malloc(strlen(label) + 1);
+        if (!entry->label) return false;
+        strcpy(entry->label, label);
+        entry->count = 0;
+        profile->count++;
+    }
+    entry->count += count;
+    return true;
+}
+
+/**
+ * Loads profile written by the interpreter
+ * @param profile empty profile
+ * @param path file with "label count" lines, repeated labels are summed
+ * @return true on success
+ */
+bool profile_load(Profile* profile, const char* path) {
+    profile->entries = NULL;
+    profile->count = 0;
+    profile->capacity = 0;
+    
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    
+    char line[PROFILE_MAX_LINE];
+    char label[PROFILE_MAX_LINE];
+    long count;
+    bool ok = true;
+    
+    while (ok && fgets(line, sizeof(line), file)) {
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        
+        // Anything else than a label and a count is ignored
+        if (sscanf(line, "%511s %ld", label, &count) == 2 && count >= 0) {
+            ok = profile_add(profile, label, count);
+        }
+    }
+    
+    fclose(file);
+    if (!ok) {
+        profile_free(profile);
+    }
+    return ok;
+}
+
+/**
+ * Frees the profile
+ * @param profile profile
+ */
+void profile_free(Profile* profile) {
+    for (int i = 0; i < profile->capacity; i++) {
+        free(profile->entries[i].label);
+    }
+    free(profile->entries);
+    profile->entries = NULL;
+    profile->count = 0;
+    profile->capacity = 0;
+}
+
+/**
+ * Gets execution count of a label
+ * @param profile profile or NULL
+ * @param label label name
+ * @param count filled with the count
+ * @return true if the label is in the profile
+ */
+bool profile_count(const Profile* profile, const char* label, long* count) {
+    if (!profile || profile->capacity == 0) {
+        return false;
+    }
+    
+    const ProfileEntry* entry = &profile->entries[find_slot(profile, label)];
+    if (!entry->label) {
+        return false;
+    }
+    *count = entry->count;
+    return true;
+}
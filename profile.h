@@ -0,0 +1,39 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * profile.h
+ * execution counts of labels from a previous run of the program
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+
+// Label with its execution count
+typedef struct ProfileEntry {
+    char* label;
+    long count;
+} ProfileEntry;
+
+// Hash map from label to execution count (open addressing)
+typedef struct Profile {
+    ProfileEntry* entries;
+    int count;
+    int capacity;           // power of two
+} Profile;
+
+// Load profile, one "label count" pair per line, # starts a comment
+bool profile_load(Profile* profile, const char* path);
+
+// Free all entries
+void profile_free(Profile* profile);
+
+// Execution count of a label, false when the profile does not know it
+bool profile_count(const Profile* profile, const char* label, long* count);
+
+#endif // PROFILE_H
@@ -308,8 +308,8 @@ Token read_number(Scanner* scanner) {
             advance(scanner);
         }
         
-        // Check for decimal point
-        if (scanner->current_char == '.') {
+        // Check for decimal point, 1..n is a range
+        if (scanner->current_char == '.' && peek(scanner) != '.') {
             
             if (pos < 255) {
                 buffer[pos++] = scanner->current_char;
@@ -0,0 +1,722 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * ssa.c
+ * static single assignment form of frame variables
+ *
+ * Variables of the frame of a routine get a new version at every write and
+ * phis where versions meet (minimal form, phis are placed on the iterated
+ * dominance frontiers of the writes). Values stay on the data stack, only
+ * named variables are versioned. Versions, phis and their arguments live in
+ * arrays of the form and refer to each other by index.
+ *
+ * The propagation pass finds versions that are copies of another version or
+ * hold a constant, also through phis whose arguments all agree, and reads
+ * the constant or the other variable instead. A variable is only read where
+ * its version is the current one, so the form stays conventional and lowers
+ * back without any copies; copies nobody reads any more are removed.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "ssa.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Routines with more variables are left alone
+#define MAX_VARIABLES 2048
+
+// Longer constants are not copied to every read of their variable
+#define MAX_CONSTANT_LENGTH 64
+
+// Instructions with a first operand they do not write, SETCHAR changes it only partly
+static const char* const reading_ops[] = {
+    "PUSHS", "WRITE", "EXIT", "DPRINT", "LABEL", "CALL", "SETCHAR",
+    "JUMP", "JUMPIFEQ", "JUMPIFNEQ", "JUMPIFEQS", "JUMPIFNEQS", NULL
+};
+
+static const char* const constant_prefixes[] = {"int@", "float@", "string@", "bool@", "nil@", NULL};
+
+// Checks if op is in the NULL terminated list
+static bool op_in(const char* op, const char* const* list) {
+    for (int i = 0; list[i]; i++) {
+        if (strcmp(op, list[i]) == 0) return true;
+    }
+    return false;
+}
+
+static bool is_constant(const char* operand) {
+    for (int i = 0; constant_prefixes[i]; i++) {
+        if (strncmp(operand, constant_prefixes[i], strlen(constant_prefixes[i])) == 0) return true;
+    }
+    return false;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Index of the variable, -1 for other operands
+static int find_variable(const Ssa* ssa, const char* operand) {
+    if (strncmp(operand, ssa->prefix, 3) != 0 || ssa->var_count == 0) return -1;
+    char* const* found = bsearch(&operand, ssa->names, ssa->var_count, sizeof(char*), compare_names);
+    return found ? (int)(found - ssa->names) : -1;
+}
+
+// Variables are the ones the routine defines itself, sorted by name
+static bool collect_variables(Ssa* ssa) {
+    const InstrList* code = ssa->cfg.code;
+    int count = 0;
+    for (int i = ssa->cfg.first; i < ssa->cfg.last; i++) {
+        const Instr* instr = &code->items[i];
+        if (instr_is(instr, "DEFVAR") && strncmp(instr->args[0], ssa->prefix, 3) == 0) count++;
+    }
+    ssa->names = malloc((count > 0 ? count : 1) * sizeof(char*));
+    if (!ssa->names) return false;
+    
+    for (int i = ssa->cfg.first; i < ssa->cfg.last; i++) {
+        const Instr* instr = &code->items[i];
+        if (!instr_is(instr, "DEFVAR") || strncmp(instr->args[0], ssa->prefix, 3) != 0) continue;
+        ssa->names[ssa->var_count] = malloc(strlen(instr->args[0]) + 1);
+        if (!ssa->names[ssa->var_count]) return false;
+        strcpy(ssa->names[ssa->var_count++], instr->args[0]);
+    }
+    qsort(ssa->names, ssa->var_count, sizeof(char*), compare_names);
+    
+    // A variable defined again in a loop appears more times
+    int unique = 0;
+    for (int i = 0; i < ssa->var_count; i++) {
+        if (unique > 0 && strcmp(ssa->names[unique - 1], ssa->names[i]) == 0) {
+            free(ssa->names[i]);
+        } else {
+            ssa->names[unique++] = ssa->names[i];
+        }
+    }
+    ssa->var_count = unique;
+    return true;
+}
+
+/**
+ * Finds variables read and written by every instruction
+ * @param ssa form with variables
+ * @param def_vars filled with the variable written by each instruction or -1
+ * @param use_vars filled with the variable read by each operand or -1
+ */
+static void classify_instructions(Ssa* ssa, int* def_vars, int* use_vars) {
+    const InstrList* code = ssa->cfg.code;
+    for (int i = ssa->cfg.first; i < ssa->cfg.last; i++) {
+        const Instr* instr = &code->items[i];
+        int index = i - ssa->cfg.first;
+        bool writes = instr->argc > 0 && !op_in(instr->op, reading_ops);
+        def_vars[index] = writes ? find_variable(ssa, instr->args[0]) : -1;
+        for (int j = 0; j < INSTR_MAX_ARGS; j++) {
+            bool reads = j < instr->argc && (j > 0 || !writes);
+            use_vars[index * INSTR_MAX_ARGS + j] = reads ? find_variable(ssa, instr->args[j]) : -1;
+        }
+        if (instr_is(instr, "SETCHAR") && use_vars[index * INSTR_MAX_ARGS] >= 0) {
+            ssa->pinned[use_vars[index * INSTR_MAX_ARGS]] = true;
+        }
+    }
+    
+    // Pinned variables keep their names everywhere
+    int count = (ssa->cfg.last - ssa->cfg.first) * INSTR_MAX_ARGS;
+    for (int i = 0; i < count; i++) {
+        if (use_vars[i] >= 0 && ssa->pinned[use_vars[i]]) use_vars[i] = -1;
+        if (i % INSTR_MAX_ARGS == 0 && def_vars[i / INSTR_MAX_ARGS] >= 0 &&
+            ssa->pinned[def_vars[i / INSTR_MAX_ARGS]]) {
+            def_vars[i / INSTR_MAX_ARGS] = -1;
+        }
+    }
+}
+
+// Adds version of the variable, -1 on allocation failure
+static int add_version(Ssa* ssa, int var, int def, int block) {
+    if (ssa->version_count == ssa->version_capacity) {
+        int capacity = ssa->version_capacity ? ssa->version_capacity * 2 : 64;
+        SsaVersion* versions = realloc(ssa->versions, capacity * sizeof(SsaVersion));
+        if (!versions) return -1;
+        ssa->versions = versions;
+        ssa->version_capacity = capacity;
+    }
+    ssa->versions[ssa->version_count] = (SsaVersion){var, def, block, -1, NULL, -1};
+    return ssa->version_count++;
+}
+
+/**
+ * Finds dominance frontiers of reachable blocks (Cooper, Harvey, Kennedy)
+ * @param cfg graph
+ * @param first filled with the first frontier block of each block
+ * @param count filled with the number of frontier blocks of each block
+ * @return frontier blocks of all blocks, NULL on allocation failure
+ */
+static int* find_frontiers(const Cfg* cfg, int* first, int* count) {
+    // Upper bound first, a block is reached from more of its predecessors
+    int total = 0;
+    memset(count, 0, cfg->block_count * sizeof(int));
+    for (int b = 0; b < cfg->block_count; b++) {
+        const CfgBlock* block = &cfg->blocks[b];
+        if (block->order < 0 || block->pred_count < 2) continue;
+        for (int j = 0; j < block->pred_count; j++) {
+            int runner = cfg->preds[block->preds + j];
+            if (cfg->blocks[runner].order < 0) continue;
+            while (runner >= 0 && runner != block->idom) {
+                count[runner]++;
+                total++;
+                runner = cfg->blocks[runner].idom;
+            }
+        }
+    }
+    int* frontiers = malloc((total > 0 ? total : 1) * sizeof(int));
+    if (!frontiers) return NULL;
+    
+    int next = 0;
+    for (int b = 0; b < cfg->block_count; b++) {
+        first[b] = next;
+        next += count[b];
+        count[b] = 0;
+    }
+    for (int b = 0; b < cfg->block_count; b++) {
+        const CfgBlock* block = &cfg->blocks[b];
+        if (block->order < 0 || block->pred_count < 2) continue;
+        for (int j = 0; j < block->pred_count; j++) {
+            int runner = cfg->preds[block->preds + j];
+            if (cfg->blocks[runner].order < 0) continue;
+            while (runner >= 0 && runner != block->idom) {
+                // Frontiers of one block are added together, a repeated one is the last
+                int* list = &frontiers[first[runner]];
+                if (count[runner] == 0 || list[count[runner] - 1] != b) {
+                    list[count[runner]++] = b;
+                }
+                runner = cfg->blocks[runner].idom;
+            }
+        }
+    }
+    return frontiers;
+}
+
+/**
+ * Places phis on the iterated dominance frontiers of the writes of every variable
+ * @param ssa form with the graph and variables
+ * @param def_vars variable written by each instruction or -1
+ * @return true on success, false on allocation failure
+ */
+static bool place_phis(Ssa* ssa, const int* def_vars) {
+    const Cfg* cfg = &ssa->cfg;
+    int n = cfg->block_count;
+    int* first = malloc(n * sizeof(int));
+    int* count = malloc(n * sizeof(int));
+    int* marks = malloc(2 * n * sizeof(int));
+    int* work = malloc(n * sizeof(int));
+    int* frontiers = first && count ? find_frontiers(cfg, first, count) : NULL;
+    
+    // Writes of every variable as lists of blocks
+    int writes = 0;
+    for (int i = 0; i < cfg->last - cfg->first; i++) {
+        if (def_vars[i] >= 0) writes++;
+    }
+    int* write_first = calloc(ssa->var_count + 1, sizeof(int));
+    int* write_blocks = malloc((writes > 0 ? writes : 1) * sizeof(int));
+    bool ok = frontiers && marks && work && write_first && write_blocks;
+    for (int i = 0; ok && i < cfg->last - cfg->first; i++) {
+        if (def_vars[i] >= 0) write_first[def_vars[i] + 1]++;
+    }
+    for (int v = 0; ok && v < ssa->var_count; v++) {
+        write_first[v + 1] += write_first[v];
+    }
+    for (int i = 0, b = 0; ok && i < cfg->last - cfg->first; i++) {
+        while (b + 1 < n && cfg->blocks[b + 1].start <= cfg->first + i) b++;
+        if (def_vars[i] >= 0) write_blocks[write_first[def_vars[i]]++] = b;
+    }
+    for (int v = ssa->var_count; ok && v > 0; v--) {
+        write_first[v] = write_first[v - 1];
+    }
+    if (ok) write_first[0] = 0;
+    
+    // Phis as pairs of block and variable first, marks hold the last variable a block was done for
+    int pair_count = 0;
+    int pair_capacity = 0;
+    int* pairs = NULL;
+    if (ok) memset(marks, -1, 2 * n * sizeof(int));
+    for (int v = 0; ok && v < ssa->var_count; v++) {
+        int* has_phi = marks;
+        int* queued = marks + n;
+        int top = 0;
+        for (int k = write_first[v]; k < write_first[v + 1]; k++) {
+            int b = write_blocks[k];
+            if (cfg->blocks[b].order >= 0 && queued[b] != v) {
+                queued[b] = v;
+                work[top++] = b;
+            }
+        }
+        while (ok && top > 0) {
+            int b = work[--top];
+            for (int k = first[b]; k < first[b] + count[b]; k++) {
+                int frontier = frontiers[k];
+                if (has_phi[frontier] == v) continue;
+                has_phi[frontier] = v;
+                if (pair_count == pair_capacity) {
+                    pair_capacity = pair_capacity ? pair_capacity * 2 : 64;
+                    int* grown = realloc(pairs, pair_capacity * 2 * sizeof(int));
+                    if (!grown) {
+                        ok = false;
+                        break;
+                    }
+                    pairs = grown;
+                }
+                pairs[pair_count * 2] = frontier;
+                pairs[pair_count * 2 + 1] = v;
+                pair_count++;
+                if (queued[frontier] != v) {
+                    queued[frontier] = v;
+                    work[top++] = frontier;
+                }
+            }
+        }
+    }
+    
+    // Phis of a block together, arguments one per predecessor
+    ssa->block_phis = calloc(n + 1, sizeof(int));
+    ssa->phis = malloc((pair_count > 0 ? pair_count : 1) * sizeof(SsaPhi));
+    ok = ok && ssa->block_phis && ssa->phis;
+    for (int k = 0; ok && k < pair_count; k++) {
+        ssa->block_phis[pairs[k * 2] + 1]++;
+    }
+    for (int b = 0; ok && b < n; b++) {
+        ssa->block_phis[b + 1] += ssa->block_phis[b];
+        count[b] = ssa->block_phis[b];
+    }
+    int args = 0;
+    for (int k = 0; ok && k < pair_count; k++) {
+        int b = pairs[k * 2];
+        SsaPhi* phi = &ssa->phis[count[b]++];
+        phi->var = pairs[k * 2 + 1];
+        phi->dest = -1;
+        phi->args = args;
+        args += cfg->blocks[b].pred_count;
+    }
+    ssa->phi_count = ok ? pair_count : 0;
+    ssa->phi_args = ok ? malloc((args > 0 ? args : 1) * sizeof(int)) : NULL;
+    ok = ok && ssa->phi_args;
+    for (int k = 0; ok && k < args; k++) {
+        ssa->phi_args[k] = -1;
+    }
+    
+    free(first);
+    free(count);
+    free(marks);
+    free(work);
+    free(frontiers);
+    free(write_first);
+    free(write_blocks);
+    free(pairs);
+    return ok;
+}
+
+/**
+ * Gives versions to the writes, phis and reads in a walk of the dominator
+ * tree, current holds the current version of each variable
+ * @param ssa form with phis
+ * @param def_vars variable written by each instruction or -1
+ * @param use_vars variable read by each operand or -1
+ * @param current current versions, the entry versions at the start
+ * @return true on success, false on allocation failure
+ */
+static bool rename_versions(Ssa* ssa, const int* def_vars, const int* use_vars, int* current) {
+    const Cfg* cfg = &ssa->cfg;
+    int* stack = malloc((2 * cfg->reachable + 1) * sizeof(int));
+    if (!stack) return false;
+    
+    // Entered blocks are pushed again as ~block to restore the versions on the way back
+    int top = 0;
+    if (cfg->reachable > 0) stack[top++] = 0;
+    while (top > 0) {
+        int b = stack[--top];
+        if (b < 0) {
+            b = ~b;
+            for (int i = cfg->blocks[b].end - 1; i >= cfg->blocks[b].start; i--) {
+                int version = ssa->defs[i - cfg->first];
+                if (version >= 0) current[ssa->versions[version].var] = ssa->versions[version].prev;
+            }
+            for (int p = ssa->block_phis[b + 1] - 1; p >= ssa->block_phis[b]; p--) {
+                const SsaVersion* version = &ssa->versions[ssa->phis[p].dest];
+                current[version->var] = version->prev;
+            }
+            continue;
+        }
+        
+        const CfgBlock* block = &cfg->blocks[b];
+        for (int p = ssa->block_phis[b]; p < ssa->block_phis[b + 1]; p++) {
+            SsaPhi* phi = &ssa->phis[p];
+            int version = add_version(ssa, phi->var, -1, b);
+            if (version < 0) {
+                free(stack);
+                return false;
+            }
+            phi->dest = version;
+            ssa->versions[version].prev = current[phi->var];
+            current[phi->var] = version;
+        }
+        for (int i = block->start; i < block->end; i++) {
+            int index = i - cfg->first;
+            for (int j = 0; j < INSTR_MAX_ARGS; j++) {
+                int var = use_vars[index * INSTR_MAX_ARGS + j];
+                ssa->uses[index * INSTR_MAX_ARGS + j] = var >= 0 ? current[var] : -1;
+            }
+            if (def_vars[index] < 0) continue;
+            int version = add_version(ssa, def_vars[index], i, b);
+            if (version < 0) {
+                free(stack);
+                return false;
+            }
+            ssa->defs[index] = version;
+            ssa->versions[version].prev = current[def_vars[index]];
+            current[def_vars[index]] = version;
+        }
+        
+        // Arguments of the phis of successors come from the end of the block
+        for (int s = 0; s < block->succ_count; s++) {
+            const CfgBlock* succ = &cfg->blocks[block->succ[s]];
+            int position = 0;
+            while (cfg->preds[succ->preds + position] != b) position++;
+            for (int p = ssa->block_phis[block->succ[s]]; p < ssa->block_phis[block->succ[s] + 1]; p++) {
+                ssa->phi_args[ssa->phis[p].args + position] = current[ssa->phis[p].var];
+            }
+        }
+        
+        stack[top++] = ~b;
+        for (int c = block->child_count - 1; c >= 0; c--) {
+            stack[top++] = cfg->children[block->children + c];
+        }
+    }
+    free(stack);
+    return true;
+}
+
+/**
+ * Builds the form of a routine
+ * @param ssa filled form, freed by ssa_free even on failure
+ * @param code program
+ * @param first first instruction of the routine
+ * @param last one past the last instruction of the routine
+ * @return true on success, false on allocation failure
+ */
+bool ssa_build(Ssa* ssa, InstrList* code, int first, int last) {
+    memset(ssa, 0, sizeof(*ssa));
+    if (!cfg_build(&ssa->cfg, code, first, last)) return false;
+    
+    ssa->prefix = "TF@";
+    for (int i = first; i < last; i++) {
+        if (instr_is(&code->items[i], "PUSHFRAME")) {
+            ssa->prefix = "LF@";
+            break;
+        }
+    }
+    if (!collect_variables(ssa)) return false;
+    
+    int count = last - first > 0 ? last - first : 1;
+    int* def_vars = malloc(count * sizeof(int));
+    int* use_vars = malloc(count * INSTR_MAX_ARGS * sizeof(int));
+    int* current = malloc((ssa->var_count > 0 ? ssa->var_count : 1) * sizeof(int));
+    ssa->pinned = calloc(ssa->var_count > 0 ? ssa->var_count : 1, sizeof(bool));
+    ssa->defs = malloc(count * sizeof(int));
+    ssa->uses = malloc(count * INSTR_MAX_ARGS * sizeof(int));
+    bool ok = def_vars && use_vars && current && ssa->pinned && ssa->defs && ssa->uses;
+    for (int i = 0; ok && i < count; i++) {
+        ssa->defs[i] = -1;
+        for (int j = 0; j < INSTR_MAX_ARGS; j++) {
+            ssa->uses[i * INSTR_MAX_ARGS + j] = -1;
+        }
+    }
+    
+    // Versions at the entry come first, one per variable
+    for (int v = 0; ok && v < ssa->var_count; v++) {
+        current[v] = add_version(ssa, v, -1, 0);
+        ok = current[v] >= 0;
+    }
+    if (ok) {
+        classify_instructions(ssa, def_vars, use_vars);
+        ok = place_phis(ssa, def_vars) && rename_versions(ssa, def_vars, use_vars, current);
+    }
+    free(def_vars);
+    free(use_vars);
+    free(current);
+    return ok;
+}
+
+/**
+ * Follows copies to the version first holding the value
+ * @param ssa form
+ * @param version version
+ * @return version with the same value, the version itself if it is not a copy
+ */
+int ssa_resolve(const Ssa* ssa, int version) {
+    for (int steps = 0; ssa->versions[version].copy >= 0 && steps < ssa->version_count; steps++) {
+        version = ssa->versions[version].copy;
+    }
+    return version;
+}
+
+// Checks if two resolved versions hold the same value
+static bool same_value(const Ssa* ssa, int a, int b) {
+    const char* x = ssa->versions[a].constant;
+    const char* y = ssa->versions[b].constant;
+    return a == b || (x && y && strcmp(x, y) == 0);
+}
+
+// Values of versions written by copies of a variable or a constant
+static void find_copies(Ssa* ssa) {
+    const Cfg* cfg = &ssa->cfg;
+    for (int v = ssa->var_count; v < ssa->version_count; v++) {
+        SsaVersion* version = &ssa->versions[v];
+        if (version->def < 0) continue;
+        
+        // Pushed value popped right away is copied as well
+        const Instr* instr = &cfg->code->items[version->def];
+        int source = version->def - cfg->first;
+        int operand = 1;
+        if (instr_is(instr, "POPS")) {
+            if (version->def == cfg->blocks[version->block].start) continue;
+            instr = &cfg->code->items[version->def - 1];
+            if (!instr_is(instr, "PUSHS")) continue;
+            source--;
+            operand = 0;
+        } else if (!instr_is(instr, "MOVE")) {
+            continue;
+        }
+        
+        if (is_constant(instr->args[operand])) {
+            version->constant = instr->args[operand];
+        } else {
+            version->copy = ssa->uses[source * INSTR_MAX_ARGS + operand];
+        }
+    }
+    
+    // Phis with arguments that all agree, apart from the phi itself
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int p = 0; p < ssa->phi_count; p++) {
+            const SsaPhi* phi = &ssa->phis[p];
+            if (phi->dest < 0 || ssa->versions[phi->dest].copy >= 0) continue;
+            
+            int common = -1;
+            bool agree = true;
+            int pred_count = cfg->blocks[ssa->versions[phi->dest].block].pred_count;
+            for (int k = 0; k < pred_count && agree; k++) {
+                if (ssa->phi_args[phi->args + k] < 0) continue;
+                int value = ssa_resolve(ssa, ssa->phi_args[phi->args + k]);
+                if (value == phi->dest) continue;
+                if (common < 0) {
+                    common = value;
+                } else {
+                    agree = same_value(ssa, common, value);
+                }
+            }
+            if (agree && common >= 0) {
+                ssa->versions[phi->dest].copy = common;
+                changed = true;
+            }
+        }
+    }
+}
+
+// Checks if the operand read in place of a variable is a short constant
+static bool is_short_constant(const char* operand) {
+    return operand && strlen(operand) <= MAX_CONSTANT_LENGTH;
+}
+
+/**
+ * Reads the constant or the variable first holding a value instead of its
+ * copies, in a walk of the dominator tree like the renaming
+ * @param ssa form with values of versions
+ * @param current current versions, the entry versions at the start
+ * @return true on success, false on allocation failure
+ */
+static bool substitute(Ssa* ssa, int* current) {
+    const Cfg* cfg = &ssa->cfg;
+    int* stack = malloc((2 * cfg->reachable + 1) * sizeof(int));
+    if (!stack) return false;
+    
+    int top = 0;
+    if (cfg->reachable > 0) stack[top++] = 0;
+    while (top > 0) {
+        int b = stack[--top];
+        if (b < 0) {
+            b = ~b;
+            for (int i = cfg->blocks[b].end - 1; i >= cfg->blocks[b].start; i--) {
+                int version = ssa->defs[i - cfg->first];
+                if (version >= 0) current[ssa->versions[version].var] = ssa->versions[version].prev;
+            }
+            for (int p = ssa->block_phis[b + 1] - 1; p >= ssa->block_phis[b]; p--) {
+                const SsaVersion* version = &ssa->versions[ssa->phis[p].dest];
+                current[version->var] = version->prev;
+            }
+            continue;
+        }
+        
+        const CfgBlock* block = &cfg->blocks[b];
+        for (int p = ssa->block_phis[b]; p < ssa->block_phis[b + 1]; p++) {
+            current[ssa->phis[p].var] = ssa->phis[p].dest;
+        }
+        for (int i = block->start; i < block->end; i++) {
+            int index = i - cfg->first;
+            Instr* instr = &cfg->code->items[i];
+            for (int j = 0; j < INSTR_MAX_ARGS; j++) {
+                int* use = &ssa->uses[index * INSTR_MAX_ARGS + j];
+                if (*use < 0) continue;
+                int value = ssa_resolve(ssa, *use);
+                const SsaVersion* source = &ssa->versions[value];
+                
+                // The other variable must still hold the value here
+                bool ok = true;
+                if (is_short_constant(source->constant)) {
+                    ok = instr_set_arg(instr, j, source->constant);
+                    *use = -1;
+                } else if (value != *use && current[source->var] == value) {
+                    ok = instr_set_arg(instr, j, ssa->names[source->var]);
+                    *use = value;
+                }
+                if (!ok) {
+                    free(stack);
+                    return false;
+                }
+            }
+            if (ssa->defs[index] >= 0) current[ssa->versions[ssa->defs[index]].var] = ssa->defs[index];
+        }
+        
+        stack[top++] = ~b;
+        for (int c = block->child_count - 1; c >= 0; c--) {
+            stack[top++] = cfg->children[block->children + c];
+        }
+    }
+    free(stack);
+    return true;
+}
+
+/**
+ * Lowers the form, variables keep their names and copies nobody reads are
+ * removed
+ * @param ssa conventional form
+ * @return true on success, false on allocation failure
+ */
+bool ssa_lower(Ssa* ssa) {
+    const Cfg* cfg = &ssa->cfg;
+    InstrList* code = cfg->code;
+    bool* live = calloc(ssa->version_count > 0 ? ssa->version_count : 1, sizeof(bool));
+    int* phi_of = malloc((ssa->version_count > 0 ? ssa->version_count : 1) * sizeof(int));
+    int* work = malloc((ssa->version_count > 0 ? ssa->version_count : 1) * sizeof(int));
+    bool* removed = calloc(cfg->last - cfg->first > 0 ? cfg->last - cfg->first : 1, sizeof(bool));
+    if (!live || !phi_of || !work || !removed) {
+        free(live);
+        free(phi_of);
+        free(work);
+        free(removed);
+        return false;
+    }
+    
+    // Versions read by the code, then the arguments of the phis they are
+    int top = 0;
+    for (int v = 0; v < ssa->version_count; v++) {
+        phi_of[v] = -1;
+    }
+    for (int p = 0; p < ssa->phi_count; p++) {
+        if (ssa->phis[p].dest >= 0) phi_of[ssa->phis[p].dest] = p;
+    }
+    for (int i = 0; i < (cfg->last - cfg->first) * INSTR_MAX_ARGS; i++) {
+        int v = ssa->uses[i];
+        if (v >= 0 && !live[v]) {
+            live[v] = true;
+            work[top++] = v;
+        }
+    }
+    while (top > 0) {
+        int p = phi_of[work[--top]];
+        if (p < 0) continue;
+        int pred_count = cfg->blocks[ssa->versions[ssa->phis[p].dest].block].pred_count;
+        for (int k = 0; k < pred_count; k++) {
+            int v = ssa->phi_args[ssa->phis[p].args + k];
+            if (v >= 0 && !live[v]) {
+                live[v] = true;
+                work[top++] = v;
+            }
+        }
+    }
+    
+    for (int v = ssa->var_count; v < ssa->version_count; v++) {
+        const SsaVersion* version = &ssa->versions[v];
+        if (live[v] || version->def < 0) continue;
+        const Instr* instr = &code->items[version->def];
+        if (instr_is(instr, "MOVE")) {
+            removed[version->def - cfg->first] = true;
+        } else if (instr_is(instr, "POPS") && version->def > cfg->blocks[version->block].start &&
+                   instr_is(&code->items[version->def - 1], "PUSHS")) {
+            removed[version->def - cfg->first] = true;
+            removed[version->def - 1 - cfg->first] = true;
+        }
+    }
+    for (int i = cfg->last - 1; i >= cfg->first; i--) {
+        const Instr* instr = &code->items[i];
+        bool self_copy = instr_is(instr, "MOVE") && strcmp(instr->args[0], instr->args[1]) == 0;
+        if (removed[i - cfg->first] || self_copy) ilist_remove(code, i);
+    }
+    
+    free(live);
+    free(phi_of);
+    free(work);
+    free(removed);
+    return true;
+}
+
+/**
+ * Frees the form
+ * @param ssa form built by ssa_build
+ */
+void ssa_free(Ssa* ssa) {
+    for (int i = 0; i < ssa->var_count; i++) {
+        free(ssa->names[i]);
+    }
+    free(ssa->names);
+    free(ssa->pinned);
+    free(ssa->versions);
+    free(ssa->defs);
+    free(ssa->uses);
+    free(ssa->phis);
+    free(ssa->phi_args);
+    free(ssa->block_phis);
+    cfg_free(&ssa->cfg);
+    memset(ssa, 0, sizeof(*ssa));
+}
+
+/**
+ * Propagates copies and constants of frame variables in one routine
+ * @param code generated program
+ * @param first label starting the routine
+ * @param last end of the routine, exclusive
+ * @return true on success, code must not be printed on failure
+ */
+bool ssa_routine(InstrList* code, int first, int last) {
+    // Helpers of built-ins have no frame
+    if (strncmp(code->items[first].args[0], "$%", 2) == 0) return true;
+    
+    Ssa ssa;
+    bool ok = ssa_build(&ssa, code, first, last);
+    if (!ok || ssa.var_count == 0 || ssa.var_count > MAX_VARIABLES) {
+        ssa_free(&ssa);
+        return ok;
+    }
+    
+    int* current = malloc(ssa.var_count * sizeof(int));
+    ok = current != NULL;
+    if (ok) {
+        for (int v = 0; v < ssa.var_count; v++) {
+            current[v] = v;
+        }
+        find_copies(&ssa);
+        ok = substitute(&ssa, current) && ssa_lower(&ssa);
+    }
+    free(current);
+    ssa_free(&ssa);
+    return ok;
+}
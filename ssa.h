@@ -0,0 +1,74 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * ssa.h
+ * static single assignment form of frame variables
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef SSA_H
+#define SSA_H
+
+#include "cfg.h"
+#include "ilist.h"
+#include <stdbool.h>
+
+// Value of a frame variable, versions 0..var_count-1 are the values at the entry
+typedef struct {
+    int var;
+    int def;               // instruction writing it, -1 at the entry and for phis
+    int block;
+    int prev;              // version current before it in the dominator tree walk
+    const char* constant;  // constant operand it holds or NULL
+    int copy;              // version with the same value or -1
+} SsaVersion;
+
+// Merge of the versions of a variable at the start of a block
+typedef struct {
+    int var;
+    int dest;
+    int args;              // first of the arguments in Ssa.phi_args, one per predecessor
+} SsaPhi;
+
+// Routine in SSA form, operands of the code are mapped to versions
+typedef struct {
+    Cfg cfg;
+    const char* prefix;    // LF@, or TF@ in a routine without PUSHFRAME
+    char** names;          // operands of the variables
+    int var_count;
+    bool* pinned;          // variables partly written by SETCHAR, no versions are made
+    SsaVersion* versions;
+    int version_count;
+    int version_capacity;
+    int* defs;             // version written by each instruction or -1
+    int* uses;             // version read by each operand, INSTR_MAX_ARGS per instruction
+    SsaPhi* phis;          // phis of each block are together
+    int phi_count;
+    int* phi_args;         // -1 for arguments from unreachable blocks
+    int* block_phis;       // first phi of each block, block_count + 1 items
+} Ssa;
+
+// Builds the form of variables the routine code first..last defines by
+// DEFVAR. The code is only read.
+bool ssa_build(Ssa* ssa, InstrList* code, int first, int last);
+
+// Version with the value the version is known to have, the version itself if unknown
+int ssa_resolve(const Ssa* ssa, int version);
+
+// Lowers the form back to the code. Passes must keep it conventional (a
+// version is only read where it is the current version of its variable), so
+// every version keeps the name of its variable. Copies into versions that
+// are never read are removed with their pushes. The graph is invalid after.
+bool ssa_lower(Ssa* ssa);
+
+// Free the form
+void ssa_free(Ssa* ssa);
+
+// Propagates copies and constants of frame variables of the routine code
+// first..last
+bool ssa_routine(InstrList* code, int first, int last);
+
+#endif // SSA_H
@@ -0,0 +1,205 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * strenc.c
+ * encoding of string literals for IFJcode25
+ *
+ * Bytes 0-32, # and \ are written as \ddd, everything else is copied.
+ * Literals are scanned 16 bytes at a time, a block without any byte that
+ * needs an escape is copied as a whole. Encoded literals are cached, so a
+ * literal used many times is encoded only once.
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#include "strenc.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define ONES  0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+#define STRENC_BLOCK 16
+#define CACHE_INITIAL_CAPACITY 64
+
+// One cached literal
+typedef struct CacheEntry {
+    char* text;
+    char* encoded;
+    uint32_t hash;
+} CacheEntry;
+
+// Open addressing hash table of encoded literals
+typedef struct StrCache {
+    CacheEntry* entries;
+    size_t count;
+    size_t capacity;    // power of two
+} StrCache;
+
+static StrCache cache = {NULL, 0, 0};
+
+// Checks if byte must be escaped
+static bool needs_escape(unsigned char c) {
+    return c <= 32 || c == '#' || c == '\\';
+}
+
+// Checks if some byte of the word is zero
+static uint64_t has_zero(uint64_t word) {
+    return (word - ONES) & ~word & HIGHS;
+}
+
+// Checks if some byte of the word must be escaped
+static bool word_needs_escape(uint64_t word) {
+    // Byte <= 32 is a byte less than 33, high bytes never match
+    uint64_t control = (word - ONES * 33) & ~word & HIGHS;
+    return (control | has_zero(word ^ (ONES * '#')) | has_zero(word ^ (ONES * '\\'))) != 0;
+}
+
+// Writes escape of one byte, returns its length
+static size_t write_escape(unsigned char c, char* out) {
+    out[0] = '\\';
+    out[1] = (char)('0' + c / 100);
+    out[2] = (char)('0' + c / 10 % 10);
+    out[3] = (char)('0' + c % 10);
+    return 4;
+}
+
+// Encodes bytes one by one, clean runs are copied at once
+static size_t encode_bytes(const char* text, size_t len, char* out) {
+    size_t written = 0;
+    size_t run = 0;
+    
+    for (size_t i = 0; i < len; i++) {
+        if (needs_escape((unsigned char)text[i])) {
+            memcpy(out + written, text + run, i - run);
+            written += i - run;
+            written += write_escape((unsigned char)text[i], out + written);
+            run = i + 1;
+        }
+    }
+    memcpy(out + written, text + run, len - run);
+    return written + len - run;
+}
+
+/**
+ * Encodes string for string@ operand
+ * @param text raw string
+ * @param len length of the string
+ * @param out output buffer of at least STRENC_MAX_LENGTH(len) + 1 bytes
+ * @return length of the encoded string
+ */
+size_t strenc_encode(const char* text, size_t len, char* out) {
+    size_t written = 0;
+    size_t i = 0;
+    
+    for (; i + STRENC_BLOCK <= len; i += STRENC_BLOCK) {
+        uint64_t low, high;
+        memcpy(&low, text + i, sizeof(low));
+        memcpy(&high, text + i + sizeof(low), sizeof(high));
+        
+        if (word_needs_escape(low) || word_needs_escape(high)) {
+            written += encode_bytes(text + i, STRENC_BLOCK, out + written);
+        } else {
+            memcpy(out + written, text + i, STRENC_BLOCK);
+            written += STRENC_BLOCK;
+        }
+    }
+    
+    written += encode_bytes(text + i, len - i, out + written);
+    out[written] = '\0';
+    return written;
+}
+
+// FNV-1a hash of the string
+static uint32_t hash_string(const char* text, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Doubles the cache capacity
+static bool cache_grow(void) {
+    size_t capacity = cache.capacity ? cache.capacity * 2 : CACHE_INITIAL_CAPACITY;
+    CacheEntry* entries = calloc(capacity, sizeof(CacheEntry));
+    if (!entries) return false;
+    
+    for (size_t i = 0; i < cache.capacity; i++) {
+        if (!cache.entries[i].text) continue;
+        size_t slot = cache.entries[i].hash & (capacity - 1);
+        while (entries[slot].text) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        entries[slot] = cache.entries[i];
+    }
+    
+    free(cache.entries);
+    cache.entries = entries;
+    cache.capacity = capacity;
+    return true;
+}
+
+/**
+ * Gets encoding of a literal, encodes it only when seen for the first time
+ * @param text raw string
+ * @return encoded string owned by the cache, NULL on failure
+ */
+const char* strenc_cached(const char* text) {
+    if (cache.count * 2 >= cache.capacity && !cache_grow()) {
+        return NULL;
+    }
+    
+    size_t len = strlen(text);
+    uint32_t hash = hash_string(text, len);
+    size_t slot = hash & (cache.capacity - 1);
+    
+    while (cache.entries[slot].text) {
+        if (cache.entries[slot].hash == hash && strcmp(cache.entries[slot].text, text) == 0) {
+            return cache.entries[slot].encoded;
+        }
+        slot = (slot + 1) & (cache.capacity - 1);
+    }
+    
+    char* copy = malloc(len + 1);
+    char* encoded = malloc(STRENC_MAX_LENGTH(len) + 1);
+    if (!copy || !encoded) {
+        free(copy);
+        free(encoded);
+        return NULL;
+    }
+    
+    memcpy(copy, text, len + 1);
+    size_t encoded_len = strenc_encode(text, len, encoded);
+    
+    // Keep only what is used
+    char* shrunk = realloc(encoded, encoded_len + 1);
+    if (shrunk) {
+        encoded = shrunk;
+    }
+    
+    cache.entries[slot].text = copy;
+    cache.entries[slot].encoded = encoded;
+    cache.entries[slot].hash = hash;
+    cache.count++;
+    return encoded;
+}
+
+/**
+ * Frees all cached encodings
+ */
+void strenc_cache_free(void) {
+    for (size_t i = 0; i < cache.capacity; i++) {
+        free(cache.entries[i].text);
+        free(cache.entries[i].encoded);
+    }
+    free(cache.entries);
+    cache.entries = NULL;
+    cache.count = 0;
+    cache.capacity = 0;
+}
@@ -0,0 +1,31 @@
+/**
+ * Project: Implementace překladače jazyka IFJ25.
+ *
+ * strenc.h
+ * encoding of string literals for IFJcode25
+ *
+ * @author Jakub Gono - xgonoja00
+ * @author Vojtěch Kabelka - xkabelv00
+ * @author Filip Kachyňa - xkachyf00
+ * @author Martin Metelka - xmetelm00
+ */
+#ifndef STRENC_H
+#define STRENC_H
+
+#include <stddef.h>
+
+// Longest possible encoding of len bytes, without the terminating zero
+#define STRENC_MAX_LENGTH(len) ((len) * 4)
+
+// Encode len bytes of text into out, returns length of the encoding.
+// Out must have room for STRENC_MAX_LENGTH(len) + 1 bytes.
+size_t strenc_encode(const char* text, size_t len, char* out);
+
+// Encoding of text from the literal cache, NULL on allocation failure.
+// Returned string is owned by the cache.
+const char* strenc_cached(const char* text);
+
+// Free all cached encodings
+void strenc_cache_free(void);
+
+#endif // STRENC_H
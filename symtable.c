@@ -502,6 +502,8 @@ SymbolData* symdata_create_func(ifj25_symbol_kind_t kind, int arity){
     }
     data->func->arity = arity;
     data->func->params = NULL;
+    data->func->global = NULL;
+    data->func->returns_string = false;
     data->var = NULL;
     return data;
 }
@@ -532,6 +534,7 @@ void symdata_free(SymbolData *data){
                 free(temp->name);
                 free(temp);
             }
+            free(data->func->global);
             free(data->func);
             data->func = NULL;
         }
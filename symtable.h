@@ -42,6 +42,8 @@ typedef struct Param {
 typedef struct FuncData {
     int arity;
     Param *params;
+    char *global; // global only read by a trivial getter or written by a trivial setter
+    bool returns_string; // every return statement returns a string
 } FuncData;
 
 // Variable data
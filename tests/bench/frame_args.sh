@@ -0,0 +1,25 @@
+#!/bin/sh
+# Instructions the interpreter executes in the call-heavy programs built with
+# the stack calling convention and with --frame-args, LABEL is not counted.
+# profile_layout.ifj25 is the program with both calls and branches. Input of
+# NAME.ifj25 is read from NAME.in when it exists.
+#
+# Usage: tests/bench/frame_args.sh [compiler]
+
+DIR=$(dirname "$0")
+COMPILER=${1:-./ifj25-compiler}
+TMP=${TMPDIR:-/tmp}/ifj25-bench.$$
+
+# Prints INSTS of a run of the program built with the given flags
+run() {
+    input=/dev/null
+    [ -f "$DIR/$1.in" ] && input=$DIR/$1.in
+    "$COMPILER" $2 < "$DIR/$1.ifj25" > "$TMP.code" || exit 1
+    python3 "$DIR/../ic.py" "$TMP.code" "$input" --stats 2>&1 >/dev/null | sed -n 's/.*INSTS //p'
+}
+
+printf "%-16s %10s %14s\n" program stack --frame-args
+for name in calls_simple profile_layout calls_fib; do
+    printf "%-16s %10s %14s\n" "$name" "$(run $name "")" "$(run $name --frame-args)"
+done
+rm -f "$TMP.code"
@@ -0,0 +1,35 @@
+#!/bin/sh
+# Instructions the interpreter executes in profile_layout.ifj25 built without
+# and with its profile (--profile-use), LABEL is not counted. The profile
+# holds label counts of a run of the build without it, --update writes it
+# again.
+#
+# Usage: tests/bench/profile_layout.sh [--update] [compiler]
+
+DIR=$(dirname "$0")
+UPDATE=false
+if [ "$1" = --update ]; then
+    UPDATE=true
+    shift
+fi
+COMPILER=${1:-./ifj25-compiler}
+TMP=${TMPDIR:-/tmp}/ifj25-bench.$$
+SOURCE=$DIR/profile_layout.ifj25
+PROFILE=$DIR/profile_layout.prof
+
+# Prints INSTS of a run of the code, the labels it ran are dumped to $2
+run() {
+    python3 "$DIR/../ic.py" "$1" /dev/null --stats --dump-labels "$2" 2>&1 >/dev/null | sed -n 's/.*INSTS //p'
+}
+
+"$COMPILER" < "$SOURCE" > "$TMP.code" || exit 1
+without=$(run "$TMP.code" "$TMP.prof")
+if $UPDATE; then
+    cp "$TMP.prof" "$PROFILE"
+fi
+"$COMPILER" --profile-use "$PROFILE" < "$SOURCE" > "$TMP.code" || exit 1
+with=$(run "$TMP.code" "$TMP.prof")
+rm -f "$TMP.code" "$TMP.prof"
+
+echo "without profile: $without instructions"
+echo "with profile:    $with instructions"
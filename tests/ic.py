@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+# IFJcode25 interpreter for the regression tests and benchmarks.
+#
+# Usage: ic.py program.code [input] [--stats] [--dump-labels FILE]
+#   --stats        prints "STEPS n INSTS m" on stderr, INSTS without LABEL,
+#                  DPRINT and BREAK
+#   --dump-labels  writes "label count" lines of executed labels, the
+#                  profile --profile-use reads
+import sys, re
+def die(code, msg):
+    sys.stderr.write("RUNTIME ERROR %d: %s\n" % (code, msg)); sys.exit(code)
+class Nil: 
+    def __repr__(self): return "nil"
+NIL = Nil()
+def unesc(s):
+    out=[];i=0
+    while i < len(s):
+        if s[i]=='\\':
+            out.append(chr(int(s[i+1:i+4]))); i+=4
+        else:
+            if s[i] in ' #' or ord(s[i])<=32: die(32,"bad string literal char %r"%s)
+            out.append(s[i]); i+=1
+    return ''.join(out)
+def parse_const(tok):
+    t,_,v = tok.partition('@')
+    if t=='int': return int(v,0) if not v.startswith(('0x','-0x')) else int(v,16)
+    if t=='float':
+        try: return float.fromhex(v)
+        except: die(32,"bad float %s"%v)
+    if t=='string': return unesc(v)
+    if t=='bool': return v=='true'
+    if t=='nil': return NIL
+    return None
+def tname(v):
+    if v is NIL: return 'nil'
+    if isinstance(v,bool): return 'bool'
+    if isinstance(v,int): return 'int'
+    if isinstance(v,float): return 'float'
+    return 'string'
+def main():
+    args=sys.argv[1:]
+    stats = '--stats' in args; args=[a for a in args if a!='--stats']
+    dump=None
+    if '--dump-labels' in args:
+        k=args.index('--dump-labels'); dump=args[k+1]; del args[k:k+2]
+    prog=open(args[0]).read().split('\n')
+    inp = open(args[1]).read().split('\n') if len(args)>1 else []
+    inp_i=[0]
+    code=[]; labels={}
+    first=True
+    for ln,line in enumerate(prog):
+        line=line.split('#',1)[0].strip() if not line.lstrip().startswith('string') else line
+        line=re.sub(r'#.*','',line).strip()
+        if not line: continue
+        if first:
+            if line.lower()!='.ifjcode25': die(21,'header')
+            first=False; continue
+        parts=line.split()
+        op=parts[0].upper()
+        if op=='LABEL':
+            if parts[1] in labels: die(52,'label redef '+parts[1])
+            labels[parts[1]]=len(code)
+        code.append((op,parts[1:],ln+1))
+    GF={}; LFs=[]; TF=[None]; stack=[]; calls=[]
+    def frame(name):
+        f,_,n=name.partition('@')
+        if f=='GF': return GF,n
+        if f=='LF':
+            if not LFs: die(55,'no LF')
+            return LFs[-1],n
+        if f=='TF':
+            if TF[0] is None: die(55,'no TF')
+            return TF[0],n
+        die(99,'bad var '+name)
+    def val(tok):
+        if tok.split('@')[0] in ('GF','LF','TF'):
+            d,n=frame(tok)
+            if n not in d: die(54,'undef var '+tok)
+            v=d[n]
+            if v is None: die(56,'uninit '+tok)
+            return v
+        return parse_const(tok)
+    def setv(tok,v):
+        d,n=frame(tok)
+        if n not in d: die(54,'undef var '+tok)
+        d[n]=v
+    def num(v):
+        if isinstance(v,bool) or not isinstance(v,(int,float)): die(53,'not number %r'%(v,))
+        return v
+    def arith(op,a,b):
+        num(a);num(b)
+        if op=='ADD': r=a+b
+        elif op=='SUB': r=a-b
+        elif op=='MUL': r=a*b
+        elif op=='DIV':
+            if b==0: die(57,'div0')
+            r=float(a)/b
+        elif op=='IDIV':
+            if not(isinstance(a,int) and isinstance(b,int)): die(53,'idiv types')
+            if b==0: die(57,'div0')
+            r=int(a/b)
+        if isinstance(r,float) and op!='DIV' and isinstance(a,int) and isinstance(b,int): r=int(r)
+        return r
+    def cmp(op,a,b):
+        if op=='EQ':
+            if a is NIL or b is NIL: return a is b
+            if tname(a)!=tname(b) and not (tname(a) in('int','float') and tname(b) in ('int','float')): die(53,'eq types %r %r'%(a,b))
+            return a==b
+        if a is NIL or b is NIL: die(53,'lt nil')
+        ta,tb=tname(a),tname(b)
+        if ta!=tb and not (ta in('int','float') and tb in('int','float')): die(53,'cmp types')
+        return a<b if op=='LT' else a>b
+    def fmt(v):
+        if v is NIL: return ''
+        if isinstance(v,bool): return 'true' if v else 'false'
+        if isinstance(v,int): return str(v)
+        if isinstance(v,float): return v.hex() if False else ('%a' if False else float.hex(v))
+        return v
+    out=sys.stdout
+    pc=0; steps=0; icount={}
+    lblcount={}
+    while True:
+        if pc>=len(code): break
+        op,a,ln=code[pc]; pc+=1; steps+=1
+        icount[op]=icount.get(op,0)+1
+        if steps>50000000: die(99,'step limit')
+        if op=='LABEL': lblcount[a[0]]=lblcount.get(a[0],0)+1; continue
+        if op=='MOVE': setv(a[0],val(a[1]))
+        elif op=='CREATEFRAME': TF[0]={}
+        elif op=='PUSHFRAME':
+            if TF[0] is None: die(55,'pushframe no TF')
+            LFs.append(TF[0]); TF[0]=None
+        elif op=='POPFRAME':
+            if not LFs: die(55,'popframe')
+            TF[0]=LFs.pop()
+        elif op=='DEFVAR':
+            d,n=frame(a[0])
+            if n in d: die(52,'redef var '+a[0]+' line %d'%ln)
+            d[n]=None
+        elif op=='CALL':
+            if a[0] not in labels: die(52,'no label '+a[0])
+            calls.append(pc); pc=labels[a[0]]
+        elif op=='RETURN':
+            if not calls: die(56,'return empty')
+            pc=calls.pop()
+        elif op=='PUSHS': stack.append(val(a[0]))
+        elif op=='POPS':
+            if not stack: die(56,'pops empty line %d'%ln)
+            setv(a[0],stack.pop())
+        elif op=='CLEARS': stack.clear()
+        elif op in ('ADD','SUB','MUL','DIV','IDIV'): setv(a[0],arith(op,val(a[1]),val(a[2])))
+        elif op in ('ADDS','SUBS','MULS','DIVS','IDIVS'):
+            if len(stack)<2: die(56,'stack')
+            b=stack.pop();x=stack.pop();stack.append(arith(op[:-1],x,b))
+        elif op in ('LT','GT','EQ'): setv(a[0],cmp(op,val(a[1]),val(a[2])))
+        elif op in ('LTS','GTS','EQS'):
+            if len(stack)<2: die(56,'stack')
+            b=stack.pop();x=stack.pop();stack.append(cmp(op[:-1],x,b))
+        elif op in ('AND','OR'):
+            x,y=val(a[1]),val(a[2])
+            if not(isinstance(x,bool) and isinstance(y,bool)): die(53,'and')
+            setv(a[0], (x and y) if op=='AND' else (x or y))
+        elif op=='NOT':
+            x=val(a[1])
+            if not isinstance(x,bool): die(53,'not')
+            setv(a[0], not x)
+        elif op in('ANDS','ORS'):
+            b=stack.pop();x=stack.pop()
+            if not(isinstance(x,bool) and isinstance(b,bool)): die(53,'ands')
+            stack.append((x and b) if op=='ANDS' else (x or b))
+        elif op=='NOTS':
+            x=stack.pop()
+            if not isinstance(x,bool): die(53,'nots %r'%(x,))
+            stack.append(not x)
+        elif op=='INT2FLOAT': setv(a[0],float(num(val(a[1]))))
+        elif op=='FLOAT2INT': setv(a[0],int(num(val(a[1]))))
+        elif op=='INT2FLOATS': stack.append(float(num(stack.pop())))
+        elif op=='FLOAT2INTS': stack.append(int(num(stack.pop())))
+        elif op=='INT2CHAR':
+            x=val(a[1])
+            if not isinstance(x,int) or isinstance(x,bool): die(53,'int2char')
+            if x<0 or x>255: die(58,'int2char range')
+            setv(a[0],chr(x))
+        elif op=='STRI2INT':
+            s,i=val(a[1]),val(a[2])
+            if not isinstance(s,str) or not isinstance(i,int): die(53,'stri2int')
+            if i<0 or i>=len(s): die(58,'stri2int range')
+            setv(a[0],ord(s[i]))
+        elif op=='READ':
+            t=a[1]
+            line=inp[inp_i[0]] if inp_i[0]<len(inp) else None
+            inp_i[0]+=1
+            if line is None: setv(a[0],NIL); continue
+            if t=='string': setv(a[0],line)
+            elif t=='int':
+                try: setv(a[0],int(line.strip(),0))
+                except: setv(a[0],NIL)
+            elif t=='float':
+                try: setv(a[0],float(line.strip()))
+                except:
+                    try: setv(a[0],float.fromhex(line.strip()))
+                    except: setv(a[0],NIL)
+            elif t=='bool': setv(a[0], line.strip().lower()=='true')
+        elif op=='WRITE': out.write(fmt(val(a[0])))
+        elif op=='CONCAT':
+            x,y=val(a[1]),val(a[2])
+            if not(isinstance(x,str) and isinstance(y,str)): die(53,'concat %r %r'%(x,y))
+            setv(a[0],x+y)
+        elif op=='STRLEN':
+            x=val(a[1])
+            if not isinstance(x,str): die(53,'strlen %r'%(x,))
+            setv(a[0],len(x))
+        elif op=='GETCHAR':
+            s,i=val(a[1]),val(a[2])
+            if not isinstance(s,str) or not isinstance(i,int): die(53,'getchar')
+            if i<0 or i>=len(s): die(58,'getchar range')
+            setv(a[0],s[i])
+        elif op=='SETCHAR':
+            d=val(a[0]); i=val(a[1]); s=val(a[2])
+            if i<0 or i>=len(d) or not s: die(58,'setchar')
+            setv(a[0], d[:i]+s[0]+d[i+1:])
+        elif op=='TYPE':
+            d,n=frame(a[1]) if a[1].split('@')[0] in ('GF','LF','TF') else (None,None)
+            if d is not None:
+                if n not in d: die(54,'undef')
+                v=d[n]; setv(a[0],'' if v is None else tname(v))
+            else: setv(a[0],tname(parse_const(a[1])))
+        elif op=='JUMP':
+            if a[0] not in labels: die(52,'no label '+a[0])
+            pc=labels[a[0]]
+        elif op in('JUMPIFEQ','JUMPIFNEQ'):
+            if a[0] not in labels: die(52,'no label '+a[0])
+            r=cmp('EQ',val(a[1]),val(a[2]))
+            if r==(op=='JUMPIFEQ'): pc=labels[a[0]]
+        elif op in('JUMPIFEQS','JUMPIFNEQS'):
+            if a[0] not in labels: die(52,'no label '+a[0])
+            b=stack.pop();x=stack.pop()
+            r=cmp('EQ',x,b)
+            if r==(op=='JUMPIFEQS'): pc=labels[a[0]]
+        elif op=='EXIT':
+            v=val(a[0])
+            out.flush()
+            if stats: sys.stderr.write("STEPS %d INSTS %d\n"%(steps,steps-sum(icount.get(k,0) for k in ('LABEL','DPRINT','BREAK'))))
+            if dump: open(dump,'w').write(''.join('%s %d\n'%kv for kv in sorted(lblcount.items())))
+            sys.exit(v)
+        elif op=='BREAK': pass
+        elif op=='DPRINT': sys.stderr.write(fmt(val(a[0])))
+        else: die(22,'unknown op '+op)
+    out.flush()
+    if dump: open(dump,'w').write(''.join('%s %d\n'%kv for kv in sorted(lblcount.items())))
+    if stats:
+        sys.stderr.write("STEPS %d INSTS %d\n"%(steps,steps-sum(icount.get(k,0) for k in ('LABEL','DPRINT','BREAK'))))
+        if '--ops' in sys.argv: sys.stderr.write(repr(sorted(icount.items(),key=lambda x:-x[1]))+"\n")
+main()
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Compiles every tests/*.ifj25 at all optimization levels and compares the
+# output of the interpreted program with tests/NAME.out. Input is read from
+# tests/NAME.in when it exists. A build with --profile-use tests/NAME.prof is
+# checked too when the profile exists. When tests/NAME.counters exists, the
+# --instrument build must print that counter table and write tests/NAME.map.
+#
+# Usage: tests/run.sh [compiler]
+
+DIR=$(dirname "$0")
+COMPILER=${1:-./ifj25-compiler}
+TMP=${TMPDIR:-/tmp}/ifj25-test.$$
+failed=0
+
+for source in "$DIR"/*.ifj25; do
+    name=${source%.ifj25}
+    input=/dev/null
+    [ -f "$name.in" ] && input=$name.in
+    profile=
+    [ -f "$name.prof" ] && profile=--profile-use=$name.prof
+    for flags in -O0 -O1 -O2 --frame-args $profile; do
+        if ! "$COMPILER" $flags < "$source" > "$TMP.code"; then
+            echo "FAIL $(basename "$name") $flags: compile error"
+            failed=1
+            continue
+        fi
+        python3 "$DIR/ic.py" "$TMP.code" "$input" > "$TMP.out" 2>&1
+        if ! cmp -s "$TMP.out" "$name.out"; then
+            echo "FAIL $(basename "$name") $flags"
+            failed=1
+        fi
+    done
+    if [ -f "$name.counters" ]; then
+        "$COMPILER" --instrument --instrument-map "$TMP.map" < "$source" > "$TMP.code" &&
+            python3 "$DIR/ic.py" "$TMP.code" "$input" 2> "$TMP.out" > /dev/null
+        if ! cmp -s "$TMP.out" "$name.counters" || ! cmp -s "$TMP.map" "$name.map"; then
+            echo "FAIL $(basename "$name") --instrument"
+            failed=1
+        fi
+    fi
+done
+rm -f "$TMP.code" "$TMP.out" "$TMP.map"
+
+[ $failed = 0 ] && echo "All tests passed"
+exit $failed